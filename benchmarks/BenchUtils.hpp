@@ -0,0 +1,66 @@
+#ifndef BENCH_UTILS_HPP_
+#define BENCH_UTILS_HPP_
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "Dataset.hpp"
+
+// Helpers shared by the benchmark programs. They only exist so that every benchmark can also run
+// without the MNIST files, on clustered random data of the same shape (pixels in 0..255)
+
+// Every image is the center of a random cluster moved along a few random directions of that cluster, plus a little noise.
+// Like handwritten digits the images lie close to a low dimensional surface, so that their nearest neighbors are
+// meaningful and not all at about the same distance
+template <typename T>
+Dataset<T> SyntheticDataset(std::size_t numImages, std::size_t dimension, unsigned seed = 1, int numClusters = 50, int intrinsicDimension = 8)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> center(64.0, 192.0);
+    std::normal_distribution<double> direction(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 4.0);
+    std::uniform_int_distribution<int> cluster(0, numClusters - 1);
+
+    std::vector<std::vector<double>> centers(numClusters, std::vector<double>(dimension));
+    std::vector<std::vector<std::vector<double>>> directions(numClusters, std::vector<std::vector<double>>(intrinsicDimension, std::vector<double>(dimension)));
+    for (int c = 0; c < numClusters; c++)
+    {
+        for (auto &x : centers[c])
+            x = center(generator);
+        for (auto &d : directions[c])
+            for (auto &x : d)
+                x = 8.0 * direction(generator);
+    }
+
+    Dataset<T> dataset(numImages, dimension);
+    std::vector<double> coefficients(intrinsicDimension);
+    for (std::size_t i = 0; i < numImages; i++)
+    {
+        int c = cluster(generator);
+        for (auto &a : coefficients)
+            a = direction(generator);
+        T *row = dataset.row(i);
+        for (std::size_t j = 0; j < dimension; j++)
+        {
+            double value = centers[c][j] + noise(generator);
+            for (int d = 0; d < intrinsicDimension; d++)
+                value += coefficients[d] * directions[c][d][j];
+            row[j] = (T)std::min(255.0, std::max(0.0, (double)(int)value));
+        }
+    }
+    return dataset;
+}
+
+// Copies count rows starting at first into a new dataset, e.g. to split synthetic queries off the input
+template <typename T>
+Dataset<T> CopyRows(const Dataset<T> &images, std::size_t first, std::size_t count)
+{
+    Dataset<T> rows(count, images.dimension());
+    for (std::size_t i = 0; i < count; i++)
+        std::copy(images.row(first + i), images.row(first + i) + images.dimension(), rows.row(i));
+    return rows;
+}
+
+#endif
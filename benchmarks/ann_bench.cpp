@@ -0,0 +1,489 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "DatasetLoader.hpp"
+#include "BruteForce.hpp"
+#include "GroundTruth.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "Lsh.hpp"
+#include "Cube.hpp"
+#include "Gnns.hpp"
+#include "Mrng.hpp"
+#include "BenchUtils.hpp"
+
+/**
+ * @brief The measurements of one index with one setting of its parameters
+ *
+ * @param index lsh, cube, gnns, mrng or bruteforce
+ * @param parameters the setting, as name=value pairs separated by spaces
+ * @param buildSeconds the time to build the index, the same for all the settings that only change the search
+ * @param memory the bytes of the index without the images
+ * @param recall the fraction of the k true nearest neighbors found, over all the queries
+ * @param aaf, maf the average and the maximum ratio of a found distance to the true distance of the same rank
+ * @param qps the queries per second of a batch on the threads of the default pool
+ * @param mean, p50, p95, p99 the latency in microseconds of the queries answered one at a time on one thread
+ */
+class BenchResult
+{
+public:
+    std::string index;
+    std::string parameters;
+    double buildSeconds;
+    std::size_t memory;
+    double recall;
+    double aaf;
+    double maf;
+    double qps;
+    double mean;
+    double p50;
+    double p95;
+    double p99;
+};
+
+// The value at the fraction p of the sorted latencies, with the nearest rank method
+static double Percentile(const std::vector<double> &sorted, double p)
+{
+    std::size_t rank = (std::size_t)std::ceil(p * sorted.size());
+    return sorted[std::min(sorted.size(), std::max((std::size_t)1, rank)) - 1];
+}
+
+// Splits a comma separated list of integers, e.g. the values of a parameter of the grid
+static std::vector<int> ParseList(const char *list)
+{
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+        if (!value.empty())
+            values.push_back(atoi(value.c_str()));
+    return values;
+}
+
+template <typename T, typename Distance>
+class AnnBench
+{
+private:
+    const Dataset<T> &images;
+    const std::vector<ImageView<T>> &queries;
+    const std::vector<std::vector<Neighbor>> &exact;
+    int k;
+    std::vector<BenchResult> &results;
+
+public:
+    AnnBench(const Dataset<T> &images, const std::vector<ImageView<T>> &queries, const std::vector<std::vector<Neighbor>> &exact,
+             int k, std::vector<BenchResult> &results)
+        : images(images), queries(queries), exact(exact), k(k), results(results) {}
+
+    // Times every query alone for the latencies and the whole set as a batch for the throughput, then compares the
+    // batch results with the exact ones. search(query) answers one query and batch(queries, results) all of them
+    template <typename Search, typename Batch>
+    void Measure(const char *index, const std::string &parameters, double buildSeconds, std::size_t memory, Search search, Batch batch)
+    {
+        std::vector<double> latencies;
+        for (const ImageView<T> &query : queries)
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            search(query);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+
+        std::vector<std::vector<Neighbor>> found;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        batch(queries, found);
+        double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        BenchResult result;
+        result.index = index;
+        result.parameters = parameters;
+        result.buildSeconds = buildSeconds;
+        result.memory = memory;
+        result.qps = queries.size() / batchSeconds;
+        result.mean = 0;
+        for (double latency : latencies)
+            result.mean += latency / latencies.size();
+        result.p50 = Percentile(latencies, 0.50);
+        result.p95 = Percentile(latencies, 0.95);
+        result.p99 = Percentile(latencies, 0.99);
+
+        // An index that returns less than k neighbors loses recall for the missing ones
+        long hits = 0, ratios = 0;
+        result.aaf = 0;
+        result.maf = 0;
+        for (std::size_t q = 0; q < queries.size(); q++)
+        {
+            for (const Neighbor &neighbor : found[q])
+                for (const Neighbor &truth : exact[q])
+                    if (neighbor.id == truth.id)
+                    {
+                        hits++;
+                        break;
+                    }
+            for (std::size_t i = 0; i < found[q].size() && i < exact[q].size(); i++)
+            {
+                double trueDistance = Distance::toDistance(exact[q][i].distance);
+                if (trueDistance <= 0)
+                    continue;
+                double ratio = Distance::toDistance(found[q][i].distance) / trueDistance;
+                result.aaf += ratio;
+                result.maf = std::max(result.maf, ratio);
+                ratios++;
+            }
+        }
+        result.recall = (double)hits / (queries.size() * k);
+        result.aaf = ratios ? result.aaf / ratios : 1.0;
+        if (!ratios)
+            result.maf = 1.0;
+
+        std::cout << std::left << std::setw(11) << result.index << std::setw(28) << result.parameters << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(9) << result.buildSeconds << std::setw(10) << result.memory / 1024
+                  << std::setprecision(4) << std::setw(8) << result.recall << std::setw(8) << result.aaf
+                  << std::setprecision(1) << std::setw(11) << result.qps << std::setw(10) << result.p50 << std::setw(10) << result.p95
+                  << std::setw(10) << result.p99 << std::defaultfloat << std::endl;
+        results.push_back(result);
+    }
+
+    void BruteForce()
+    {
+        Distance distance;
+        Measure("bruteforce", "-", 0, 0, [&](const ImageView<T> &query)
+                { return ::BruteForce(images, query, k, distance); },
+                [&](const std::vector<ImageView<T>> &batch, std::vector<std::vector<Neighbor>> &found)
+                { BruteForceBatch(images, batch, k, distance, found); });
+    }
+
+    void Lsh(const std::vector<int> &numHashFuncs, const std::vector<int> &numHtables, const std::vector<int> &windows, const std::vector<int> &probes)
+    {
+        for (int hashFuncs : numHashFuncs)
+            for (int tables : numHtables)
+                for (int w : windows)
+                    for (int probe : probes)
+                    {
+                        startClock();
+                        ::Lsh<T, Distance> lsh(images, hashFuncs, tables, k, w, std::max<int>(1, images.size() / 8), probe);
+                        double buildSeconds = stopClock().count() * 1e-9;
+
+                        std::ostringstream parameters;
+                        parameters << "k=" << hashFuncs << " L=" << tables << " w=" << w << " probes=" << probe;
+                        Measure("lsh", parameters.str(), buildSeconds, lsh.memoryUsage(), [&](const ImageView<T> &query)
+                                { return lsh.Approximate_kNN(query); },
+                                [&](const std::vector<ImageView<T>> &batch, std::vector<std::vector<Neighbor>> &found)
+                                { lsh.SearchBatch(batch, found, ThreadPool::Default()); });
+                    }
+    }
+
+    void Cube(const std::vector<int> &dimensions, const std::vector<int> &maxCandidates, const std::vector<int> &probes, const std::vector<int> &windows)
+    {
+        for (int dimension : dimensions)
+            for (int w : windows)
+                for (int candidates : maxCandidates)
+                    for (int probe : probes)
+                    {
+                        startClock();
+                        ::Cube<T, Distance> cube(images, w, dimension, candidates, probe, k, 1 << dimension);
+                        double buildSeconds = stopClock().count() * 1e-9;
+
+                        std::ostringstream parameters;
+                        parameters << "k=" << dimension << " w=" << w << " M=" << candidates << " probes=" << probe;
+                        Measure("cube", parameters.str(), buildSeconds, cube.memoryUsage(), [&](const ImageView<T> &query)
+                                { return cube.Approximate_kNN(query); },
+                                [&](const std::vector<ImageView<T>> &batch, std::vector<std::vector<Neighbor>> &found)
+                                { cube.SearchBatch(batch, found, ThreadPool::Default()); });
+                    }
+    }
+
+    // The parameters of the search do not change the graph, so every graph is built once, saved, and loaded again
+    // for every setting of the search
+    void Graph(GraphAlgorithm<T> &graph, const char *index, const std::string &parameters, double buildSeconds)
+    {
+        Measure(index, parameters, buildSeconds, graph.memoryUsage(), [&](const ImageView<T> &query)
+                { return graph.Approximate_kNN(query); },
+                [&](const std::vector<ImageView<T>> &batch, std::vector<std::vector<Neighbor>> &found)
+                { graph.SearchBatch(batch, found, ThreadPool::Default()); });
+    }
+
+    void Gnns(const std::string &graphFile, const std::vector<int> &graphNN, const std::vector<int> &expansions, const std::vector<int> &restarts)
+    {
+        for (int neighbors : graphNN)
+        {
+            double buildSeconds;
+            {
+                startClock();
+                GNNS<T, Distance> gnns(images, neighbors, 1, 1, k);
+                buildSeconds = stopClock().count() * 1e-9;
+                gnns.save(graphFile);
+            }
+
+            for (int expansion : expansions)
+                for (int restart : restarts)
+                {
+                    GNNS<T, Distance> *gnns = GNNS<T, Distance>::load(images, graphFile, expansion, restart, k);
+                    std::ostringstream parameters;
+                    parameters << "k=" << neighbors << " E=" << expansion << " R=" << restart;
+                    Graph(*gnns, "gnns", parameters.str(), buildSeconds);
+                    delete gnns;
+                }
+        }
+    }
+
+    // The build only uses l to link the images the graph does not reach, it gets the largest l of the grid
+    void Mrng(const std::string &graphFile, const std::vector<int> &poolSizes, const std::vector<int> &degrees, const std::vector<int> &candidates)
+    {
+        int buildCandidates = k;
+        for (int l : candidates)
+            buildCandidates = std::max(buildCandidates, l);
+        for (int poolSize : poolSizes)
+            for (int degree : degrees)
+            {
+                double buildSeconds;
+                {
+                    startClock();
+                    ::Mrng<T, Distance> mrng(images, k, buildCandidates, poolSize, degree);
+                    buildSeconds = stopClock().count() * 1e-9;
+                    mrng.save(graphFile);
+                }
+
+                for (int l : candidates)
+                {
+                    if (l < k)
+                        continue;
+                    ::Mrng<T, Distance> *mrng = ::Mrng<T, Distance>::load(images, graphFile, k, l);
+                    std::ostringstream parameters;
+                    parameters << "k=" << poolSize << " degree=" << degree << " l=" << l;
+                    Graph(*mrng, "mrng", parameters.str(), buildSeconds);
+                    delete mrng;
+                }
+            }
+    }
+};
+
+static void WriteCsv(const std::string &path, const std::vector<BenchResult> &results, std::size_t numImages, std::size_t numQueries, int k, int threads)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << path << " for writing." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    file << "index,parameters,images,queries,k,threads,build_s,memory_bytes,recall,aaf,maf,qps,mean_us,p50_us,p95_us,p99_us" << std::endl;
+    file << std::setprecision(8);
+    for (const BenchResult &r : results)
+        file << r.index << "," << r.parameters << "," << numImages << "," << numQueries << "," << k << "," << threads << "," << r.buildSeconds << ","
+             << r.memory << "," << r.recall << "," << r.aaf << "," << r.maf << "," << r.qps << "," << r.mean << "," << r.p50 << ","
+             << r.p95 << "," << r.p99 << std::endl;
+}
+
+// The parameters become an object of integers, e.g. "k=4 L=5" is {"k": 4, "L": 5}
+static void WriteJson(const std::string &path, const std::vector<BenchResult> &results, std::size_t numImages, std::size_t numQueries, int k, int threads)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open " << path << " for writing." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    file << std::setprecision(8);
+    file << "{\"images\": " << numImages << ", \"queries\": " << numQueries << ", \"k\": " << k << ", \"threads\": " << threads << ", \"results\": [";
+    for (std::size_t i = 0; i < results.size(); i++)
+    {
+        const BenchResult &r = results[i];
+        file << (i ? "," : "") << "\n  {\"index\": \"" << r.index << "\", \"parameters\": {";
+        std::stringstream parameters(r.parameters);
+        std::string pair;
+        bool first = true;
+        while (parameters >> pair)
+        {
+            std::size_t equals = pair.find('=');
+            if (equals == std::string::npos)
+                continue;
+            file << (first ? "" : ", ") << "\"" << pair.substr(0, equals) << "\": " << pair.substr(equals + 1);
+            first = false;
+        }
+        file << "}, \"build_s\": " << r.buildSeconds << ", \"memory_bytes\": " << r.memory << ", \"recall\": " << r.recall
+             << ", \"aaf\": " << r.aaf << ", \"maf\": " << r.maf << ", \"qps\": " << r.qps << ", \"mean_us\": " << r.mean
+             << ", \"p50_us\": " << r.p50 << ", \"p95_us\": " << r.p95 << ", \"p99_us\": " << r.p99 << "}";
+    }
+    file << "\n]}" << std::endl;
+}
+
+/**
+ * @brief The options of a run that do not depend on the pixel type
+ *
+ * @param indexes the indexes to measure, in order
+ * @param grid the values of every grid option, in the order of the options of main
+ */
+class BenchOptions
+{
+public:
+    int k;
+    std::string metric;
+    std::string groundTruth;
+    std::vector<std::string> indexes;
+    std::vector<std::vector<int>> grid;
+    std::string graphFile;
+    std::string csvFile;
+    std::string jsonFile;
+};
+
+template <typename T, typename Distance>
+static int Run(const Dataset<T> &images, const std::vector<ImageView<T>> &queries, const BenchOptions &options)
+{
+    Distance distance;
+    std::vector<std::vector<Neighbor>> exact;
+    int k = options.k;
+    const std::vector<std::vector<int>> &grid = options.grid;
+    CachedBruteForce(options.groundTruth, images, queries, k, distance, exact);
+
+    std::cout << "index      parameters                     build s  mem KiB  recall     aaf        qps   p50 us    p95 us    p99 us" << std::endl;
+    std::vector<BenchResult> results;
+    AnnBench<T, Distance> bench(images, queries, exact, k, results);
+    for (const std::string &index : options.indexes)
+    {
+        if (index == "bruteforce")
+            bench.BruteForce();
+        else if (index == "lsh")
+            bench.Lsh(grid[0], grid[1], grid[2], grid[3]);
+        else if (index == "cube")
+            bench.Cube(grid[4], grid[5], grid[6], grid[7]);
+        else if (index == "gnns")
+            bench.Gnns(options.graphFile, grid[8], grid[9], grid[10]);
+        else if (index == "mrng")
+            bench.Mrng(options.graphFile, grid[11], grid[12], grid[13]);
+        else
+        {
+            std::cerr << "Error, unknown index " << index << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::remove(options.graphFile.c_str());
+
+    int threads = ThreadPool::Default().size();
+    if (!options.csvFile.empty())
+        WriteCsv(options.csvFile, results, images.size(), queries.size(), k, threads);
+    if (!options.jsonFile.empty())
+        WriteJson(options.jsonFile, results, images.size(), queries.size(), k, threads);
+    return EXIT_SUCCESS;
+}
+
+// The only runtime dispatch on the metric
+template <typename T>
+static int Run(const Dataset<T> &images, const Dataset<T> &queryImages, const BenchOptions &options)
+{
+    std::vector<ImageView<T>> queries;
+    for (std::size_t q = 0; q < queryImages.size(); q++)
+        queries.push_back(queryImages[q]);
+
+    std::cout << "images: " << images.size() << " dimension: " << images.dimension() << " queries: " << queries.size() << " k: " << options.k
+              << " metric: " << options.metric << " threads: " << ThreadPool::Default().size() << std::endl;
+
+    if (options.metric == EuclideanDistance::name())
+        return Run<T, EuclideanDistance>(images, queries, options);
+    else if (options.metric == ManhattanDistance::name())
+        return Run<T, ManhattanDistance>(images, queries, options);
+
+    std::cerr << "Error, unknown metric " << options.metric << std::endl;
+    return EXIT_FAILURE;
+}
+
+// Runs the indexes over a grid of their parameters and reports for every setting the recall@k, the average and the
+// maximum approximation factor, the queries per second of a batch, the latency percentiles of single queries, the
+// build time and the memory of the index. Every parameter of the grid takes a comma separated list of values, e.g.
+// -lsh-w 1000,2240,4000, and the settings are all the combinations. The results go to stdout, -csv and -json.
+// The files can have any of the DatasetFormats (-format, -dim), byte vectors are searched as uint8_t and others as float
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    std::string format;
+    int dimension = -1;
+    int size = -1;
+    int numQueries = 1000;
+
+    BenchOptions options;
+    options.k = 10;
+    options.metric = EuclideanDistance::name();
+    options.graphFile = "/tmp/ann_bench.graph";
+    options.indexes = {"bruteforce", "lsh", "cube", "gnns", "mrng"};
+
+    // lsh k, L, w, probes | cube k, M, probes, w | gnns k, E, R | mrng k, degree, l
+    const char *gridOptions[] = {"-lsh-k", "-lsh-L", "-lsh-w", "-lsh-probes", "-cube-k", "-cube-M", "-cube-probes", "-cube-w",
+                                 "-gnns-k", "-gnns-E", "-gnns-R", "-mrng-k", "-mrng-degree", "-mrng-l"};
+    options.grid = {{4}, {5}, {1000, 2240, 4000}, {0}, {14}, {1000, 6000}, {2, 15}, {2240},
+                    {40}, {30}, {1, 10}, {40}, {30}, {20, 100, 500}};
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-format"))
+            format = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-dim"))
+            dimension = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            options.k = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-gt"))
+            options.groundTruth = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-metric"))
+            options.metric = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-csv"))
+            options.csvFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-json"))
+            options.jsonFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-graph"))
+            options.graphFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-index"))
+        {
+            options.indexes.clear();
+            std::stringstream list(argv[i + 1]);
+            std::string index;
+            while (std::getline(list, index, ','))
+                options.indexes.push_back(index);
+        }
+        else
+            for (std::size_t option = 0; option < options.grid.size(); option++)
+                if (!strcmp(argv[i], gridOptions[option]))
+                    options.grid[option] = ParseList(argv[i + 1]);
+    }
+    if (options.k < 1)
+    {
+        std::cerr << "Error, the number of nearest neighbors has to be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Byte pixels (MNIST, bvecs) are kept as uint8_t, everything else as float
+    if (!inputFile.empty() && !queryFile.empty())
+    {
+        DatasetLayout queryLayout = ReadLayout(queryFile, format, dimension);
+        numQueries = std::min<std::size_t>(numQueries, queryLayout.numImages);
+        if (ReadLayout(inputFile, format, dimension).element == ElementType::UINT8)
+            return Run(LoadDataset<uint8_t>(inputFile, size, format, dimension), LoadDataset<uint8_t>(queryFile, numQueries, format, dimension), options);
+        return Run(LoadDataset<float>(inputFile, size, format, dimension), LoadDataset<float>(queryFile, numQueries, format, dimension), options);
+    }
+
+    std::size_t numImages = size > 0 ? size : 20000;
+    Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+    return Run(CopyRows(synthetic, 0, numImages), CopyRows(synthetic, numImages, numQueries), options);
+}
@@ -0,0 +1,142 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "Lsh.hpp"
+#include "Cube.hpp"
+#include "Gnns.hpp"
+#include "Mrng.hpp"
+#include "BenchUtils.hpp"
+
+// Whether a batch found the same neighbors as the queries answered one at a time
+static bool SameResults(const std::vector<std::vector<Neighbor>> &first, const std::vector<std::vector<Neighbor>> &second)
+{
+    if (first.size() != second.size())
+        return false;
+    for (std::size_t q = 0; q < first.size(); q++)
+    {
+        if (first[q].size() != second[q].size())
+            return false;
+        for (std::size_t i = 0; i < first[q].size(); i++)
+            if (first[q][i].id != second[q][i].id)
+                return false;
+    }
+    return true;
+}
+
+// Runs the batch with 1, 2, 4, ... threads up to maxThreads and prints the queries per second and the speedup over one
+// thread. The results of every batch are compared with the ones of the queries answered one at a time
+template <typename Index>
+static void Scale(const char *name, Index &index, const std::vector<ImageView<uint8_t>> &queries, int maxThreads)
+{
+    std::vector<std::vector<Neighbor>> sequential;
+    for (const ImageView<uint8_t> &query : queries)
+        sequential.push_back(index.Approximate_kNN(query));
+
+    double qpsOne = 0;
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (int threads : threadCounts)
+    {
+        ThreadPool pool(threads);
+        std::vector<std::vector<Neighbor>> results;
+
+        // One batch to warm up the caches and the threads, then the measured one
+        index.SearchBatch(queries, results, pool);
+        startClock();
+        index.SearchBatch(queries, results, pool);
+        double seconds = stopClock().count() * 1e-9;
+
+        double qps = queries.size() / seconds;
+        if (threads == 1)
+            qpsOne = qps;
+        std::cout << std::left << std::setw(6) << name << "threads " << std::setw(4) << threads << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << qps << " queries/s  speedup " << std::setprecision(2) << qps / qpsOne << "x";
+        std::cout << (SameResults(results, sequential) ? "  same results" : "  DIFFERENT RESULTS") << std::endl;
+    }
+}
+
+// Measures how the queries per second of SearchBatch scale with the number of threads for every algorithm
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    int size = -1;
+    int numQueries = 1000;
+    int numNn = 10;
+    int maxThreads = ThreadPool::HardwareThreads();
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            numNn = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            maxThreads = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+    }
+
+    Dataset<uint8_t> syntheticInput, syntheticQueries;
+    FileParser<uint8_t> *inputParser = nullptr, *queryParser = nullptr;
+    if (!inputFile.empty())
+        inputParser = new FileParser<uint8_t>(inputFile, size);
+    if (!queryFile.empty())
+        queryParser = new FileParser<uint8_t>(queryFile, numQueries);
+    if (!inputParser || !queryParser)
+    {
+        std::size_t numImages = size > 0 ? size : 20000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+        syntheticInput = CopyRows(synthetic, 0, numImages);
+        syntheticQueries = CopyRows(synthetic, numImages, numQueries);
+    }
+    const Dataset<uint8_t> &images = inputParser ? inputParser->GetImages() : syntheticInput;
+    const Dataset<uint8_t> &queryImages = queryParser ? queryParser->GetImages() : syntheticQueries;
+
+    std::vector<ImageView<uint8_t>> queries;
+    for (std::size_t q = 0; q < queryImages.size(); q++)
+        queries.push_back(queryImages[q]);
+
+    std::cout << "images: " << images.size() << " queries: " << queries.size() << " cores: " << ThreadPool::HardwareThreads()
+              << " max threads: " << maxThreads << std::endl;
+
+    {
+        Lsh<uint8_t, EuclideanDistance> lsh(images, 4, 5, numNn, 2240, images.size() / 8);
+        Scale("lsh", lsh, queries, maxThreads);
+    }
+    {
+        Cube<uint8_t, EuclideanDistance> cube(images, 40, 14, 6000, 15, numNn, 1 << 14);
+        Scale("cube", cube, queries, maxThreads);
+    }
+    {
+        GNNS<uint8_t, EuclideanDistance> gnns(images, 40, 30, 10, numNn);
+        Scale("gnns", gnns, queries, maxThreads);
+    }
+    {
+        Mrng<uint8_t, EuclideanDistance> mrng(images, numNn, 100, 30, 30);
+        Scale("mrng", mrng, queries, maxThreads);
+    }
+
+    delete inputParser;
+    delete queryParser;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+#include <cmath>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "DimensionOrder.hpp"
+#include "BenchUtils.hpp"
+
+// Copies the pixels of a dataset to another pixel type, shifted by offset
+template <typename T>
+static Dataset<T> Convert(const Dataset<uint8_t> &images, T offset = 0)
+{
+    Dataset<T> converted(images.size(), images.dimension());
+    for (std::size_t i = 0; i < images.size(); i++)
+        for (std::size_t j = 0; j < images.dimension(); j++)
+            converted.row(i)[j] = (T)images.row(i)[j] + offset;
+    return converted;
+}
+
+// Runs the exact search of every query with the brute force of one query at a time, as the programs did before, and
+// with the batch, then checks that both found the same distances
+template <typename T, typename Distance>
+static bool Compare(const char *type, const Dataset<T> &images, const Dataset<T> &queryImages, int k)
+{
+    Distance distance;
+    std::vector<ImageView<T>> queries;
+    for (std::size_t q = 0; q < queryImages.size(); q++)
+        queries.push_back(queryImages[q]);
+
+    std::vector<std::vector<Neighbor>> single(queries.size()), batch;
+    startClock();
+    ThreadPool::Default().ParallelFor(queries.size(), [&](std::size_t q, int)
+                                      { single[q] = BruteForce(images, queries[q], k, distance); });
+    double singleSeconds = stopClock().count() * 1e-9;
+
+    startClock();
+    BruteForceBatch(images, queries, k, distance, batch);
+    double batchSeconds = stopClock().count() * 1e-9;
+
+    // Images at equal distance can be in any order, so the distances are compared and not the ids
+    double maxError = 0;
+    bool same = true;
+    for (std::size_t q = 0; q < queries.size(); q++)
+    {
+        same = same && single[q].size() == batch[q].size();
+        for (std::size_t i = 0; same && i < single[q].size(); i++)
+            maxError = std::max(maxError, std::fabs(single[q][i].distance - batch[q][i].distance) / std::max(1.0, single[q][i].distance));
+    }
+    same = same && maxError <= 1e-5;
+
+    std::cout << std::left << std::setw(10) << Distance::name() << std::setw(8) << type << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << queries.size() / singleSeconds << std::setw(12) << queries.size() / batchSeconds
+              << std::setw(9) << std::setprecision(2) << singleSeconds / batchSeconds << "x"
+              << std::setw(13) << std::scientific << maxError << std::defaultfloat << (same ? "  same" : "  DIFFERENT") << std::endl;
+    return same;
+}
+
+// Measures the queries per second of the exact search of a query set, one brute force per query against the batch
+// that compares tiles of queries with tiles of images
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    int size = -1;
+    int numQueries = 1000;
+    int k = 10;
+    bool reorder = false;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            k = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-reorder"))
+            reorder = true;
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+    }
+
+    Dataset<uint8_t> syntheticInput, syntheticQueries;
+    FileParser<uint8_t> *inputParser = nullptr, *queryParser = nullptr;
+    if (!inputFile.empty())
+        inputParser = new FileParser<uint8_t>(inputFile, size);
+    if (!queryFile.empty())
+        queryParser = new FileParser<uint8_t>(queryFile, numQueries);
+    if (!inputParser || !queryParser)
+    {
+        std::size_t numImages = size > 0 ? size : 20000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+        syntheticInput = CopyRows(synthetic, 0, numImages);
+        syntheticQueries = CopyRows(synthetic, numImages, numQueries);
+    }
+    const Dataset<uint8_t> *images = inputParser ? &inputParser->GetImages() : &syntheticInput;
+    const Dataset<uint8_t> *queries = queryParser ? &queryParser->GetImages() : &syntheticQueries;
+
+    // With -reorder the pixels of the images and of the queries are put in the order of decreasing variance, the
+    // distances are the same but the bounded ones of the single queries are abandoned after fewer pixels
+    Dataset<uint8_t> reorderedImages, reorderedQueries;
+    if (reorder)
+    {
+        DimensionOrder order(*images);
+        reorderedImages = order.Reorder(*images);
+        reorderedQueries = order.Reorder(*queries);
+        images = &reorderedImages;
+        queries = &reorderedQueries;
+    }
+
+    std::cout << "images: " << images->size() << " queries: " << queries->size() << " k: " << k
+              << " threads: " << ThreadPool::Default().size() << " kernels: " << ActiveKernels().name
+              << (reorder ? " reordered" : "") << std::endl;
+    std::cout << "metric    type      single q/s   batch q/s  speedup  max rel error" << std::endl;
+
+    bool passed = true;
+    passed = Compare<uint8_t, EuclideanDistance>("uint8", *images, *queries, k) && passed;
+    passed = Compare<uint8_t, ManhattanDistance>("uint8", *images, *queries, k) && passed;
+    {
+        Dataset<float> floatImages = Convert<float>(*images), floatQueries = Convert<float>(*queries);
+        passed = Compare<float, EuclideanDistance>("float", floatImages, floatQueries, k) && passed;
+        passed = Compare<float, ManhattanDistance>("float", floatImages, floatQueries, k) && passed;
+    }
+    {
+        // The same distances with norms 10^5 times larger, the expanded distances of the batch lose most of their digits
+        Dataset<float> farImages = Convert<float>(*images, 1e5f), farQueries = Convert<float>(*queries, 1e5f);
+        passed = Compare<float, EuclideanDistance>("far", farImages, farQueries, k) && passed;
+    }
+    {
+        Dataset<double> doubleImages = Convert<double>(*images), doubleQueries = Convert<double>(*queries);
+        passed = Compare<double, EuclideanDistance>("double", doubleImages, doubleQueries, k) && passed;
+    }
+
+    delete inputParser;
+    delete queryParser;
+    if (!passed)
+    {
+        std::cerr << "The batch found other neighbors than the brute force of one query" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
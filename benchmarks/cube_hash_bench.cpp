@@ -0,0 +1,159 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <string>
+#include <bitset>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "DatasetLoader.hpp"
+#include "ThreadPool.hpp"
+#include "ProjectionMatrix.hpp"
+#include "VertexHash.hpp"
+#include "BenchUtils.hpp"
+
+// The f_i functions of the Cube before VertexHash: one map per function remembers the bit drawn for every h_i value,
+// the bits are written to a string and the string is parsed as a binary number. A value that no image has gets its
+// lowest bit for a query
+class StringMapHash
+{
+private:
+    int dimension;
+    std::vector<std::unordered_map<int, int>> map;
+
+public:
+    explicit StringMapHash(int dimension) : dimension(dimension), map(dimension) {}
+
+    int operator()(const uint64_t *hashes, bool inserting)
+    {
+        std::string res = "";
+        for (int i = 0; i < dimension; i++)
+        {
+            int hash = hashes[i];
+            auto bit = map[i].find(hash);
+            if (bit != map[i].end())
+                res += std::to_string(bit->second);
+            else if (inserting)
+                res += std::to_string(map[i][hash] = IntDistribution(0, 1));
+            else
+                res += std::to_string(hash & 1);
+        }
+        return std::bitset<32>(res).to_ulong();
+    }
+};
+
+// The number of buckets with an image and the images of the largest bucket, to see that both spread the images alike
+static void Occupancy(const std::vector<int> &vertices, int dimension, int &used, int &largest)
+{
+    std::vector<int> sizes(1 << dimension);
+    for (int v : vertices)
+        sizes[v]++;
+    used = sizes.size() - std::count(sizes.begin(), sizes.end(), 0);
+    largest = *std::max_element(sizes.begin(), sizes.end());
+}
+
+// Compares the throughput of the f_i functions of a Cube with a map and a string per hash and with the stateless
+// VertexHash, for the inserts of the images and for the queries. The h_i values are computed once beforehand, so only
+// the f_i functions are timed
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    int size = -1;
+    int dimension = 14;
+    int w = 2240;
+    int repeats = 20;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-k"))
+            dimension = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-w"))
+            w = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-r"))
+            repeats = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+    }
+
+    // The last 10% of the images are the queries
+    Dataset<uint8_t> images = inputFile.empty() ? SyntheticDataset<uint8_t>(size > 0 ? size : 20000, 784)
+                                                : LoadDataset<uint8_t>(inputFile, size);
+    std::size_t numQueries = images.size() / 10, numInserts = images.size() - numQueries;
+
+    ProjectionMatrix projections(images.dimension(), w);
+    for (int i = 0; i < dimension; i++)
+    {
+        std::vector<double> v;
+        for (std::size_t j = 0; j < images.dimension(); j++)
+            v.push_back(NormalDistribution(0.0, 1.0));
+        projections.AddFunction(v, RealDistribution(0, w));
+    }
+    std::vector<uint64_t> hashes;
+    projections.hashBatch(images, 0, images.size(), hashes, ThreadPool::Default());
+    const std::size_t stride = projections.blockSize();
+
+    std::cout << "images: " << numInserts << " queries: " << numQueries << " k: " << dimension << " w: " << w
+              << " threads: " << ThreadPool::Default().size() << std::endl;
+    std::cout << "f_i          inserts/s     queries/s  batch queries/s  used buckets  largest bucket" << std::endl;
+
+    // The maps are filled by the inserts, so every repeat of the inserts starts from empty maps
+    std::vector<int> vertices(numInserts);
+    double tInsert = 0;
+    StringMapHash stringMap(dimension);
+    for (int r = 0; r < repeats; r++)
+    {
+        StringMapHash fresh(dimension);
+        startClock();
+        for (std::size_t i = 0; i < numInserts; i++)
+            vertices[i] = fresh(hashes.data() + i * stride, true);
+        tInsert += stopClock().count() * 1e-9;
+        if (r == repeats - 1)
+            stringMap = fresh;
+    }
+    int used, largest;
+    Occupancy(vertices, dimension, used, largest);
+
+    // The queries of the string map only read the maps, but every query builds and parses a string
+    long checksum = 0;
+    startClock();
+    for (int r = 0; r < repeats; r++)
+        for (std::size_t q = numInserts; q < images.size(); q++)
+            checksum += stringMap(hashes.data() + q * stride, false);
+    double tQuery = stopClock().count() * 1e-9;
+    std::cout << std::left << std::setw(12) << "string map" << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << repeats * numInserts / tInsert << std::setw(14) << repeats * numQueries / tQuery
+              << std::setw(17) << "-" << std::setw(14) << used << std::setw(16) << largest << std::endl;
+
+    VertexHash vertex(dimension);
+    startClock();
+    for (int r = 0; r < repeats; r++)
+        for (std::size_t i = 0; i < numInserts; i++)
+            vertices[i] = vertex(hashes.data() + i * stride);
+    tInsert = stopClock().count() * 1e-9;
+    Occupancy(vertices, dimension, used, largest);
+
+    startClock();
+    for (int r = 0; r < repeats; r++)
+        for (std::size_t q = numInserts; q < images.size(); q++)
+            checksum -= vertex(hashes.data() + q * stride);
+    tQuery = stopClock().count() * 1e-9;
+
+    // VertexHash has no state, so the queries can be hashed by all the threads at once without a lock
+    std::vector<int> batch(numQueries);
+    startClock();
+    for (int r = 0; r < repeats; r++)
+        ThreadPool::Default().ParallelFor(numQueries, [&](std::size_t q, int)
+                                          { batch[q] = vertex(hashes.data() + (numInserts + q) * stride); });
+    double tBatch = stopClock().count() * 1e-9;
+    std::cout << std::left << std::setw(12) << "vertex hash" << std::right << std::setw(12) << repeats * numInserts / tInsert
+              << std::setw(14) << repeats * numQueries / tQuery << std::setw(17) << repeats * numQueries / tBatch
+              << std::setw(14) << used << std::setw(16) << largest << std::defaultfloat << (checksum == 0 ? "" : " ") << std::endl;
+    return EXIT_SUCCESS;
+}
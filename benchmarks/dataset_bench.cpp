@@ -0,0 +1,206 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "DistanceKernels.hpp"
+#include "BenchUtils.hpp"
+
+// The storage layout that Dataset replaced: one heap allocated object per image, each with its own pixel vector
+class LegacyImage
+{
+public:
+    int id;
+    std::vector<double> pixels;
+};
+
+// Size of the bookkeeping header glibc's malloc keeps in front of every allocated block
+static const std::size_t MallocOverhead = 16;
+
+// Both layouts are scanned with the same kernel. It keeps four independent partial sums so that the scan is limited
+// by how fast the rows reach the core and not by the latency of a single chain of additions
+static inline double SquaredDistance(const double *first, const double *second, std::size_t dim)
+{
+    double sum[4] = {0.0, 0.0, 0.0, 0.0};
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4)
+        for (int lane = 0; lane < 4; lane++)
+        {
+            double difference = first[i + lane] - second[i + lane];
+            sum[lane] += difference * difference;
+        }
+    for (; i < dim; i++)
+        sum[0] += (first[i] - second[i]) * (first[i] - second[i]);
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+static double LegacyScan(const std::vector<LegacyImage *> &images, const std::vector<double> &query)
+{
+    double best = -1;
+    for (const LegacyImage *image : images)
+    {
+        double result = SquaredDistance(image->pixels.data(), query.data(), image->pixels.size());
+        if (best < 0 || result < best)
+            best = result;
+    }
+    return best;
+}
+
+static double DatasetScan(const Dataset<double> &images, const double *query)
+{
+    double best = -1;
+    for (std::size_t n = 0; n < images.size(); n++)
+    {
+        double result = SquaredDistance(images.row(n), query, images.dimension());
+        if (best < 0 || result < best)
+            best = result;
+    }
+    return best;
+}
+
+// The one byte pixels are scanned with the integer kernel the algorithms use
+static double CompactScan(const Dataset<uint8_t> &images, const uint8_t *query)
+{
+    double best = -1;
+    for (std::size_t n = 0; n < images.size(); n++)
+    {
+        double result = (double)SquaredEuclideanKernel(images.row(n), query, images.dimension());
+        if (best < 0 || result < best)
+            best = result;
+    }
+    return best;
+}
+
+// Compares the memory footprint and the sequential scan throughput of the old per-image allocations with Dataset
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    int size = 60000;
+    int dimension = 784;
+    int numQueries = 20;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-dim"))
+            dimension = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            numQueries = atoi(argv[i + 1]);
+    }
+
+    Dataset<double> synthetic;
+    FileParser<double> *parser = nullptr;
+    if (!inputFile.empty())
+        parser = new FileParser<double>(inputFile, size);
+    else
+        synthetic = SyntheticDataset<double>(size, dimension);
+    const Dataset<double> &images = parser ? parser->GetImages() : synthetic;
+
+    std::size_t n = images.size(), dim = images.dimension();
+
+    // The legacy images are allocated once in id order, like FileParser did, and once in a random order.
+    // The second copy models a heap where the blocks of consecutive ids ended up far apart
+    std::vector<LegacyImage *> legacy(n), scattered(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        legacy[i] = new LegacyImage;
+        legacy[i]->id = i;
+        legacy[i]->pixels.assign(images.row(i), images.row(i) + dim);
+    }
+    std::vector<std::size_t> order(n);
+    for (std::size_t i = 0; i < n; i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(7));
+    for (std::size_t i : order)
+    {
+        scattered[i] = new LegacyImage;
+        scattered[i]->id = i;
+        scattered[i]->pixels.assign(images.row(i), images.row(i) + dim);
+    }
+
+    std::size_t legacyBytes = n * (sizeof(LegacyImage) + dim * sizeof(double) + 2 * MallocOverhead) + n * sizeof(LegacyImage *);
+    std::size_t datasetBytes = images.memoryUsage() + sizeof(Dataset<double>);
+
+    // The same pixels in their original one byte form
+    Dataset<uint8_t> compact(n, dim);
+    for (std::size_t i = 0; i < n; i++)
+        for (std::size_t j = 0; j < dim; j++)
+            compact.row(i)[j] = (uint8_t)images.row(i)[j];
+    std::size_t compactBytes = compact.memoryUsage() + sizeof(Dataset<uint8_t>);
+
+    std::cout << "images: " << n << " dimension: " << dim << std::endl;
+    std::cout << "legacy heap blocks: " << 2 * n << " bytes: " << legacyBytes << std::endl;
+    std::cout << "dataset heap blocks: 1 bytes: " << datasetBytes << std::endl;
+    std::cout << "memory saved: " << (double)(legacyBytes - datasetBytes) / (1 << 20) << " MiB ("
+              << 100.0 * (legacyBytes - datasetBytes) / legacyBytes << "%)" << std::endl;
+    std::cout << "uint8 dataset bytes: " << compactBytes << ", memory saved: " << (double)(legacyBytes - compactBytes) / (1 << 20) << " MiB ("
+              << 100.0 * (legacyBytes - compactBytes) / legacyBytes << "%)" << std::endl;
+
+    // Every query is a full scan over the dataset, the queries are rows of the dataset itself.
+    // Both layouts are timed alternately a few times and the best run of each is kept
+    double checkLegacy = 0, checkScattered = 0, checkDataset = 0, checkCompact = 0;
+    double tLegacy = -1, tScattered = -1, tDataset = -1, tCompact = -1;
+    for (int repeat = 0; repeat < 3; repeat++)
+    {
+        checkLegacy = checkScattered = checkDataset = checkCompact = 0;
+
+        startClock();
+        for (int q = 0; q < numQueries; q++)
+            checkLegacy += LegacyScan(legacy, legacy[(q * 7919) % n]->pixels);
+        double elapsed = stopClock().count() * 1e-9;
+        if (tLegacy < 0 || elapsed < tLegacy)
+            tLegacy = elapsed;
+
+        startClock();
+        for (int q = 0; q < numQueries; q++)
+            checkScattered += LegacyScan(scattered, scattered[(q * 7919) % n]->pixels);
+        elapsed = stopClock().count() * 1e-9;
+        if (tScattered < 0 || elapsed < tScattered)
+            tScattered = elapsed;
+
+        startClock();
+        for (int q = 0; q < numQueries; q++)
+            checkDataset += DatasetScan(images, images.row((q * 7919) % n));
+        elapsed = stopClock().count() * 1e-9;
+        if (tDataset < 0 || elapsed < tDataset)
+            tDataset = elapsed;
+
+        startClock();
+        for (int q = 0; q < numQueries; q++)
+            checkCompact += CompactScan(compact, compact.row((q * 7919) % n));
+        elapsed = stopClock().count() * 1e-9;
+        if (tCompact < 0 || elapsed < tCompact)
+            tCompact = elapsed;
+    }
+
+    double scannedBytes = (double)numQueries * n * dim * sizeof(double);
+    std::cout << "legacy scan: " << tLegacy << " s, " << scannedBytes / tLegacy / 1e9 << " GB/s" << std::endl;
+    std::cout << "legacy scattered scan: " << tScattered << " s, " << scannedBytes / tScattered / 1e9 << " GB/s" << std::endl;
+    std::cout << "dataset scan: " << tDataset << " s, " << scannedBytes / tDataset / 1e9 << " GB/s" << std::endl;
+    std::cout << "uint8 dataset scan: " << tCompact << " s, " << (double)numQueries * n / tCompact << " images/s" << std::endl;
+    std::cout << "scan speedup: " << tLegacy / tDataset << "x (scattered: " << tScattered / tDataset << "x, uint8: "
+              << tLegacy / tCompact << "x)" << std::endl;
+
+    if (checkLegacy != checkDataset || checkScattered != checkDataset || checkCompact != checkDataset)
+    {
+        std::cerr << "Error, the two layouts returned different distances" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    for (std::size_t i = 0; i < n; i++)
+    {
+        delete legacy[i];
+        delete scattered[i];
+    }
+    delete parser;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,297 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "CpuFeatures.hpp"
+#include "SimdKernels.hpp"
+#include "DistanceKernels.hpp"
+
+// Picks the kernel of a table for a pixel type and a metric
+template <typename T>
+class KernelSelector;
+
+template <>
+class KernelSelector<uint8_t>
+{
+public:
+    typedef uint64_t (*Kernel)(const uint8_t *, const uint8_t *, std::size_t);
+    static Kernel get(const DistanceKernelTable &table, bool euclidean) { return euclidean ? table.squaredEuclideanU8 : table.manhattanU8; }
+    static void (*innerProducts(const DistanceKernelTable &table))(const uint8_t *, const uint8_t *const *, std::size_t, uint64_t *) { return table.innerProductsU8; }
+    static void (*project(const DistanceKernelTable &table))(const double *, std::size_t, const uint8_t *, std::size_t, double *) { return table.projectU8; }
+    static const char *name() { return "uint8"; }
+    static double tolerance() { return 0.0; }
+};
+
+template <>
+class KernelSelector<float>
+{
+public:
+    typedef float (*Kernel)(const float *, const float *, std::size_t);
+    static Kernel get(const DistanceKernelTable &table, bool euclidean) { return euclidean ? table.squaredEuclideanF32 : table.manhattanF32; }
+    static void (*innerProducts(const DistanceKernelTable &table))(const float *, const float *const *, std::size_t, float *) { return table.innerProductsF32; }
+    static void (*project(const DistanceKernelTable &table))(const double *, std::size_t, const float *, std::size_t, double *) { return table.projectF32; }
+    typedef float (*BoundedKernel)(const float *, const float *, std::size_t, float);
+    static BoundedKernel bounded(const DistanceKernelTable &table, bool euclidean) { return euclidean ? table.boundedSquaredEuclideanF32 : table.boundedManhattanF32; }
+    static const char *name() { return "float"; }
+    static double tolerance() { return 1e-4; }
+};
+
+template <>
+class KernelSelector<double>
+{
+public:
+    typedef double (*Kernel)(const double *, const double *, std::size_t);
+    static Kernel get(const DistanceKernelTable &table, bool euclidean) { return euclidean ? table.squaredEuclideanF64 : table.manhattanF64; }
+    static void (*innerProducts(const DistanceKernelTable &table))(const double *, const double *const *, std::size_t, double *) { return table.innerProductsF64; }
+    static void (*project(const DistanceKernelTable &table))(const double *, std::size_t, const double *, std::size_t, double *) { return table.projectF64; }
+    typedef double (*BoundedKernel)(const double *, const double *, std::size_t, double);
+    static BoundedKernel bounded(const DistanceKernelTable &table, bool euclidean) { return euclidean ? table.boundedSquaredEuclideanF64 : table.boundedManhattanF64; }
+    static const char *name() { return "double"; }
+    static double tolerance() { return 1e-12; }
+};
+
+// Runs every supported kernel for one pixel type, dimension and metric. Returns false if a kernel disagrees with the reference
+template <typename T>
+static bool RunCase(const std::vector<const DistanceKernelTable *> &tables, std::size_t numImages, std::size_t dim, bool euclidean, int repeats)
+{
+    std::mt19937 generator(dim);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::uniform_real_distribution<double> fraction(0.0, 1.0);
+
+    // The dataset has one more row than needed, the query sits at an odd offset so the loads are unaligned
+    Dataset<T> images(numImages + 1, dim);
+    for (std::size_t i = 0; i <= numImages; i++)
+        for (std::size_t j = 0; j < dim; j++)
+            images.row(i)[j] = (T)(pixel(generator) + (std::is_integral<T>::value ? 0.0 : fraction(generator)));
+    std::vector<T> queryBuffer(dim + 1);
+    T *query = queryBuffer.data() + 1;
+    std::memcpy(query, images.row(numImages), dim * sizeof(T));
+
+    // The reference is the plain loop of the repo, evaluated in double
+    std::vector<double> reference(numImages);
+    for (std::size_t i = 0; i < numImages; i++)
+    {
+        std::vector<double> a(images.row(i), images.row(i) + dim), b(query, query + dim);
+        reference[i] = euclidean ? SquaredEuclideanKernel(a.data(), b.data(), dim) : ManhattanKernel(a.data(), b.data(), dim);
+    }
+
+    bool passed = true;
+    double scalarTime = 0;
+    for (const DistanceKernelTable *table : tables)
+    {
+        typename KernelSelector<T>::Kernel kernel = KernelSelector<T>::get(*table, euclidean);
+
+        double maxError = 0;
+        for (std::size_t i = 0; i < numImages; i++)
+        {
+            double error = std::fabs((double)kernel(images.row(i), query, dim) - reference[i]) / std::max(1.0, reference[i]);
+            maxError = std::max(maxError, error);
+        }
+
+        double checksum = 0;
+        startClock();
+        for (int r = 0; r < repeats; r++)
+            for (std::size_t i = 0; i < numImages; i++)
+                checksum += kernel(images.row(i), query, dim);
+        double elapsed = stopClock().count() * 1e-9;
+        if (table == tables[0])
+            scalarTime = elapsed;
+
+        bool ok = maxError <= KernelSelector<T>::tolerance();
+        passed = passed && ok;
+
+        double perDistance = elapsed / ((double)repeats * numImages);
+        std::cout << std::left << std::setw(10) << (euclidean ? "euclidean" : "manhattan") << std::setw(8) << KernelSelector<T>::name()
+                  << std::setw(6) << dim << std::setw(8) << table->name << std::right
+                  << std::setw(10) << std::fixed << std::setprecision(1) << perDistance * 1e9 << " ns"
+                  << std::setw(9) << std::setprecision(2) << scalarTime / elapsed << "x"
+                  << std::setw(13) << std::scientific << std::setprecision(2) << maxError << (ok ? "  ok" : "  MISMATCH")
+                  << std::defaultfloat << (checksum < 0 ? " " : "") << std::endl;
+    }
+    return passed;
+}
+
+// Checks the inner product kernels of every table against the products evaluated in double, for every dimension
+// up to maxDim so that all the tails of the vector loops are covered
+template <typename T>
+static bool CheckInnerProducts(const std::vector<const DistanceKernelTable *> &tables, std::size_t maxDim)
+{
+    std::mt19937 generator(maxDim);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    Dataset<T> rows(InnerProductTile + 1, maxDim);
+    for (std::size_t i = 0; i <= InnerProductTile; i++)
+        for (std::size_t j = 0; j < maxDim; j++)
+            rows.row(i)[j] = (T)pixel(generator);
+    const T *queries[InnerProductTile];
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        queries[j] = rows.row(j + 1);
+
+    bool passed = true;
+    for (const DistanceKernelTable *table : tables)
+    {
+        double maxError = 0;
+        for (std::size_t dim = 1; dim <= maxDim; dim++)
+        {
+            typename KernelTraits<T, T>::Sum products[InnerProductTile];
+            KernelSelector<T>::innerProducts(*table)(rows.row(0), queries, dim, products);
+            for (std::size_t j = 0; j < InnerProductTile; j++)
+            {
+                double reference = 0;
+                for (std::size_t i = 0; i < dim; i++)
+                    reference += (double)rows.row(0)[i] * (double)queries[j][i];
+                maxError = std::max(maxError, std::fabs((double)products[j] - reference) / std::max(1.0, reference));
+            }
+        }
+        bool ok = maxError <= KernelSelector<T>::tolerance();
+        passed = passed && ok;
+        std::cout << std::left << std::setw(10) << "inner" << std::setw(8) << KernelSelector<T>::name() << std::setw(6) << maxDim
+                  << std::setw(8) << table->name << std::right << std::setw(35) << std::scientific << std::setprecision(2) << maxError
+                  << (ok ? "  ok" : "  MISMATCH") << std::defaultfloat << std::endl;
+    }
+    return passed;
+}
+
+// Checks the project kernels of every table against ProjectKernel for every dimension up to maxDim and for 1 to 3
+// blocks of rows. The kernels sum every row in the order of the values like ProjectKernel, so they must be exact
+template <typename T>
+static bool CheckProjections(const std::vector<const DistanceKernelTable *> &tables, std::size_t maxDim)
+{
+    std::mt19937 generator(maxDim + 1);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    const std::size_t maxBlocks = 3;
+    std::vector<double> matrix(maxBlocks * maxDim * ProjectionBlock);
+    for (double &value : matrix)
+        value = normal(generator);
+    std::vector<T> x(maxDim + 1);
+    for (T &value : x)
+        value = (T)pixel(generator);
+
+    bool passed = true;
+    for (const DistanceKernelTable *table : tables)
+    {
+        double maxError = 0;
+        for (std::size_t numBlocks = 1; numBlocks <= maxBlocks; numBlocks++)
+            for (std::size_t dim = 1; dim <= maxDim; dim++)
+            {
+                double result[maxBlocks * ProjectionBlock], reference[maxBlocks * ProjectionBlock];
+                // The vector starts at an odd offset so the loads are unaligned
+                KernelSelector<T>::project(*table)(matrix.data(), numBlocks, x.data() + 1, dim, result);
+                ProjectKernel(matrix.data(), numBlocks, x.data() + 1, dim, reference);
+                for (std::size_t r = 0; r < numBlocks * ProjectionBlock; r++)
+                    maxError = std::max(maxError, std::fabs(result[r] - reference[r]));
+            }
+        bool ok = maxError == 0.0;
+        passed = passed && ok;
+        std::cout << std::left << std::setw(10) << "project" << std::setw(8) << KernelSelector<T>::name() << std::setw(6) << maxDim
+                  << std::setw(8) << table->name << std::right << std::setw(35) << std::scientific << std::setprecision(2) << maxError
+                  << (ok ? "  ok" : "  MISMATCH") << std::defaultfloat << std::endl;
+    }
+    return passed;
+}
+
+// Checks the bounded float kernels of every table against the unbounded ones of the same table for every dimension up
+// to maxDim. A distance at most the bound must be the one of the unbounded kernel to the bit, and with half of the
+// distance as bound the kernel must return a value larger than the bound
+template <typename T>
+static bool CheckBounded(const std::vector<const DistanceKernelTable *> &tables, std::size_t maxDim, bool euclidean)
+{
+    std::mt19937 generator(maxDim + 2);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::vector<T> a(maxDim + 1), b(maxDim + 1);
+    for (std::size_t i = 0; i <= maxDim; i++)
+    {
+        a[i] = (T)(pixel(generator) / 7.0);
+        b[i] = (T)(pixel(generator) / 7.0);
+    }
+
+    bool passed = true;
+    for (const DistanceKernelTable *table : tables)
+    {
+        typename KernelSelector<T>::Kernel kernel = KernelSelector<T>::get(*table, euclidean);
+        typename KernelSelector<T>::BoundedKernel bounded = KernelSelector<T>::bounded(*table, euclidean);
+        std::size_t mismatches = 0;
+        for (std::size_t dim = 1; dim <= maxDim; dim++)
+        {
+            // The vectors start at an odd offset so the loads are unaligned
+            T exact = kernel(a.data() + 1, b.data() + 1, dim);
+            mismatches += bounded(a.data() + 1, b.data() + 1, dim, std::numeric_limits<T>::infinity()) != exact;
+            mismatches += bounded(a.data() + 1, b.data() + 1, dim, exact) != exact;
+            mismatches += !(bounded(a.data() + 1, b.data() + 1, dim, exact / 2) > exact / 2);
+        }
+        bool ok = mismatches == 0;
+        passed = passed && ok;
+        std::cout << std::left << std::setw(10) << (euclidean ? "l2 bound" : "l1 bound") << std::setw(8) << KernelSelector<T>::name()
+                  << std::setw(6) << maxDim << std::setw(8) << table->name << std::right << std::setw(35) << mismatches
+                  << (ok ? "  ok" : "  MISMATCH") << std::endl;
+    }
+    return passed;
+}
+
+// Compares the vectorized distance kernels of every instruction set the CPU supports with the scalar loop
+// at the MNIST (784) and GIST (960) dimensions and checks that they return the same distances
+int main(int argc, char const *argv[])
+{
+    int numImages = 2000;
+    int repeats = 50;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-n"))
+            numImages = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-r"))
+            repeats = atoi(argv[i + 1]);
+    }
+
+    const CpuFeatures &cpu = CpuFeatures::get();
+    std::vector<const DistanceKernelTable *> tables;
+    tables.push_back(ScalarKernels());
+    if (cpu.sse2 && Sse2Kernels())
+        tables.push_back(Sse2Kernels());
+    if (cpu.avx2 && Avx2Kernels())
+        tables.push_back(Avx2Kernels());
+    if (cpu.avx512 && Avx512Kernels())
+        tables.push_back(Avx512Kernels());
+
+    std::cout << "active kernels: " << ActiveKernels().name << std::endl;
+    std::cout << "metric    type    dim   isa     time/distance  speedup  max rel error" << std::endl;
+
+    bool passed = true;
+    const std::size_t dimensions[] = {784, 960};
+    for (std::size_t dim : dimensions)
+        for (int metric = 0; metric < 2; metric++)
+        {
+            passed = RunCase<uint8_t>(tables, numImages, dim, metric == 0, repeats) && passed;
+            passed = RunCase<float>(tables, numImages, dim, metric == 0, repeats) && passed;
+            passed = RunCase<double>(tables, numImages, dim, metric == 0, repeats) && passed;
+        }
+
+    passed = CheckInnerProducts<uint8_t>(tables, 200) && passed;
+    passed = CheckInnerProducts<float>(tables, 200) && passed;
+    passed = CheckInnerProducts<double>(tables, 200) && passed;
+
+    passed = CheckProjections<uint8_t>(tables, 100) && passed;
+    passed = CheckProjections<float>(tables, 100) && passed;
+    passed = CheckProjections<double>(tables, 100) && passed;
+
+    for (int metric = 0; metric < 2; metric++)
+    {
+        passed = CheckBounded<float>(tables, 600, metric == 0) && passed;
+        passed = CheckBounded<double>(tables, 600, metric == 0) && passed;
+    }
+
+    if (!passed)
+    {
+        std::cerr << "Error, a vectorized kernel does not match the scalar loop" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cmath>
+#include <vector>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "DatasetLoader.hpp"
+#include "ThreadPool.hpp"
+#include "ProjectionMatrix.hpp"
+#include "BenchUtils.hpp"
+
+// Compares the hashing of the images by every function on its own, one dot product with the vector of the function
+// per image as before the projection matrix, with the projection matrix: the whole dataset in batches like the build
+// of an Lsh or a Cube and one query at a time like a search. Both must give the same hashes
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    int size = -1;
+    int numQueries = 1000;
+    int w = 2240;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-Q"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-w"))
+            w = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+    }
+
+    Dataset<uint8_t> images = inputFile.empty() ? SyntheticDataset<uint8_t>(size > 0 ? size : 20000, 784)
+                                                : LoadDataset<uint8_t>(inputFile, size);
+    std::size_t queries = std::min<std::size_t>(numQueries, images.size());
+    std::cout << "images: " << images.size() << " dimension: " << images.dimension() << " threads: " << ThreadPool::Default().size() << std::endl;
+    std::cout << "functions  build per function  build matrix  speedup  hash per function  hash matrix  speedup" << std::endl;
+
+    // 14 is the dimension of the default Cube, 20 the functions of the default Lsh (k = 4, L = 5)
+    const int functionCounts[] = {8, 14, 20, 40, 80};
+    bool passed = true;
+    for (int numFunctions : functionCounts)
+    {
+        ProjectionMatrix projections(images.dimension(), w);
+        std::vector<std::vector<double>> vectors;
+        std::vector<double> shifts;
+        for (int f = 0; f < numFunctions; f++)
+        {
+            std::vector<double> v;
+            for (std::size_t j = 0; j < images.dimension(); j++)
+                v.push_back(NormalDistribution(0.0, 1.0));
+            double t = RealDistribution(0, w);
+            projections.AddFunction(v, t);
+            vectors.push_back(v);
+            shifts.push_back(t);
+        }
+
+        // Every function on its own, in the order of the images
+        std::vector<uint64_t> separate(images.size() * numFunctions);
+        startClock();
+        for (std::size_t i = 0; i < images.size(); i++)
+            for (int f = 0; f < numFunctions; f++)
+                separate[i * numFunctions + f] = (uint64_t)(int64_t)floor((DotProduct(vectors[f].data(), images.row(i), images.dimension()) + shifts[f]) / (double)w);
+        double tSeparateBuild = stopClock().count() * 1e-9;
+
+        std::vector<uint64_t> batch, hashes;
+        startClock();
+        for (std::size_t first = 0; first < images.size(); first += ProjectionMatrix::BatchImages)
+        {
+            std::size_t count = std::min(ProjectionMatrix::BatchImages, images.size() - first);
+            projections.hashBatch(images, first, count, batch, ThreadPool::Default());
+            for (std::size_t i = 0; i < count; i++)
+                hashes.insert(hashes.end(), batch.begin() + i * projections.blockSize(), batch.begin() + i * projections.blockSize() + numFunctions);
+        }
+        double tMatrixBuild = stopClock().count() * 1e-9;
+        passed = passed && hashes == separate;
+
+        // A query is hashed by one thread, the latency is the time of one query
+        uint64_t checksum = 0;
+        startClock();
+        for (std::size_t q = 0; q < queries; q++)
+            for (int f = 0; f < numFunctions; f++)
+            {
+                uint64_t hash = (uint64_t)(int64_t)floor((DotProduct(vectors[f].data(), images.row(q), images.dimension()) + shifts[f]) / (double)w);
+                checksum += hash;
+            }
+        double tSeparateHash = stopClock().count() * 1e-9 / queries;
+
+        std::vector<uint64_t> query(projections.blockSize());
+        startClock();
+        for (std::size_t q = 0; q < queries; q++)
+        {
+            projections.hash(images.row(q), query.data());
+            for (int f = 0; f < numFunctions; f++)
+                checksum -= query[f];
+        }
+        double tMatrixHash = stopClock().count() * 1e-9 / queries;
+        passed = passed && checksum == 0;
+
+        std::cout << std::setw(9) << numFunctions << std::fixed << std::setprecision(4)
+                  << std::setw(17) << tSeparateBuild << " s" << std::setw(12) << tMatrixBuild << " s"
+                  << std::setw(8) << std::setprecision(2) << tSeparateBuild / tMatrixBuild << "x"
+                  << std::setw(16) << std::setprecision(1) << tSeparateHash * 1e6 << " us" << std::setw(10) << tMatrixHash * 1e6 << " us"
+                  << std::setw(8) << std::setprecision(2) << tSeparateHash / tMatrixHash << "x" << std::defaultfloat << std::endl;
+    }
+
+    if (!passed)
+    {
+        std::cerr << "Error, the projection matrix does not give the hashes of the functions on their own" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
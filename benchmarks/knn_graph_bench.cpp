@@ -0,0 +1,97 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "KnnGraph.hpp"
+#include "BenchUtils.hpp"
+
+// Fraction of the true k nearest neighbors of a sample of the images that are in their rows of the graph
+static double GraphRecall(const Dataset<uint8_t> &images, const std::vector<std::vector<Neighbor>> &graph, int k, int sampleSize)
+{
+    EuclideanDistance distance;
+    int found = 0, total = 0;
+    for (std::size_t i = 0; i < images.size(); i += std::max<std::size_t>(1, images.size() / sampleSize))
+    {
+        // The image itself is the first result of the brute force, it is never in the graph
+        for (const Neighbor &e : BruteForce(images, images[i], k + 1, distance))
+        {
+            if (e.id == (int)i)
+                continue;
+            for (const Neighbor &g : graph[i])
+                if (g.id == e.id)
+                {
+                    found++;
+                    break;
+                }
+        }
+        total += k;
+    }
+    return (double)found / total;
+}
+
+// Builds the kNN graph of the same images with the Lsh initializer of GNNS and with NN-Descent
+// and reports the build time and the recall of each
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    int size = -1;
+    int k = 50;
+    int sampleSize = 200;
+    bool skipLsh = false;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-k"))
+            k = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-s"))
+            sampleSize = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nolsh"))
+            skipLsh = true;
+    }
+
+    Dataset<uint8_t> synthetic;
+    FileParser<uint8_t> *parser = nullptr;
+    if (!inputFile.empty())
+        parser = new FileParser<uint8_t>(inputFile, size);
+    else
+        synthetic = SyntheticDataset<uint8_t>(size > 0 ? size : 20000, 784);
+    const Dataset<uint8_t> &images = parser ? parser->GetImages() : synthetic;
+
+    std::cout << "images: " << images.size() << " k: " << k << std::endl;
+
+    // The Lsh initializer grows faster than linearly with the number of images, -nolsh skips it on large inputs
+    if (!skipLsh)
+    {
+        startClock();
+        std::vector<std::vector<Neighbor>> lsh = LshKnnGraph<uint8_t, EuclideanDistance>(images, k);
+        double tLsh = stopClock().count() * 1e-9;
+        std::cout << "lsh: " << tLsh << " s, recall@" << k << ": " << GraphRecall(images, lsh, k, sampleSize)
+                  << ", recall@10: " << GraphRecall(images, lsh, std::min(k, 10), sampleSize) << std::endl;
+    }
+
+    startClock();
+    std::vector<std::vector<Neighbor>> descent = NnDescentKnnGraph<uint8_t, EuclideanDistance>(images, k);
+    double tDescent = stopClock().count() * 1e-9;
+    std::cout << "nn-descent: " << tDescent << " s, recall@" << k << ": " << GraphRecall(images, descent, k, sampleSize)
+              << ", recall@10: " << GraphRecall(images, descent, std::min(k, 10), sampleSize) << std::endl;
+
+    delete parser;
+    return EXIT_SUCCESS;
+}
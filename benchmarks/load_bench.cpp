@@ -0,0 +1,153 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <arpa/inet.h>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "IdxFile.hpp"
+#include "DatasetStream.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "BenchUtils.hpp"
+
+// Writes images as an IDX file of unsigned byte images, the dimension must be a square
+static void WriteIdx(const std::string &path, const Dataset<uint8_t> &images)
+{
+    uint32_t side = 1;
+    while ((side + 1) * (side + 1) <= images.dimension())
+        side++;
+    Metadata metadata;
+    metadata.magicNumber = htonl(Metadata::ImagesMagic);
+    metadata.numOfImages = htonl(images.size());
+    metadata.numOfRows = htonl(side);
+    metadata.numOfColumns = htonl(images.dimension() / side);
+
+    std::ofstream file(path, std::ios::binary);
+    file.write((const char *)&metadata, sizeof(Metadata));
+    for (std::size_t i = 0; i < images.size(); i++)
+        file.write((const char *)images.row(i), images.dimension());
+}
+
+// The sum of the pixels, so that every image is read and the loaders can be compared
+static uint64_t Checksum(const Dataset<uint8_t> &images)
+{
+    uint64_t sum = 0;
+    for (std::size_t i = 0; i < images.size(); i++)
+        for (std::size_t j = 0; j < images.dimension(); j++)
+            sum += images.row(i)[j];
+    return sum;
+}
+
+// Compares the time to load a file with FileParser and to map it with IdxFile, then answers a query file chunk by
+// chunk with DatasetStream, once reading every chunk after the previous one was answered and once with the next chunk
+// read while the current one is answered
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    int size = -1;
+    int numNn = 10;
+    std::size_t chunkSize = 1000;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            numNn = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-chunk"))
+            chunkSize = atoi(argv[i + 1]);
+    }
+
+    // Without files the synthetic images are written to temporary IDX files first
+    if (inputFile.empty() || queryFile.empty())
+    {
+        std::size_t numImages = size > 0 ? size : 20000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + 5000, 784);
+        inputFile = "/tmp/load_bench_input.idx";
+        queryFile = "/tmp/load_bench_query.idx";
+        WriteIdx(inputFile, CopyRows(synthetic, 0, numImages));
+        WriteIdx(queryFile, CopyRows(synthetic, numImages, 5000));
+    }
+
+    startClock();
+    FileParser<uint8_t> parser(inputFile, size);
+    uint64_t parsedSum = Checksum(parser.GetImages());
+    double tParse = stopClock().count() * 1e-9;
+
+    startClock();
+    Dataset<uint8_t> images = std::make_shared<IdxFile>(inputFile)->images(size);
+    double tMap = stopClock().count() * 1e-9;
+    uint64_t mappedSum = Checksum(images);
+    double tMapScan = stopClock().count() * 1e-9;
+
+    std::cout << "images: " << images.size() << " dimension: " << images.dimension() << std::endl;
+    std::cout << std::fixed << std::setprecision(4);
+    std::cout << "FileParser load + scan: " << tParse << " s, " << parser.GetImages().memoryUsage() / 1024 << " KiB copied" << std::endl;
+    std::cout << "IdxFile map: " << tMap << " s, map + scan: " << tMapScan << " s, 0 KiB copied" << std::endl;
+    if (parsedSum != mappedSum)
+    {
+        std::cerr << "Error, the mapped images differ from the parsed ones" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Every chunk of queries is answered with the batch brute force
+    EuclideanDistance distance;
+    auto answer = [&](const Dataset<uint8_t> &chunk, std::size_t offset)
+    {
+        std::vector<ImageView<uint8_t>> queries;
+        for (std::size_t q = 0; q < chunk.size(); q++)
+            queries.push_back(ImageView<uint8_t>((int)(offset + q), (int)chunk.dimension(), chunk.row(q)));
+        std::vector<std::vector<Neighbor>> results;
+        BruteForceBatch(images, queries, numNn, distance, results);
+        return results.size();
+    };
+
+    // One chunk at a time: the next chunk is only read after the current one was answered
+    std::size_t answered = 0;
+    startClock();
+    {
+        std::ifstream file(queryFile, std::ios::binary);
+        Metadata metadata;
+        file.read((char *)&metadata, sizeof(Metadata));
+        metadata.toHostOrder();
+        std::size_t dimension = (std::size_t)metadata.numOfRows * metadata.numOfColumns;
+        for (std::size_t first = 0; first < metadata.numOfImages; first += chunkSize)
+        {
+            Dataset<uint8_t> chunk(std::min(chunkSize, metadata.numOfImages - first), dimension);
+            for (std::size_t i = 0; i < chunk.size(); i++)
+                file.read((char *)chunk.row(i), dimension);
+            answered += answer(chunk, first);
+        }
+    }
+    double tSerial = stopClock().count() * 1e-9;
+
+    std::size_t streamed = 0;
+    startClock();
+    {
+        DatasetStream<uint8_t> stream(queryFile, chunkSize);
+        while (stream.Next())
+            streamed += answer(stream.Chunk(), stream.Offset());
+    }
+    double tStream = stopClock().count() * 1e-9;
+
+    std::cout << "queries: " << streamed << " chunk: " << chunkSize << std::endl;
+    std::cout << "read then answer: " << tSerial << " s, streamed with prefetch: " << tStream << " s, speedup "
+              << std::setprecision(2) << tSerial / tStream << "x" << std::endl;
+    if (answered != streamed)
+    {
+        std::cerr << "Error, the stream returned " << streamed << " queries instead of " << answered << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
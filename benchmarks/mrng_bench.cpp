@@ -0,0 +1,133 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "KnnGraph.hpp"
+#include "Mrng.hpp"
+#include "BenchUtils.hpp"
+
+// Measures how long the Mrng index takes to build, including how much of it is the approximate kNN graph,
+// and the recall and speed of the search on it
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    int size = -1;
+    int numQueries = 100;
+    int poolSize = 50;
+    int maxDegree = 30;
+    int l = 200;
+    int numNn = 10;
+    KnnGraphMethod init = KnnGraphMethod::NN_DESCENT;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-k"))
+            poolSize = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-degree"))
+            maxDegree = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-l"))
+            l = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            numNn = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-init"))
+            init = strcmp(argv[i + 1], "lsh") ? KnnGraphMethod::NN_DESCENT : KnnGraphMethod::LSH;
+    }
+
+    // Without files the input and the queries are drawn from the same synthetic clusters
+    Dataset<uint8_t> syntheticInput, syntheticQueries;
+    FileParser<uint8_t> *inputParser = nullptr, *queryParser = nullptr;
+    if (!inputFile.empty())
+        inputParser = new FileParser<uint8_t>(inputFile, size);
+    if (!queryFile.empty())
+        queryParser = new FileParser<uint8_t>(queryFile, numQueries);
+    if (!inputParser || !queryParser)
+    {
+        std::size_t numImages = size > 0 ? size : 60000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+        syntheticInput = CopyRows(synthetic, 0, numImages);
+        syntheticQueries = CopyRows(synthetic, numImages, numQueries);
+    }
+    const Dataset<uint8_t> &images = inputParser ? inputParser->GetImages() : syntheticInput;
+    const Dataset<uint8_t> &queries = queryParser ? queryParser->GetImages() : syntheticQueries;
+
+    std::cout << "images: " << images.size() << " queries: " << queries.size() << " pool: " << poolSize
+              << " degree: " << maxDegree << " candidates: " << l
+              << " init: " << (init == KnnGraphMethod::LSH ? "lsh" : "nndescent") << std::endl;
+
+    // The candidate stage on its own, the Mrng constructor builds the same graph again
+    startClock();
+    std::vector<std::vector<Neighbor>> pool = KnnGraph<uint8_t, EuclideanDistance>(images, poolSize, init);
+    double tPool = stopClock().count() * 1e-9;
+
+    // Recall of the candidates, measured on a sample of the images. The image itself is not one of its candidates
+    EuclideanDistance distance;
+    int poolFound = 0, poolSample = 0;
+    int poolK = std::min(numNn, poolSize);
+    for (std::size_t i = 0; i < images.size(); i += std::max<std::size_t>(1, images.size() / 100), poolSample++)
+    {
+        std::vector<Neighbor> exact = BruteForce(images, images[i], poolK + 1, distance);
+        for (const Neighbor &e : exact)
+            for (int j = 0; j < poolK && j < (int)pool[i].size(); j++)
+                if (e.id != (int)i && pool[i][j].id == e.id)
+                {
+                    poolFound++;
+                    break;
+                }
+    }
+    pool.clear();
+
+    startClock();
+    Mrng<uint8_t, EuclideanDistance> mrng(images, numNn, l, poolSize, maxDegree, init);
+    double tBuild = stopClock().count() * 1e-9;
+
+    std::cout << "knn graph alone: " << tPool << " s, recall@" << poolK << ": " << (double)poolFound / (poolSample * poolK) << std::endl;
+    std::cout << "mrng build: " << tBuild << " s" << std::endl;
+
+    // Recall is the fraction of the true numNn nearest neighbors the search returns
+    double tSearch = 0;
+    int found = 0;
+    for (std::size_t q = 0; q < queries.size(); q++)
+    {
+        startClock();
+        std::vector<Neighbor> approx = mrng.Approximate_kNN(queries[q]);
+        tSearch += stopClock().count() * 1e-9;
+
+        std::vector<Neighbor> exact = BruteForce(images, queries[q], numNn, distance);
+        for (const Neighbor &e : exact)
+            for (const Neighbor &a : approx)
+                if (a.id == e.id)
+                {
+                    found++;
+                    break;
+                }
+    }
+
+    std::cout << "recall@" << numNn << ": " << (double)found / (queries.size() * numNn) << std::endl;
+    std::cout << "queries per second: " << queries.size() / tSearch << std::endl;
+
+    delete inputParser;
+    delete queryParser;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "DatasetLoader.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "ProductQuantizer.hpp"
+#include "Lsh.hpp"
+#include "Cube.hpp"
+#include "Gnns.hpp"
+#include "Mrng.hpp"
+#include "BenchUtils.hpp"
+
+// The exact search of every image, or with a quantizer the distance of every code followed by the re-rank of the
+// rerank nearest codes, the baseline of a quantizer without an index
+class Scan
+{
+private:
+    const Dataset<uint8_t> &images;
+    int numNn;
+    EuclideanDistance distance;
+    const ProductQuantizer *quantizer;
+    int rerank;
+
+public:
+    Scan(const Dataset<uint8_t> &images, int numNn) : images(images), numNn(numNn), quantizer(nullptr), rerank(0) {}
+
+    void UseQuantizer(const ProductQuantizer *quantizer, int rerank)
+    {
+        this->quantizer = quantizer;
+        this->rerank = rerank;
+    }
+
+    std::vector<Neighbor> Approximate_kNN(const ImageView<uint8_t> &query)
+    {
+        if (!quantizer)
+            return BruteForce(images, query, numNn, distance);
+        std::vector<float> table;
+        quantizer->Table<EuclideanDistance>(query.pixels, table);
+        std::size_t keep = std::min<std::size_t>(std::max(numNn, rerank), images.size());
+        std::vector<Neighbor> codes;
+        for (std::size_t i = 0; i < images.size(); i++)
+            codes.push_back(Neighbor(i, quantizer->Adc(table.data(), i)));
+        std::nth_element(codes.begin(), codes.begin() + keep - 1, codes.end(), CompareNeighbor());
+        codes.resize(keep);
+        return Rerank(images, query, codes, numNn, distance);
+    }
+
+    void SearchBatch(const std::vector<ImageView<uint8_t>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool)
+    {
+        results.resize(queries.size());
+        pool.ParallelFor(queries.size(), [&](std::size_t q, int)
+                         { results[q] = Approximate_kNN(queries[q]); });
+    }
+};
+
+// Splits a comma separated list of integers
+static std::vector<int> ParseList(const char *list)
+{
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+        if (!value.empty())
+            values.push_back(atoi(value.c_str()));
+    return values;
+}
+
+// The fraction of the k true nearest neighbors found, over all the queries
+static double Recall(const std::vector<std::vector<Neighbor>> &found, const std::vector<std::vector<Neighbor>> &exact, int k)
+{
+    long hits = 0;
+    for (std::size_t q = 0; q < found.size(); q++)
+        for (const Neighbor &neighbor : found[q])
+            for (const Neighbor &truth : exact[q])
+                if (neighbor.id == truth.id)
+                {
+                    hits++;
+                    break;
+                }
+    return (double)hits / (found.size() * k);
+}
+
+// Answers the queries with an index, first with the exact distances and then with every quantizer and re-rank depth.
+// A row gives the bytes of the vectors the candidates are ranked with, the recall and the recall lost to the codes
+template <typename Index>
+static void Measure(const char *name, Index &index, const std::vector<ProductQuantizer *> &quantizers, const std::vector<int> &reranks,
+                    const std::vector<ImageView<uint8_t>> &queries, const std::vector<std::vector<Neighbor>> &exact, int k, std::size_t imageBytes)
+{
+    std::vector<std::vector<Neighbor>> found;
+    startClock();
+    index.SearchBatch(queries, found, ThreadPool::Default());
+    double seconds = stopClock().count() * 1e-9;
+    double exactRecall = Recall(found, exact, k);
+    std::cout << std::left << std::setw(8) << name << std::setw(10) << "exact" << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << imageBytes / 1024.0 << std::setw(11) << "1x" << std::setprecision(4) << std::setw(9) << exactRecall
+              << std::setw(9) << 0.0 << std::setprecision(1) << std::setw(11) << queries.size() / seconds << std::defaultfloat << std::endl;
+
+    for (ProductQuantizer *quantizer : quantizers)
+        for (int rerank : reranks)
+        {
+            index.UseQuantizer(quantizer, rerank);
+            startClock();
+            index.SearchBatch(queries, found, ThreadPool::Default());
+            seconds = stopClock().count() * 1e-9;
+            double recall = Recall(found, exact, k);
+
+            std::ostringstream setting;
+            setting << "M=" << quantizer->subspaces() << " R=" << rerank;
+            std::cout << std::left << std::setw(8) << name << std::setw(10) << setting.str() << std::right << std::fixed << std::setprecision(0)
+                      << std::setw(12) << quantizer->memoryUsage() / 1024.0 << std::setprecision(1) << std::setw(10)
+                      << (double)imageBytes / quantizer->memoryUsage() << "x" << std::setprecision(4) << std::setw(9) << recall
+                      << std::setw(9) << exactRecall - recall << std::setprecision(1) << std::setw(11) << queries.size() / seconds
+                      << std::defaultfloat << std::endl;
+        }
+    index.UseQuantizer(nullptr, 0);
+}
+
+// Trains a product quantizer for every number of subspaces of -m and reports the memory of the codes and of the
+// codebooks against the images. Then every index ranks its candidates with the codes, re-ranks the R nearest of them
+// (-rerank) with the exact distances, and is compared with the same index on the exact distances. The memory is the
+// one of the vectors only, the indexes are the same with and without codes
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    int size = -1;
+    int numQueries = 200;
+    int k = 10;
+    int iterations = 10;
+    std::vector<int> subspaces = {8, 16, 49};
+    std::vector<int> reranks = {10, 50, 200};
+    std::vector<std::string> indexes = {"scan", "lsh", "cube", "gnns", "mrng"};
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            k = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-m"))
+            subspaces = ParseList(argv[i + 1]);
+        else if (!strcmp(argv[i], "-rerank"))
+            reranks = ParseList(argv[i + 1]);
+        else if (!strcmp(argv[i], "-iterations"))
+            iterations = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-index"))
+        {
+            indexes.clear();
+            std::stringstream list(argv[i + 1]);
+            std::string index;
+            while (std::getline(list, index, ','))
+                indexes.push_back(index);
+        }
+    }
+
+    Dataset<uint8_t> images, queryImages;
+    if (!inputFile.empty() && !queryFile.empty())
+    {
+        images = LoadDataset<uint8_t>(inputFile, size);
+        queryImages = LoadDataset<uint8_t>(queryFile, numQueries);
+    }
+    else
+    {
+        std::size_t numImages = size > 0 ? size : 20000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+        images = CopyRows(synthetic, 0, numImages);
+        queryImages = CopyRows(synthetic, numImages, numQueries);
+    }
+    std::vector<ImageView<uint8_t>> queries;
+    for (std::size_t q = 0; q < queryImages.size(); q++)
+        queries.push_back(queryImages[q]);
+
+    EuclideanDistance distance;
+    std::vector<std::vector<Neighbor>> exact;
+    BruteForceBatch(images, queries, k, distance, exact);
+
+    std::cout << "images: " << images.size() << " dimension: " << images.dimension() << " queries: " << queries.size() << " k: " << k
+              << " threads: " << ThreadPool::Default().size() << std::endl;
+    std::cout << "quantizer  train s  codes KiB  codebooks KiB  images KiB  reduction" << std::endl;
+    std::vector<ProductQuantizer *> quantizers;
+    for (int m : subspaces)
+    {
+        startClock();
+        ProductQuantizer *quantizer = new ProductQuantizer(images, m, iterations);
+        double seconds = stopClock().count() * 1e-9;
+        quantizers.push_back(quantizer);
+        std::cout << "M=" << std::left << std::setw(8) << m << std::right << std::fixed << std::setprecision(2) << std::setw(7) << seconds
+                  << std::setprecision(0) << std::setw(11) << quantizer->codesUsage() / 1024.0 << std::setw(15)
+                  << (quantizer->memoryUsage() - quantizer->codesUsage()) / 1024.0 << std::setw(12) << images.memoryUsage() / 1024.0
+                  << std::setprecision(1) << std::setw(10) << (double)images.memoryUsage() / quantizer->memoryUsage() << "x"
+                  << std::defaultfloat << std::endl;
+    }
+
+    std::cout << "index   setting   vectors KiB  reduction   recall     lost        qps" << std::endl;
+    for (const std::string &index : indexes)
+    {
+        if (index == "scan")
+        {
+            Scan scan(images, k);
+            Measure("scan", scan, quantizers, reranks, queries, exact, k, images.memoryUsage());
+        }
+        else if (index == "lsh")
+        {
+            Lsh<uint8_t, EuclideanDistance> lsh(images, 4, 5, k, 2240, std::max<int>(1, images.size() / 8));
+            Measure("lsh", lsh, quantizers, reranks, queries, exact, k, images.memoryUsage());
+        }
+        else if (index == "cube")
+        {
+            Cube<uint8_t, EuclideanDistance> cube(images, 2240, 14, 6000, 15, k, 1 << 14);
+            Measure("cube", cube, quantizers, reranks, queries, exact, k, images.memoryUsage());
+        }
+        else if (index == "gnns")
+        {
+            GNNS<uint8_t, EuclideanDistance> gnns(images, 40, 30, 10, k);
+            Measure("gnns", gnns, quantizers, reranks, queries, exact, k, images.memoryUsage());
+        }
+        else if (index == "mrng")
+        {
+            Mrng<uint8_t, EuclideanDistance> mrng(images, k, 100, 40, 30);
+            Measure("mrng", mrng, quantizers, reranks, queries, exact, k, images.memoryUsage());
+        }
+        else
+        {
+            std::cerr << "Error, unknown index " << index << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (ProductQuantizer *quantizer : quantizers)
+        delete quantizer;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+#include <iostream>
+#include <cstring>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <memory>
+#include <algorithm>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "Utils.hpp"
+#include "FileParser.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "Mrng.hpp"
+#include "GraphFile.hpp"
+#include "Adjacency.hpp"
+#include "BeamSearch.hpp"
+#include "BenchUtils.hpp"
+
+class SetCandidate
+{
+public:
+    Neighbor neighbor;
+    bool checked;
+
+    SetCandidate(int id, double distance, bool checked) : neighbor(id, distance), checked(checked) {}
+};
+
+class CompareSetCandidate
+{
+public:
+    bool operator()(const SetCandidate &a, const SetCandidate &b) const { return a.neighbor.distance < b.neighbor.distance; }
+};
+
+// The search on graph Mrng used before the beam search, kept here as the baseline. Its candidates are an ordered set
+// that grows until l images were inserted, and nothing records which images were already compared to the query
+static std::vector<Neighbor> SetSearch(const Dataset<uint8_t> &images, const Adjacency &graph, int navNode, const ImageView<uint8_t> &query,
+                                       int numResults, int l, const EuclideanDistance &distance, long &numDistances)
+{
+    std::set<SetCandidate, CompareSetCandidate> R;
+    SetCandidate p(navNode, distance(images[navNode], query), false);
+    R.insert(p);
+    numDistances++;
+
+    int i = 1;
+    int visitedNodes = 0;
+    while (i < l && (int)R.size() > visitedNodes)
+    {
+        for (auto it = R.begin(); it != R.end(); ++it)
+            if (!it->checked)
+            {
+                SetCandidate updated = *it;
+                updated.checked = true;
+                R.erase(it);
+                R.insert(updated);
+                p = updated;
+                break;
+            }
+        visitedNodes++;
+
+        for (int neighbor : graph[p.neighbor.id])
+        {
+            numDistances++;
+            if (R.insert(SetCandidate(neighbor, distance(images[neighbor], query), false)).second)
+                i++;
+        }
+    }
+
+    std::vector<Neighbor> results;
+    for (const SetCandidate &c : R)
+    {
+        if ((int)results.size() >= numResults)
+            break;
+        results.push_back(c.neighbor);
+    }
+    return results;
+}
+
+class SearchResult
+{
+public:
+    int l;
+    double recall;
+    double microseconds;
+    double distances;
+};
+
+static void Print(const char *name, const SearchResult &r)
+{
+    std::cout << std::left << std::setw(6) << name << "l=" << std::setw(5) << r.l << std::right << std::fixed
+              << " recall " << std::setprecision(4) << r.recall << std::setprecision(1)
+              << std::setw(10) << r.microseconds << " us/query" << std::setw(10) << r.distances << " distances/query" << std::endl;
+}
+
+// Compares the query latency of the beam search with the old set based search on the same Mrng graph. Both sweep
+// the number of candidates l, then every beam search setting is matched with the fastest set search setting that
+// reaches at least the same recall
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    std::string graphFile = "/tmp/search_bench.graph";
+    int size = -1;
+    int numQueries = 200;
+    int poolSize = 30;
+    int maxDegree = 30;
+    int numNn = 10;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-k"))
+            poolSize = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-degree"))
+            maxDegree = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            numNn = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-graph"))
+            graphFile = std::string(argv[i + 1]);
+    }
+
+    Dataset<uint8_t> syntheticInput, syntheticQueries;
+    FileParser<uint8_t> *inputParser = nullptr, *queryParser = nullptr;
+    if (!inputFile.empty())
+        inputParser = new FileParser<uint8_t>(inputFile, size);
+    if (!queryFile.empty())
+        queryParser = new FileParser<uint8_t>(queryFile, numQueries);
+    if (!inputParser || !queryParser)
+    {
+        std::size_t numImages = size > 0 ? size : 20000;
+        Dataset<uint8_t> synthetic = SyntheticDataset<uint8_t>(numImages + numQueries, 784);
+        syntheticInput = CopyRows(synthetic, 0, numImages);
+        syntheticQueries = CopyRows(synthetic, numImages, numQueries);
+    }
+    const Dataset<uint8_t> &images = inputParser ? inputParser->GetImages() : syntheticInput;
+    const Dataset<uint8_t> &queries = queryParser ? queryParser->GetImages() : syntheticQueries;
+
+    std::cout << "images: " << images.size() << " queries: " << queries.size() << " pool: " << poolSize << " degree: " << maxDegree << std::endl;
+
+    // The graph goes through a graph file, which gives its edges and the navigating node to both searches
+    {
+        startClock();
+        Mrng<uint8_t, EuclideanDistance> mrng(images, numNn, numNn, poolSize, maxDegree);
+        std::cout << "mrng build: " << stopClock().count() * 1e-9 << " s" << std::endl;
+        mrng.save(graphFile);
+    }
+    std::shared_ptr<GraphFile> file = std::make_shared<GraphFile>(graphFile, GraphFileHeader(GraphKind::MRNG, EuclideanDistance::name(), images.size(), images.dimension(), -1));
+    Adjacency graph = file->adjacency();
+    int navNode = file->GetHeader().navNode;
+    std::cout << "edges: " << graph.numEdges() << " (" << graph.memoryUsage() / 1024 << " KiB)" << std::endl;
+
+    EuclideanDistance distance;
+    std::vector<std::vector<Neighbor>> exact(queries.size());
+    for (std::size_t q = 0; q < queries.size(); q++)
+        exact[q] = BruteForce(images, queries[q], numNn, distance);
+
+    auto recallOf = [&](std::size_t q, const std::vector<Neighbor> &approx)
+    {
+        int found = 0;
+        for (const Neighbor &e : exact[q])
+            for (const Neighbor &a : approx)
+                if (a.id == e.id)
+                {
+                    found++;
+                    break;
+                }
+        return found;
+    };
+
+    std::vector<int> sweep = {10, 20, 40, 80, 160, 320, 640};
+    std::vector<SearchResult> setResults, beamResults;
+
+    for (int l : sweep)
+    {
+        if (l < numNn)
+            continue;
+        long numDistances = 0;
+        int found = 0;
+        startClock();
+        for (std::size_t q = 0; q < queries.size(); q++)
+            found += recallOf(q, SetSearch(images, graph, navNode, queries[q], numNn, l, distance, numDistances));
+        double seconds = stopClock().count() * 1e-9;
+        SearchResult r = {l, (double)found / (queries.size() * numNn), seconds * 1e6 / queries.size(), (double)numDistances / queries.size()};
+        setResults.push_back(r);
+        Print("set", r);
+    }
+
+    BeamSearch<uint8_t, EuclideanDistance> searcher(images);
+    std::vector<int> entries(1, navNode);
+    for (int l : sweep)
+    {
+        if (l < numNn)
+            continue;
+        long numDistances = 0;
+        int found = 0;
+        startClock();
+        for (std::size_t q = 0; q < queries.size(); q++)
+        {
+            found += recallOf(q, searcher.Search(graph, queries[q], entries, numNn, l));
+            numDistances += searcher.Distances();
+        }
+        double seconds = stopClock().count() * 1e-9;
+        SearchResult r = {l, (double)found / (queries.size() * numNn), seconds * 1e6 / queries.size(), (double)numDistances / queries.size()};
+        beamResults.push_back(r);
+        Print("beam", r);
+    }
+
+    std::cout << "at equal recall:" << std::endl;
+    for (const SearchResult &beam : beamResults)
+    {
+        const SearchResult *best = nullptr;
+        for (const SearchResult &set : setResults)
+            if (set.recall >= beam.recall && (!best || set.microseconds < best->microseconds))
+                best = &set;
+        if (best)
+        {
+            std::cout << "recall " << std::setprecision(4) << beam.recall << std::setprecision(1) << "  beam " << std::setw(10) << beam.microseconds
+                      << " us  set " << std::setw(10) << best->microseconds << " us  speedup " << std::setprecision(2)
+                      << best->microseconds / beam.microseconds << "x" << std::endl;
+        }
+        else
+            std::cout << "recall " << std::setprecision(4) << beam.recall << std::setprecision(1) << "  beam " << std::setw(10) << beam.microseconds
+                      << " us  set never reaches it" << std::endl;
+    }
+
+    delete inputParser;
+    delete queryParser;
+    return EXIT_SUCCESS;
+}
@@ -1,42 +1,360 @@
 #include <vector>
-#include <queue>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
 
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "Utils.hpp"
 #include "BruteForce.hpp"
 #include "PublicTypes.hpp"
 #include "ImageDistance.hpp"
+#include "SimdKernels.hpp"
+#include "ThreadPool.hpp"
+
+// The number of images a thread scans at a time
+static const std::size_t BruteForceBlock = 2048;
+
+// The most queries a task of the batch compares with the images, and the bytes of images a task compares with all its
+// queries before it moves on, so that they are read from the L2 cache and not from memory once per query
+static const std::size_t QueryTile = 64;
+static const std::size_t ImageTileBytes = 128 * 1024;
+
+/**
+ * @brief The k nearest of the images seen so far, kept in a max heap of at most k entries. An image only enters the
+ * heap if it is nearer than the farthest one in it, so after the first images almost every image costs one comparison.
+ * Equal distances are ordered by id, so the result does not depend on the order the images were seen in
+ *
+ * @method Push offers an image to the k nearest
+ * @method Bound the largest distance an image can have to enter the heap, infinite until the heap holds k images
+ * @method Sorted returns the k nearest from the nearest to the farthest and empties the heap
+ */
+class TopK
+{
+private:
+    std::vector<Neighbor> heap;
+    std::size_t k;
+
+    static bool Nearer(const Neighbor &a, const Neighbor &b) { return a.distance < b.distance || (a.distance == b.distance && a.id < b.id); }
+
+public:
+    explicit TopK(int k) : k(k > 0 ? k : 0) { heap.reserve(this->k); }
+
+    inline void Push(int id, double distance)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(Neighbor(id, distance));
+            std::push_heap(heap.begin(), heap.end(), Nearer);
+        }
+        else if (k > 0 && Nearer(Neighbor(id, distance), heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), Nearer);
+            heap.back() = Neighbor(id, distance);
+            std::push_heap(heap.begin(), heap.end(), Nearer);
+        }
+    }
+
+    inline double Bound() const { return heap.empty() || heap.size() < k ? std::numeric_limits<double>::infinity() : heap.front().distance; }
+
+    std::vector<Neighbor> Sorted()
+    {
+        std::sort_heap(heap.begin(), heap.end(), Nearer);
+        std::vector<Neighbor> sorted;
+        sorted.swap(heap);
+        return sorted;
+    }
+};
+
+/**
+ * @brief The candidates of a query whose distances are only known up to an error of at most margin / 2, as the
+ * expanded euclidean distances of float images. The k nearest by these distances are kept in a TopK, and so is every
+ * image within margin of the farthest of them: the true distance of the k-th true neighbor is at most the k-th
+ * approximate distance plus margin / 2, so the approximate distance of a true neighbor is within margin of it
+ *
+ * @method Push offers an image to the candidates
+ * @method Bound the largest distance an image can have to be kept
+ * @method Within returns the images within margin of the k-th nearest and empties the candidates
+ */
+class TopKWithin
+{
+private:
+    TopK nearest;
+    std::size_t k;
+    double margin;
+    std::vector<Neighbor> within;
+    std::size_t compactSize;
+
+    // Drops the images that are no longer within margin of the k-th nearest. The next compaction waits until the
+    // images kept have doubled, so a wide margin that keeps most images does not compact them over and over
+    void Compact()
+    {
+        double bound = Bound();
+        within.erase(std::remove_if(within.begin(), within.end(), [bound](const Neighbor &neighbor)
+                                    { return neighbor.distance > bound; }),
+                     within.end());
+        compactSize = std::max(4 * k + 64, 2 * within.size());
+    }
+
+public:
+    TopKWithin(int k, double margin) : nearest(k), k(k > 0 ? k : 0), margin(margin), compactSize(4 * this->k + 64) {}
+
+    inline void Push(int id, double distance)
+    {
+        if (k == 0 || !(distance <= Bound()))
+            return;
+        nearest.Push(id, distance);
+        within.push_back(Neighbor(id, distance));
+        if (within.size() > compactSize)
+            Compact();
+    }
+
+    inline double Bound() const { return nearest.Bound() + margin; }
+
+    std::vector<Neighbor> Within()
+    {
+        Compact();
+        nearest = TopK(k);
+        std::vector<Neighbor> result;
+        result.swap(within);
+        return result;
+    }
+};
+
+// The k nearest of the images in [first, last), sorted by distance. An image stops being compared once it is farther
+// than the k nearest so far
+template <typename T, typename U, typename Distance>
+static std::vector<Neighbor> ScanBlock(const Dataset<T> &images_input, const ImageView<U> &query, const int k, const Distance &distance,
+                                       std::size_t first, std::size_t last)
+{
+    TopK nearestNeighbors(k);
+    for (std::size_t i = first; i < last; i++)
+        nearestNeighbors.Push(i, distance.distance_if_less(images_input[i], query, nearestNeighbors.Bound()));
+    return nearestNeighbors.Sorted();
+}
 
 /**
- * @brief find the true nearest neigbors with brute force by comparing the distance of query to all images
+ * @brief find the true nearest neigbors with brute force by comparing the distance of query to all images.
+ * The images are scanned in blocks on the threads of the default pool, every block keeps its own k nearest and the
+ * blocks are merged at the end. A brute force that runs inside a parallel loop, as one per query, scans on its own thread
  *
  * @param images_input all images from input
  * @param query query image
  * @param k number of nearest neighbors
+ * @param distance the metric functor
  * @return vector of nearest Neighbors in Neigbor class format
  */
-std::vector<Neighbor> BruteForce(const std::vector<ImagePtr> &images_input, const ImagePtr query, const int k)
+template <typename T, typename U, typename Distance>
+std::vector<Neighbor> BruteForce(const Dataset<T> &images_input, const ImageView<U> &query, const int k, const Distance &distance)
+{
+    std::size_t numBlocks = (images_input.size() + BruteForceBlock - 1) / BruteForceBlock;
+    if (numBlocks <= 1)
+        return ScanBlock(images_input, query, k, distance, 0, images_input.size());
+
+    std::vector<std::vector<Neighbor>> blockNearest(numBlocks);
+    ThreadPool::Default().ParallelFor(numBlocks, [&](std::size_t b, int)
+                                      { blockNearest[b] = ScanBlock(images_input, query, k, distance, b * BruteForceBlock,
+                                                                    std::min(images_input.size(), (b + 1) * BruteForceBlock)); },
+                                      1);
+
+    // The nearest of every block go through one more heap, which orders equal distances by id like the blocks do
+    TopK nearestNeighbors(k);
+    for (const std::vector<Neighbor> &block : blockNearest)
+        for (const Neighbor &neighbor : block)
+            nearestNeighbors.Push(neighbor.id, neighbor.distance);
+    return nearestNeighbors.Sorted();
+}
+
+// The exact distance of a candidate is abandoned once it cannot be one of the k nearest
+template <typename T, typename Distance>
+std::vector<Neighbor> Rerank(const Dataset<T> &images_input, const ImageView<T> &query, const std::vector<Neighbor> &candidates, const int k,
+                             const Distance &distance)
+{
+    TopK nearestNeighbors(k);
+    for (const Neighbor &candidate : candidates)
+        nearestNeighbors.Push(candidate.id, distance.distance_if_less(images_input[candidate.id], query, nearestNeighbors.Bound()));
+    return nearestNeighbors.Sorted();
+}
+
+/**
+ * @brief Compares a tile of queries with a tile of images and offers every image to the k nearest of every query.
+ * This generic version calls the metric for every pair, the tiles only keep the images in the cache between the queries
+ *
+ * @method Start the empty candidates of a query, Candidates is their type
+ * @method Scan compares queries [0, numQueries) with the images [first, last)
+ * @method Finish turns the candidates of a query into its k nearest
+ */
+template <typename T, typename Distance>
+class TileScanner
+{
+private:
+    const Dataset<T> &images;
+    const Distance &distance;
+
+public:
+    typedef TopK Candidates;
+
+    TileScanner(const Dataset<T> &images, const Distance &distance) : images(images), distance(distance) {}
+
+    Candidates Start(const ImageView<T> &, int k) const { return TopK(k); }
+
+    void Scan(const ImageView<T> *queries, std::size_t numQueries, std::size_t first, std::size_t last, Candidates *nearest) const
+    {
+        for (std::size_t q = 0; q < numQueries; q++)
+            for (std::size_t i = first; i < last; i++)
+                nearest[q].Push(i, distance.distance_if_less(images[i], queries[q], nearest[q].Bound()));
+    }
+
+    std::vector<Neighbor> Finish(const ImageView<T> &, TopK &nearest, int) const { return nearest.Sorted(); }
+};
+
+/**
+ * @brief The euclidean tiles are computed like a matrix product. The squared distance is ‖x‖² + ‖q‖² - 2 x·q, the norms
+ * of the images are computed once, and the inner product kernels multiply every image with InnerProductTile queries at a
+ * time, which reads each image once for all of them. The distances of uint8_t images are exact integers. For float and
+ * double the expansion cancels digits when ‖x‖² and ‖q‖² are close to 2 x·q. A sum of d products or squares in
+ * floating point is off by at most γ = d u / (1 - d u) times the sum of their absolute values (u is the unit roundoff
+ * of the sum), so with Cauchy-Schwarz an expanded distance is off by at most γ (‖x‖ + ‖q‖)². Every image within twice
+ * that error of the k-th nearest is kept, with the largest image norm, and Rerank computes their distances again with
+ * the metric before it cuts them to k. The result is the exact one, with the distances of the search algorithms
+ */
+template <typename T>
+class TileScanner<T, EuclideanDistance>
 {
-    // store in priority queue to keep the correct queue of the k nearest neighbors
-    std::priority_queue<Neighbor, std::vector<Neighbor>, CompareNeighbor> nearestNeighbors;
+private:
+    typedef typename KernelTraits<T, T>::Sum Sum;
 
-    ImageDistance *distance = ImageDistance::getInstance();
+    const Dataset<T> &images;
+    const EuclideanDistance &distance;
+    std::vector<double> norms;
+    double maxNorm;
+    std::vector<T> zero;
 
-    for (ImagePtr input : images_input)
+public:
+    TileScanner(const Dataset<T> &images, const EuclideanDistance &distance)
+        : images(images), distance(distance), norms(images.size()), maxNorm(0), zero(images.dimension(), (T)0)
     {
-        double dist = distance->calculate(input, query);
-        Neighbor new_tuple(input, dist);
-        nearestNeighbors.push(new_tuple);
+        ThreadPool::Default().ParallelFor(images.size(), [&](std::size_t i, int)
+                                          { norms[i] = Norm(images.row(i)); });
+        for (double norm : norms)
+            maxNorm = std::max(maxNorm, norm);
+    }
+
+    double Norm(const T *pixels) const { return (double)SquaredEuclidean(pixels, zero.data(), zero.size()); }
+
+    typedef TopKWithin Candidates;
 
-        if ((int)nearestNeighbors.size() > k)
-            nearestNeighbors.pop();
+    // The margin is twice the error bound, with room for the rounding of the norms and of the sum in double
+    Candidates Start(const ImageView<T> &query, int k) const
+    {
+        if (std::is_integral<Sum>::value)
+            return TopKWithin(k, 0.0);
+        double u = std::numeric_limits<Sum>::epsilon() / 2, terms = (double)zero.size() + 4;
+        double gamma = terms * u / (1 - terms * u);
+        double root = std::sqrt(maxNorm) + std::sqrt(Norm(query.pixels));
+        return TopKWithin(k, 2 * gamma * (1 + gamma) * root * root);
     }
 
-    std::vector<Neighbor> KnearestNeighbors;
-    while (!nearestNeighbors.empty())
+    void Scan(const ImageView<T> *queries, std::size_t numQueries, std::size_t first, std::size_t last, Candidates *nearest) const
     {
-        KnearestNeighbors.insert(KnearestNeighbors.begin(), nearestNeighbors.top());
-        nearestNeighbors.pop();
+        std::size_t dim = images.dimension();
+        for (std::size_t q = 0; q < numQueries; q += InnerProductTile)
+        {
+            // A group at the end with less queries repeats its last one, the extra products are not used
+            std::size_t groupSize = std::min(InnerProductTile, numQueries - q);
+            const T *group[InnerProductTile];
+            double queryNorms[InnerProductTile];
+            for (std::size_t j = 0; j < InnerProductTile; j++)
+            {
+                group[j] = queries[q + std::min(j, groupSize - 1)].pixels;
+                queryNorms[j] = Norm(group[j]);
+            }
+
+            Sum products[InnerProductTile];
+            for (std::size_t i = first; i < last; i++)
+            {
+                InnerProducts(images.row(i), group, dim, products);
+                for (std::size_t j = 0; j < groupSize; j++)
+                    nearest[q + j].Push(i, std::max(0.0, norms[i] + queryNorms[j] - 2.0 * (double)products[j]));
+            }
+        }
     }
-    return KnearestNeighbors;
-}
\ No newline at end of file
+
+    std::vector<Neighbor> Finish(const ImageView<T> &query, Candidates &nearest, int k) const
+    {
+        std::vector<Neighbor> candidates = nearest.Within();
+        if (!std::is_integral<Sum>::value)
+            return Rerank(images, query, candidates, k, distance);
+        TopK exact(k);
+        for (const Neighbor &candidate : candidates)
+            exact.Push(candidate.id, candidate.distance);
+        return exact.Sorted();
+    }
+};
+
+/**
+ * @brief find the true nearest neighbors of a batch of queries. The queries are split in tiles of at most QueryTile
+ * queries that run on the threads of the default pool, and every tile goes over the images a block of about
+ * ImageTileBytes at a time, comparing the block with all its queries before it moves to the next one
+ *
+ * @param images_input all images from input
+ * @param queries the query images
+ * @param k number of nearest neighbors
+ * @param distance the metric functor
+ * @param results the k nearest neighbors of every query, sorted by distance
+ */
+template <typename T, typename Distance>
+void BruteForceBatch(const Dataset<T> &images_input, const std::vector<ImageView<T>> &queries, const int k, const Distance &distance,
+                     std::vector<std::vector<Neighbor>> &results)
+{
+    results.assign(queries.size(), std::vector<Neighbor>());
+    if (queries.empty() || images_input.size() == 0)
+        return;
+
+    // Small batches use smaller tiles, so that every thread still gets a few of them
+    ThreadPool &pool = ThreadPool::Default();
+    std::size_t tileSize = (queries.size() + 4 * pool.size() - 1) / (4 * pool.size());
+    tileSize = std::min(QueryTile, std::max(InnerProductTile, (tileSize + InnerProductTile - 1) / InnerProductTile * InnerProductTile));
+    std::size_t numTiles = (queries.size() + tileSize - 1) / tileSize;
+    std::size_t imageTile = std::max((std::size_t)1, ImageTileBytes / (images_input.GetStride() * sizeof(T)));
+
+    TileScanner<T, Distance> scanner(images_input, distance);
+    pool.ParallelFor(numTiles, [&](std::size_t tile, int)
+                     {
+                         std::size_t first = tile * tileSize;
+                         std::size_t count = std::min(tileSize, queries.size() - first);
+                         std::vector<typename TileScanner<T, Distance>::Candidates> nearest;
+                         for (std::size_t q = 0; q < count; q++)
+                             nearest.push_back(scanner.Start(queries[first + q], k));
+                         for (std::size_t i = 0; i < images_input.size(); i += imageTile)
+                             scanner.Scan(&queries[first], count, i, std::min(images_input.size(), i + imageTile), nearest.data());
+                         for (std::size_t q = 0; q < count; q++)
+                             results[first + q] = scanner.Finish(queries[first + q], nearest[q], k); },
+                     1);
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template std::vector<Neighbor> BruteForce(const Dataset<uint8_t> &, const ImageView<uint8_t> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<float> &, const ImageView<float> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<double> &, const ImageView<double> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<uint8_t> &, const ImageView<float> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<double> &, const ImageView<float> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<uint8_t> &, const ImageView<uint8_t> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<float> &, const ImageView<float> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<double> &, const ImageView<double> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<uint8_t> &, const ImageView<float> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> BruteForce(const Dataset<double> &, const ImageView<float> &, const int, const ManhattanDistance &);
+template void BruteForceBatch(const Dataset<uint8_t> &, const std::vector<ImageView<uint8_t>> &, const int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template void BruteForceBatch(const Dataset<float> &, const std::vector<ImageView<float>> &, const int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template void BruteForceBatch(const Dataset<double> &, const std::vector<ImageView<double>> &, const int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template void BruteForceBatch(const Dataset<uint8_t> &, const std::vector<ImageView<uint8_t>> &, const int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template void BruteForceBatch(const Dataset<float> &, const std::vector<ImageView<float>> &, const int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template void BruteForceBatch(const Dataset<double> &, const std::vector<ImageView<double>> &, const int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template std::vector<Neighbor> Rerank(const Dataset<uint8_t> &, const ImageView<uint8_t> &, const std::vector<Neighbor> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> Rerank(const Dataset<float> &, const ImageView<float> &, const std::vector<Neighbor> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> Rerank(const Dataset<double> &, const ImageView<double> &, const std::vector<Neighbor> &, const int, const EuclideanDistance &);
+template std::vector<Neighbor> Rerank(const Dataset<uint8_t> &, const ImageView<uint8_t> &, const std::vector<Neighbor> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> Rerank(const Dataset<float> &, const ImageView<float> &, const std::vector<Neighbor> &, const int, const ManhattanDistance &);
+template std::vector<Neighbor> Rerank(const Dataset<double> &, const ImageView<double> &, const std::vector<Neighbor> &, const int, const ManhattanDistance &);
@@ -2,10 +2,27 @@
 #define BRUTEFORCE_HPP_
 
 #include <vector>
+#include <cstdint>
 
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "PublicTypes.hpp"
+#include "ImageDistance.hpp"
 
-std::vector<Neighbor> BruteForce(const std::vector<ImagePtr> &images_input, const ImagePtr query, const int k);
+// Instantiated for both metrics, for queries of the same pixel type as the input and for float queries, e.g. centroids
+template <typename T, typename U, typename Distance>
+std::vector<Neighbor> BruteForce(const Dataset<T> &images_input, const ImageView<U> &query, const int k, const Distance &distance);
 
-#endif
\ No newline at end of file
+// The exact k nearest neighbors of every query, results[q] are the ones of queries[q]. Instantiated for both metrics
+// and for queries of the same pixel type as the input
+template <typename T, typename Distance>
+void BruteForceBatch(const Dataset<T> &images_input, const std::vector<ImageView<T>> &queries, const int k, const Distance &distance,
+                     std::vector<std::vector<Neighbor>> &results);
+
+// The k candidates nearest to the query by their exact distances, sorted, e.g. the candidates an index ranked with the
+// distances of their PQ codes. Instantiated for both metrics and for queries of the same pixel type as the input
+template <typename T, typename Distance>
+std::vector<Neighbor> Rerank(const Dataset<T> &images_input, const ImageView<T> &query, const std::vector<Neighbor> &candidates, const int k,
+                             const Distance &distance);
+
+#endif
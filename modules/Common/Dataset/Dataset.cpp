@@ -0,0 +1,81 @@
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include "Dataset.hpp"
+
+template <typename T>
+Dataset<T>::Dataset() : data(nullptr), numImages(0), dim(0), stride(0) {}
+
+// Allocates one zero initialized, aligned buffer for all rows. The padding at the end of each row stays zero
+template <typename T>
+Dataset<T>::Dataset(std::size_t numImages, std::size_t dimension) : data(nullptr), numImages(numImages), dim(dimension)
+{
+    const std::size_t perLine = Alignment / sizeof(T);
+    stride = (dim + perLine - 1) / perLine * perLine;
+
+    std::size_t bytes = numImages * stride * sizeof(T);
+    if (bytes == 0)
+        return;
+
+    void *buffer = nullptr;
+    if (posix_memalign(&buffer, Alignment, bytes))
+    {
+        std::cerr << "Dataset: failed to allocate " << bytes << " bytes" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::memset(buffer, 0, bytes);
+    data = static_cast<T *>(buffer);
+}
+
+// Nothing is copied, the rows stay where they are. They are only read through the const accessors
+template <typename T>
+Dataset<T>::Dataset(std::size_t numImages, std::size_t dimension, std::size_t stride, const T *data, std::shared_ptr<const void> owner)
+    : data(const_cast<T *>(data)), numImages(numImages), dim(dimension), stride(stride), owner(owner)
+{
+    if (stride < dim)
+    {
+        std::cerr << "Dataset: the stride " << stride << " is smaller than the dimension " << dim << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+// A borrowed buffer is released by its owner
+template <typename T>
+Dataset<T>::~Dataset()
+{
+    if (!owner)
+        free(data);
+}
+
+template <typename T>
+Dataset<T>::Dataset(Dataset &&other)
+    : data(other.data), numImages(other.numImages), dim(other.dim), stride(other.stride), owner(std::move(other.owner))
+{
+    other.data = nullptr;
+    other.numImages = other.dim = other.stride = 0;
+}
+
+template <typename T>
+Dataset<T> &Dataset<T>::operator=(Dataset &&other)
+{
+    if (this != &other)
+    {
+        if (!owner)
+            free(data);
+        data = other.data;
+        numImages = other.numImages;
+        dim = other.dim;
+        stride = other.stride;
+        owner = std::move(other.owner);
+        other.data = nullptr;
+        other.numImages = other.dim = other.stride = 0;
+    }
+    return *this;
+}
+
+// Explicit instantiations for the supported pixel types
+template class Dataset<uint8_t>;
+template class Dataset<float>;
+template class Dataset<double>;
@@ -0,0 +1,64 @@
+#ifndef DATASET_HPP_
+#define DATASET_HPP_
+
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Image.hpp"
+
+/**
+ * @brief Stores all the data points of a dataset in one contiguous row-major buffer.
+ * The buffer and every row start on a 64-byte boundary (a cache line) so that a scan over
+ * the data is purely sequential and the distance loops never straddle rows. The id of an image
+ * is its row index and views to the rows are handed out with operator[].
+ * T is the type of a pixel, instantiated for uint8_t, float and double.
+ * The buffer is either owned or borrowed from memory that is kept alive by owner, as with a mapped IDX file. The rows
+ * of a borrowed buffer are only as aligned as its stride makes them and must not be written.
+ *
+ * @param numImages the number of rows
+ * @param dim the number of pixels of each row
+ * @param stride the distance in elements between the start of two consecutive rows (dim rounded up to the alignment)
+ */
+template <typename T>
+class Dataset
+{
+private:
+    T *data;
+    std::size_t numImages;
+    std::size_t dim;
+    std::size_t stride;
+    std::shared_ptr<const void> owner;
+
+public:
+    typedef T value_type;
+
+    static const std::size_t Alignment = 64;
+
+    Dataset();
+    Dataset(std::size_t numImages, std::size_t dimension);
+    // Borrows the rows at data, stride elements apart. owner keeps them alive
+    Dataset(std::size_t numImages, std::size_t dimension, std::size_t stride, const T *data, std::shared_ptr<const void> owner);
+    ~Dataset();
+
+    // The dataset owns or borrows the buffer, so it can only be moved
+    Dataset(const Dataset &) = delete;
+    Dataset &operator=(const Dataset &) = delete;
+    Dataset(Dataset &&other);
+    Dataset &operator=(Dataset &&other);
+
+    inline std::size_t size() const { return numImages; }
+    inline std::size_t dimension() const { return dim; }
+    inline std::size_t GetStride() const { return stride; }
+
+    inline T *row(std::size_t i) { return data + i * stride; }
+    inline const T *row(std::size_t i) const { return data + i * stride; }
+
+    inline ImageView<T> operator[](std::size_t i) const { return ImageView<T>((int)i, (int)dim, row(i)); }
+
+    // Bytes occupied by the pixel buffer, including the row padding
+    inline std::size_t memoryUsage() const { return numImages * stride * sizeof(T); }
+};
+
+#endif
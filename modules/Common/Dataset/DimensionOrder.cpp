@@ -0,0 +1,61 @@
+#include <vector>
+#include <numeric>
+#include <algorithm>
+
+#include "DimensionOrder.hpp"
+#include "ThreadPool.hpp"
+
+template <typename T>
+DimensionOrder::DimensionOrder(const Dataset<T> &images, std::size_t sampleSize) : order(images.dimension())
+{
+    std::size_t dim = images.dimension();
+    std::size_t step = std::max<std::size_t>(1, images.size() / std::max<std::size_t>(1, sampleSize));
+    std::vector<double> sum(dim, 0.0), squares(dim, 0.0);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < images.size(); i += step, count++)
+    {
+        const T *row = images.row(i);
+        for (std::size_t j = 0; j < dim; j++)
+        {
+            sum[j] += (double)row[j];
+            squares[j] += (double)row[j] * (double)row[j];
+        }
+    }
+
+    // The variance is E[x²] - E[x]², equal variances keep the original order of the dimensions
+    std::vector<double> variance(dim, 0.0);
+    for (std::size_t j = 0; count && j < dim; j++)
+        variance[j] = squares[j] / count - (sum[j] / count) * (sum[j] / count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b)
+                     { return variance[a] > variance[b]; });
+}
+
+DimensionOrder::~DimensionOrder() {}
+
+template <typename T>
+void DimensionOrder::Apply(const T *pixels, T *reordered) const
+{
+    for (std::size_t j = 0; j < order.size(); j++)
+        reordered[j] = pixels[order[j]];
+}
+
+template <typename T>
+Dataset<T> DimensionOrder::Reorder(const Dataset<T> &images) const
+{
+    Dataset<T> reordered(images.size(), images.dimension());
+    ThreadPool::Default().ParallelFor(images.size(), [&](std::size_t i, int)
+                                      { Apply(images.row(i), reordered.row(i)); });
+    return reordered;
+}
+
+// Explicit instantiations for the supported pixel types
+template DimensionOrder::DimensionOrder(const Dataset<uint8_t> &, std::size_t);
+template DimensionOrder::DimensionOrder(const Dataset<float> &, std::size_t);
+template DimensionOrder::DimensionOrder(const Dataset<double> &, std::size_t);
+template void DimensionOrder::Apply(const uint8_t *, uint8_t *) const;
+template void DimensionOrder::Apply(const float *, float *) const;
+template void DimensionOrder::Apply(const double *, double *) const;
+template Dataset<uint8_t> DimensionOrder::Reorder(const Dataset<uint8_t> &) const;
+template Dataset<float> DimensionOrder::Reorder(const Dataset<float> &) const;
+template Dataset<double> DimensionOrder::Reorder(const Dataset<double> &) const;
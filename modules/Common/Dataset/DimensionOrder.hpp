@@ -0,0 +1,41 @@
+#ifndef DIMENSION_ORDER_HPP_
+#define DIMENSION_ORDER_HPP_
+
+#include <vector>
+#include <cstddef>
+
+#include "Dataset.hpp"
+
+/**
+ * @brief An order of the dimensions of a dataset from the largest variance to the smallest. A distance does not depend
+ * on the order of the dimensions, but a bounded distance (distance_if_less) that meets the dimensions of large variance
+ * first passes its bound after less of them, e.g. the border pixels of MNIST that are almost always 0 come last.
+ * The images and the queries have to be reordered alike, the order is optional and only a matter of speed
+ *
+ * @param order order[j] is the dimension of the dataset that becomes dimension j
+ *
+ * @method dimensions the order
+ * @method Apply writes the pixels of one image in the order to reordered
+ * @method Reorder a copy of a dataset with the dimensions of every image in the order
+ */
+class DimensionOrder
+{
+private:
+    std::vector<std::size_t> order;
+
+public:
+    // The variance of every dimension is computed over at most sampleSize images spread over the dataset
+    template <typename T>
+    explicit DimensionOrder(const Dataset<T> &images, std::size_t sampleSize = 10000);
+    ~DimensionOrder();
+
+    inline const std::vector<std::size_t> &dimensions() const { return order; }
+
+    template <typename T>
+    void Apply(const T *pixels, T *reordered) const;
+
+    template <typename T>
+    Dataset<T> Reorder(const Dataset<T> &images) const;
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include <iostream>
+#include <cstring>
+#include <algorithm>
+
+#include "DatasetLoader.hpp"
+#include "FileParser.hpp"
+
+// A dimension beyond this is a sign of a file of another format rather than of a real dataset
+static const std::size_t MaxDimension = 1 << 20;
+
+std::size_t DatasetLayout::elementBytes() const
+{
+    return element == ElementType::UINT8 ? sizeof(uint8_t) : element == ElementType::INT32 ? sizeof(int32_t) : sizeof(float);
+}
+
+static DatasetLayout ProbeIdx(std::ifstream &file, std::size_t, int)
+{
+    Metadata metadata;
+    if (!file.read((char *)&metadata, sizeof(Metadata)))
+    {
+        std::cerr << "Failed to read the header." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    metadata.toHostOrder();
+    if (!metadata.isImages())
+    {
+        std::cerr << "The file is not an IDX file of unsigned byte images." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    DatasetLayout layout;
+    layout.format = "idx";
+    layout.element = ElementType::UINT8;
+    layout.numImages = metadata.numOfImages;
+    layout.dimension = (std::size_t)metadata.numOfRows * metadata.numOfColumns;
+    layout.headerBytes = sizeof(Metadata);
+    layout.prefixBytes = 0;
+    return layout;
+}
+
+// The vecs formats only differ in the type of the values. Every vector repeats the dimension, the first one gives it
+static DatasetLayout ProbeVecs(std::ifstream &file, std::size_t fileBytes, const char *format, ElementType element)
+{
+    int32_t dimension = 0;
+    if (!file.read((char *)&dimension, sizeof(int32_t)))
+    {
+        std::cerr << "Failed to read the dimension of the first vector." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    DatasetLayout layout;
+    layout.format = format;
+    layout.element = element;
+    layout.dimension = dimension;
+    layout.headerBytes = 0;
+    layout.prefixBytes = sizeof(int32_t);
+    if (dimension <= 0 || (std::size_t)dimension > MaxDimension || fileBytes % layout.recordBytes())
+    {
+        std::cerr << "The file is not a " << format << " file, the first vector has dimension " << dimension << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    layout.numImages = fileBytes / layout.recordBytes();
+    return layout;
+}
+
+static DatasetLayout ProbeFvecs(std::ifstream &file, std::size_t fileBytes, int) { return ProbeVecs(file, fileBytes, "fvecs", ElementType::FLOAT32); }
+static DatasetLayout ProbeBvecs(std::ifstream &file, std::size_t fileBytes, int) { return ProbeVecs(file, fileBytes, "bvecs", ElementType::UINT8); }
+static DatasetLayout ProbeIvecs(std::ifstream &file, std::size_t fileBytes, int) { return ProbeVecs(file, fileBytes, "ivecs", ElementType::INT32); }
+
+static DatasetLayout ProbeF32(std::ifstream &, std::size_t fileBytes, int dimension)
+{
+    if (dimension <= 0 || (std::size_t)dimension > MaxDimension)
+    {
+        std::cerr << "Error, a raw f32 file has no header, its dimension has to be given" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    DatasetLayout layout;
+    layout.format = "f32";
+    layout.element = ElementType::FLOAT32;
+    layout.dimension = dimension;
+    layout.headerBytes = 0;
+    layout.prefixBytes = 0;
+    if (fileBytes % layout.recordBytes())
+    {
+        std::cerr << "The size of the f32 file is not a multiple of " << layout.recordBytes() << " bytes, a vector of dimension " << dimension << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    layout.numImages = fileBytes / layout.recordBytes();
+    return layout;
+}
+
+const std::vector<DatasetFormat> &DatasetFormats()
+{
+    static const std::vector<DatasetFormat> formats = {
+        {"idx", ".idx", ProbeIdx},
+        {"fvecs", ".fvecs", ProbeFvecs},
+        {"bvecs", ".bvecs", ProbeBvecs},
+        {"ivecs", ".ivecs", ProbeIvecs},
+        {"f32", ".f32", ProbeF32}};
+    return formats;
+}
+
+static bool EndsWith(const std::string &text, const std::string &suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+DatasetLayout ReadLayout(const std::string &path, const std::string &format, int dimension)
+{
+    // MNIST files are named like train-images.idx3-ubyte, so IDX is also the format of any unknown extension
+    const std::vector<DatasetFormat> &formats = DatasetFormats();
+    const DatasetFormat *chosen = &formats[0];
+    if (!format.empty())
+    {
+        auto found = std::find_if(formats.begin(), formats.end(), [&](const DatasetFormat &f)
+                                  { return format == f.name; });
+        if (found == formats.end())
+        {
+            std::cerr << "Error, unknown dataset format " << format << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        chosen = &*found;
+    }
+    else
+        for (const DatasetFormat &f : formats)
+            if (EndsWith(path, f.extension))
+                chosen = &f;
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open the file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::size_t fileBytes = file.tellg();
+    file.seekg(0);
+
+    DatasetLayout layout = chosen->probe(file, fileBytes, dimension);
+    if (layout.headerBytes + layout.numImages * layout.recordBytes() > fileBytes)
+    {
+        std::cerr << "The file " << path << " is truncated." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    return layout;
+}
+
+// Copies the values one by one, the values of a record are not aligned for their type
+template <typename Source, typename T>
+static void ConvertValues(const char *values, T *row, std::size_t dimension)
+{
+    for (std::size_t j = 0; j < dimension; j++)
+    {
+        Source value;
+        memcpy(&value, values + j * sizeof(Source), sizeof(Source));
+        row[j] = static_cast<T>(value);
+    }
+}
+
+template <typename T>
+void ReadVectors(std::ifstream &file, const DatasetLayout &layout, std::size_t count, Dataset<T> &images, std::size_t firstRow)
+{
+    std::vector<char> record(layout.recordBytes());
+    const char *values = record.data() + layout.prefixBytes;
+
+    for (std::size_t i = 0; i < count; i++)
+    {
+        if (!file.read(record.data(), record.size()))
+        {
+            std::cerr << "Failed to read image data." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+
+        // Every vector of a vecs file repeats the dimension, a different one means the file is not what it seems
+        if (layout.prefixBytes)
+        {
+            int32_t dimension;
+            memcpy(&dimension, record.data(), sizeof(int32_t));
+            if ((std::size_t)dimension != layout.dimension)
+            {
+                std::cerr << "A vector of the " << layout.format << " file has dimension " << dimension << " instead of " << layout.dimension << "." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        T *row = images.row(firstRow + i);
+        if (layout.element == ElementType::UINT8)
+            ConvertValues<uint8_t>(values, row, layout.dimension);
+        else if (layout.element == ElementType::INT32)
+            ConvertValues<int32_t>(values, row, layout.dimension);
+        else
+            ConvertValues<float>(values, row, layout.dimension);
+    }
+}
+
+template <typename T>
+Dataset<T> LoadDataset(const std::string &path, int size, const std::string &format, int dimension)
+{
+    DatasetLayout layout = ReadLayout(path, format, dimension);
+    if (size < -1 || (size != -1 && (std::size_t)size > layout.numImages))
+    {
+        std::cerr << "The file " << path << " has " << layout.numImages << " vectors, " << size << " were asked for." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    std::size_t numImages = size == -1 ? layout.numImages : size;
+
+    std::ifstream file(path, std::ios::binary);
+    file.seekg(layout.headerBytes);
+    Dataset<T> images(numImages, layout.dimension);
+    ReadVectors(file, layout, numImages, images, 0);
+    return images;
+}
+
+// Explicit instantiations for the supported pixel types
+template void ReadVectors(std::ifstream &, const DatasetLayout &, std::size_t, Dataset<uint8_t> &, std::size_t);
+template void ReadVectors(std::ifstream &, const DatasetLayout &, std::size_t, Dataset<float> &, std::size_t);
+template void ReadVectors(std::ifstream &, const DatasetLayout &, std::size_t, Dataset<double> &, std::size_t);
+template Dataset<uint8_t> LoadDataset(const std::string &, int, const std::string &, int);
+template Dataset<float> LoadDataset(const std::string &, int, const std::string &, int);
+template Dataset<double> LoadDataset(const std::string &, int, const std::string &, int);
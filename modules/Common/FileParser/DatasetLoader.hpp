@@ -0,0 +1,77 @@
+#ifndef DATASET_LOADER_HPP_
+#define DATASET_LOADER_HPP_
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+#include "Dataset.hpp"
+
+// The type of the values stored in a dataset file
+enum class ElementType
+{
+    UINT8,
+    INT32,
+    FLOAT32
+};
+
+/**
+ * @brief Where the vectors of a dataset file are and how they are stored. Every supported format stores the vectors
+ * back to back after a header, vector i starts at byte headerBytes + i * recordBytes() of the file.
+ *
+ * @param format the name of the format
+ * @param element the type of the values of a vector
+ * @param headerBytes the bytes before the first vector
+ * @param prefixBytes the bytes in front of every vector, the int32 dimension of the vecs formats
+ */
+class DatasetLayout
+{
+public:
+    std::string format;
+    ElementType element;
+    std::size_t numImages;
+    std::size_t dimension;
+    std::size_t headerBytes;
+    std::size_t prefixBytes;
+
+    std::size_t elementBytes() const;
+    inline std::size_t recordBytes() const { return prefixBytes + dimension * elementBytes(); }
+};
+
+/**
+ * @brief A supported file format. probe reads the start of the file and returns its layout, it gets the size of the
+ * file and the dimension given by the user, which only a format without a header needs. Another format is supported
+ * by writing its probe and adding it to the table of DatasetFormats.
+ *
+ * idx    MNIST images: a big endian header with the magic number, the count, rows and columns, then uint8 pixels
+ * fvecs  every vector is its int32 dimension followed by its float32 values
+ * bvecs  every vector is its int32 dimension followed by its uint8 values
+ * ivecs  every vector is its int32 dimension followed by its int32 values
+ * f32    raw float32 values without any header, the dimension has to be given
+ *
+ * The vecs and f32 files are read in the byte order of the machine, they are little endian everywhere they are made
+ */
+class DatasetFormat
+{
+public:
+    const char *name;
+    const char *extension;
+    DatasetLayout (*probe)(std::ifstream &file, std::size_t fileBytes, int dimension);
+};
+
+const std::vector<DatasetFormat> &DatasetFormats();
+
+// The layout of a file. The format is the given name, else the one of the file extension and IDX when none matches
+DatasetLayout ReadLayout(const std::string &path, const std::string &format = "", int dimension = -1);
+
+// Reads count vectors from the current position of file into the rows of images starting at firstRow, as T
+template <typename T>
+void ReadVectors(std::ifstream &file, const DatasetLayout &layout, std::size_t count, Dataset<T> &images, std::size_t firstRow);
+
+// Loads the first size vectors of a file (all of them with -1) straight into the rows of a Dataset
+template <typename T>
+Dataset<T> LoadDataset(const std::string &path, int size = -1, const std::string &format = "", int dimension = -1);
+
+#endif
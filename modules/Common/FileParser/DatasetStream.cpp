@@ -0,0 +1,79 @@
+#include <iostream>
+#include <algorithm>
+
+#include "DatasetStream.hpp"
+
+template <typename T>
+DatasetStream<T>::DatasetStream(const std::string &inputFile, std::size_t chunkSize, int size, const std::string &format, int dimension)
+    : layout(ReadLayout(inputFile, format, dimension)), chunkSize(chunkSize), numImages(0), requested(0), offset(0), nextOffset(0)
+{
+    file.open(inputFile, std::ios::binary);
+    file.seekg(layout.headerBytes);
+    if (!file)
+    {
+        std::cerr << "Failed to open the file " << inputFile << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (chunkSize == 0)
+    {
+        std::cerr << "Error, the chunk size has to be positive" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    numImages = size == -1 ? layout.numImages : std::min((std::size_t)size, layout.numImages);
+
+    // The first chunk is read while the caller gets ready for it
+    Prefetch();
+}
+
+// The thread of a pending chunk reads the file, it has to finish before the file is closed
+template <typename T>
+DatasetStream<T>::~DatasetStream()
+{
+    if (pending.valid())
+        pending.wait();
+}
+
+// Runs on the prefetch thread. Only one chunk is pending at a time, so the file is never read by two threads at once
+template <typename T>
+Dataset<T> DatasetStream<T>::ReadChunk(std::size_t count)
+{
+    Dataset<T> images(count, layout.dimension);
+    ReadVectors(file, layout, count, images, 0);
+    return images;
+}
+
+template <typename T>
+void DatasetStream<T>::Prefetch()
+{
+    if (requested == numImages)
+        return;
+
+    std::size_t count = std::min(chunkSize, numImages - requested);
+    requested += count;
+    pending = std::async(std::launch::async, &DatasetStream<T>::ReadChunk, this, count);
+}
+
+template <typename T>
+bool DatasetStream<T>::Next()
+{
+    if (!pending.valid())
+    {
+        chunk = Dataset<T>();
+        offset = nextOffset;
+        return false;
+    }
+
+    chunk = pending.get();
+    offset = nextOffset;
+    nextOffset += chunk.size();
+
+    // The next chunk is read while the caller works on this one
+    Prefetch();
+    return true;
+}
+
+// Explicit instantiations for the supported pixel types
+template class DatasetStream<uint8_t>;
+template class DatasetStream<float>;
+template class DatasetStream<double>;
@@ -0,0 +1,57 @@
+#ifndef DATASET_STREAM_HPP_
+#define DATASET_STREAM_HPP_
+
+#include <string>
+#include <fstream>
+#include <future>
+#include <cstddef>
+#include <cstdint>
+
+#include "Dataset.hpp"
+#include "DatasetLoader.hpp"
+
+/**
+ * @brief Reads a dataset file in chunks of a fixed number of images, for files that do not fit in memory.
+ * Only the current chunk and the next one are in memory: while the caller works on a chunk, the next one is read on
+ * another thread. The file can have any of the DatasetFormats, the values are converted to T as with LoadDataset.
+ *
+ * @param inputFile filename of the dataset
+ * @param chunkSize the number of images of a chunk, the last chunk may have fewer
+ * @param size the number of images to read, -1 for all of them
+ * @param format the name of the format, by default the one of the file extension
+ * @param dimension the dimension of a file without a header
+ *
+ * @method Next waits for the next chunk and makes it the current one, returns false at the end of the file
+ * @method Chunk the images of the current chunk, the id of an image is its row in the chunk
+ * @method Offset the position of the first image of the current chunk in the file
+ */
+template <typename T>
+class DatasetStream
+{
+private:
+    std::ifstream file;
+    DatasetLayout layout;
+    std::size_t chunkSize;
+    std::size_t numImages;
+    std::size_t requested;
+    std::size_t offset;
+    std::size_t nextOffset;
+    Dataset<T> chunk;
+    std::future<Dataset<T>> pending;
+
+    Dataset<T> ReadChunk(std::size_t count);
+    void Prefetch();
+
+public:
+    DatasetStream(const std::string &inputFile, std::size_t chunkSize, int size = -1, const std::string &format = "", int dimension = -1);
+    ~DatasetStream();
+
+    bool Next();
+
+    inline const DatasetLayout &GetLayout() const { return layout; }
+    inline std::size_t size() const { return numImages; }
+    inline const Dataset<T> &Chunk() const { return chunk; }
+    inline std::size_t Offset() const { return offset; }
+};
+
+#endif
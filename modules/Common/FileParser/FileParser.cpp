@@ -1,4 +1,5 @@
 #include <vector>
+#include <cstdint>
 #include <fstream>
 #include <arpa/inet.h>
 
@@ -11,7 +12,16 @@
 #include "Utils.hpp"
 #endif
 
-FileParser::FileParser(std::string inputFile, int size)
+void Metadata::toHostOrder()
+{
+    magicNumber = ntohl(magicNumber);
+    numOfImages = ntohl(numOfImages);
+    numOfRows = ntohl(numOfRows);
+    numOfColumns = ntohl(numOfColumns);
+}
+
+template <typename T>
+FileParser<T>::FileParser(std::string inputFile, int size)
 {
 
 #ifdef DEBUG
@@ -34,24 +44,19 @@ FileParser::FileParser(std::string inputFile, int size)
         exit(EXIT_FAILURE);
     }
 
-    metadata.magicNumber = ntohl(metadata.magicNumber);
-    if (size == -1)
-        metadata.numOfImages = ntohl(metadata.numOfImages);
-    else
+    metadata.toHostOrder();
+    if (size != -1)
         metadata.numOfImages = size;
-    metadata.numOfRows = ntohl(metadata.numOfRows);
-    metadata.numOfColumns = ntohl(metadata.numOfColumns);
 
     uint32_t image_size = metadata.numOfRows * metadata.numOfColumns;
 
-    images.resize(metadata.numOfImages);
+    // All images are stored in one contiguous buffer, the id of each image is its row
+    images = Dataset<T>(metadata.numOfImages, image_size);
     uint8_t *buffer = new uint8_t[image_size];
 
     for (std::size_t i = 0; i < images.size(); i++)
     {
-        images[i] = new Image;
-        images[i]->pixels.resize(image_size);
-        images[i]->id = i;
+        T *pixels = images.row(i);
 
         if (!file.read((char *)buffer, image_size))
         {
@@ -62,7 +67,7 @@ FileParser::FileParser(std::string inputFile, int size)
 
         for (std::size_t j = 0; j < image_size; ++j)
         {
-            images[i]->pixels[j] = static_cast<double>(buffer[j]);
+            pixels[j] = static_cast<T>(buffer[j]);
         }
     }
 
@@ -71,8 +76,10 @@ FileParser::FileParser(std::string inputFile, int size)
     file.close();
 }
 
-FileParser::~FileParser()
-{
-    for (const ImagePtr image_ptr : images)
-        delete image_ptr;
-}
+template <typename T>
+FileParser<T>::~FileParser() {}
+
+// Explicit instantiations for the supported pixel types
+template class FileParser<uint8_t>;
+template class FileParser<float>;
+template class FileParser<double>;
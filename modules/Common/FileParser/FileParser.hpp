@@ -2,13 +2,17 @@
 #define FILEPARSER_HPP_
 
 #include <vector>
+#include <cstdint>
 
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "PublicTypes.hpp"
 
 /**
  * @brief Stores the metadata of a MNIST dataset
+ * In the file the fields are big endian, toHostOrder converts them after the header was read
  *
+ * @method isImages whether the magic number is the one of an IDX file of unsigned byte images
  */
 class Metadata
 {
@@ -17,23 +21,30 @@ public:
     uint32_t numOfImages;
     uint32_t numOfRows;
     uint32_t numOfColumns;
+
+    static const uint32_t ImagesMagic = 0x00000803;
+
+    void toHostOrder();
+    inline bool isImages() const { return magicNumber == ImagesMagic; }
 };
 
 /**
  * @brief Parses a file of a MNIST dataset and stores its metadata and data points
+ * The pixels are converted to T, use uint8_t to keep the MNIST data in its original size
  * @param inputFile filename of dataset
  */
+template <typename T>
 class FileParser
 {
 private:
     Metadata metadata;
-    std::vector<ImagePtr> images;
+    Dataset<T> images;
 
 public:
     FileParser(std::string inputFile, int size = -1);
     ~FileParser();
     inline const Metadata &GetMetadata() const { return metadata; }
-    inline const std::vector<ImagePtr> &GetImages() const { return images; }
+    inline const Dataset<T> &GetImages() const { return images; }
 };
 
 #endif
\ No newline at end of file
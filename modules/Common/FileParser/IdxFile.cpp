@@ -0,0 +1,68 @@
+#include <iostream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "IdxFile.hpp"
+
+IdxFile::IdxFile(const std::string &path) : data(nullptr), size(0)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open the file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (std::size_t)status.st_size < sizeof(Metadata))
+    {
+        std::cerr << "The file " << path << " is too small." << std::endl;
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+    size = status.st_size;
+
+    // The mapping stays valid after the descriptor is closed
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "Failed to map the file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(&metadata, data, sizeof(Metadata));
+    metadata.toHostOrder();
+    if (!metadata.isImages())
+    {
+        std::cerr << path << " is not an IDX file of unsigned byte images." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (size < sizeof(Metadata) + (std::size_t)metadata.numOfImages * metadata.numOfRows * metadata.numOfColumns)
+    {
+        std::cerr << "The file " << path << " is truncated." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+IdxFile::~IdxFile()
+{
+    if (data)
+        munmap(data, size);
+}
+
+Dataset<uint8_t> IdxFile::images(int size) const
+{
+    std::size_t numImages = size == -1 ? metadata.numOfImages : size;
+    if (size < -1 || numImages > metadata.numOfImages)
+    {
+        std::cerr << "The file has " << metadata.numOfImages << " images, " << size << " were asked for." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::size_t dimension = (std::size_t)metadata.numOfRows * metadata.numOfColumns;
+    return Dataset<uint8_t>(numImages, dimension, dimension, pixels(), shared_from_this());
+}
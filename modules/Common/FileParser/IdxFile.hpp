@@ -0,0 +1,45 @@
+#ifndef IDX_FILE_HPP_
+#define IDX_FILE_HPP_
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "Dataset.hpp"
+#include "FileParser.hpp"
+
+/**
+ * @brief An IDX file of unsigned byte images mapped read-only in memory. Nothing is read when it is opened except the
+ * header, the pages are loaded on first access and are shared by all the processes that map the same file.
+ * The pixels are used where they are in the file, which stores the images back to back, so the rows of the
+ * dataset are numOfRows * numOfColumns bytes apart and are not padded.
+ *
+ * @param path filename of the dataset
+ *
+ * @method pixels the pixels of all the images
+ * @method images returns the first size images (all of them with -1) without copying them, the dataset keeps the file
+ * mapped. The file must be owned by a shared_ptr
+ */
+class IdxFile : public std::enable_shared_from_this<IdxFile>
+{
+private:
+    void *data;
+    std::size_t size;
+    Metadata metadata;
+
+public:
+    explicit IdxFile(const std::string &path);
+    ~IdxFile();
+
+    // The file is unmapped by the destructor, so it can not be copied
+    IdxFile(const IdxFile &) = delete;
+    IdxFile &operator=(const IdxFile &) = delete;
+
+    inline const Metadata &GetMetadata() const { return metadata; }
+    inline const uint8_t *pixels() const { return (const uint8_t *)data + sizeof(Metadata); }
+
+    Dataset<uint8_t> images(int size = -1) const;
+};
+
+#endif
@@ -0,0 +1,241 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <sys/stat.h>
+
+#include "GroundTruth.hpp"
+#include "BruteForce.hpp"
+#include "ImageDistance.hpp"
+
+template <typename Distance>
+void WriteGroundTruth(const std::string &prefix, const std::vector<std::vector<Neighbor>> &results)
+{
+    std::ofstream ids(prefix + ".ivecs", std::ios::binary);
+    std::ofstream distances(prefix + ".fvecs", std::ios::binary);
+    if (!ids.is_open() || !distances.is_open())
+    {
+        std::cerr << "Failed to open the ground truth files " << prefix << ".ivecs and " << prefix << ".fvecs for writing." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    std::vector<int32_t> idRow;
+    std::vector<float> distanceRow;
+    for (const std::vector<Neighbor> &result : results)
+    {
+        int32_t length = result.size();
+        idRow.clear();
+        distanceRow.clear();
+        for (const Neighbor &neighbor : result)
+        {
+            idRow.push_back(neighbor.id);
+            distanceRow.push_back((float)Distance::toDistance(neighbor.distance));
+        }
+        ids.write((const char *)&length, sizeof(int32_t));
+        ids.write((const char *)idRow.data(), length * sizeof(int32_t));
+        distances.write((const char *)&length, sizeof(int32_t));
+        distances.write((const char *)distanceRow.data(), length * sizeof(float));
+    }
+
+    if (!ids || !distances)
+    {
+        std::cerr << "Failed to write the ground truth files " << prefix << ".ivecs and " << prefix << ".fvecs." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+template <typename Distance>
+bool ReadGroundTruth(const std::string &prefix, std::size_t numQueries, int k, std::vector<std::vector<Neighbor>> &results)
+{
+    std::ifstream ids(prefix + ".ivecs", std::ios::binary);
+    std::ifstream distances(prefix + ".fvecs", std::ios::binary);
+    if (!ids.is_open() || !distances.is_open())
+        return false;
+
+    std::vector<std::vector<Neighbor>> rows(numQueries);
+    std::vector<int32_t> idRow;
+    std::vector<float> distanceRow;
+    for (std::size_t q = 0; q < numQueries; q++)
+    {
+        int32_t idLength = 0, distanceLength = 0;
+        if (!ids.read((char *)&idLength, sizeof(int32_t)) || !distances.read((char *)&distanceLength, sizeof(int32_t)) ||
+            idLength != distanceLength || idLength < k || k < 0)
+            return false;
+
+        idRow.resize(idLength);
+        distanceRow.resize(idLength);
+        if (!ids.read((char *)idRow.data(), idLength * sizeof(int32_t)) || !distances.read((char *)distanceRow.data(), idLength * sizeof(float)))
+            return false;
+
+        // The files may hold more neighbors than asked for, the nearest come first
+        for (int i = 0; i < k; i++)
+            rows[q].push_back(Neighbor(idRow[i], Distance::toRank(distanceRow[i])));
+    }
+
+    results.swap(rows);
+    return true;
+}
+
+// Folds 8 bytes at a time into the hash with a multiply and a rotation, the tail is padded with zeros
+static uint64_t HashBytes(uint64_t hash, const void *data, std::size_t size)
+{
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (std::size_t i = 0; i < size; i += 8)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, std::min((std::size_t)8, size - i));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+        hash = (hash << 31) | (hash >> 33);
+    }
+    return hash;
+}
+
+// The splitmix64 finalizer, so that every bit of the hash depends on every word
+static uint64_t FinishHash(uint64_t hash)
+{
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    return hash ^ (hash >> 31);
+}
+
+static uint64_t HashHeader(std::size_t numImages, std::size_t dimension, std::size_t pixelSize)
+{
+    uint64_t header[3] = {numImages, dimension, pixelSize};
+    return HashBytes(0x6A09E667F3BCC909ull, header, sizeof(header));
+}
+
+template <typename T>
+uint64_t HashImages(const std::vector<ImageView<T>> &images)
+{
+    uint64_t hash = HashHeader(images.size(), images.empty() ? 0 : images[0].dimension, sizeof(T));
+    for (const ImageView<T> &image : images)
+        hash = HashBytes(hash, image.pixels, image.dimension * sizeof(T));
+    return FinishHash(hash);
+}
+
+template <typename T>
+uint64_t HashImages(const Dataset<T> &images)
+{
+    uint64_t hash = HashHeader(images.size(), images.dimension(), sizeof(T));
+    for (std::size_t i = 0; i < images.size(); i++)
+        hash = HashBytes(hash, images.row(i), images.dimension() * sizeof(T));
+    return FinishHash(hash);
+}
+
+// The rows of the chunks are hashed in the order of the file, so the hash is the one of the file read at once
+template <typename T>
+uint64_t HashImages(DatasetStream<T> &images)
+{
+    uint64_t hash = HashHeader(images.size(), images.GetLayout().dimension, sizeof(T));
+    while (images.Next())
+    {
+        const Dataset<T> &chunk = images.Chunk();
+        for (std::size_t i = 0; i < chunk.size(); i++)
+            hash = HashBytes(hash, chunk.row(i), chunk.dimension() * sizeof(T));
+    }
+    return FinishHash(hash);
+}
+
+std::string GroundTruthPrefix(const std::string &directory, const char *metric, int k, uint64_t imagesHash, uint64_t queriesHash)
+{
+    std::ostringstream prefix;
+    prefix << directory << "/" << metric << "-k" << k << "-" << std::hex << std::setfill('0') << std::setw(16)
+           << FinishHash(imagesHash ^ FinishHash(queriesHash));
+    return prefix.str();
+}
+
+static void MakeDirectory(const std::string &directory)
+{
+    if (mkdir(directory.c_str(), 0755) < 0 && errno != EEXIST)
+    {
+        std::cerr << "Failed to create the ground truth directory " << directory << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+template <typename T, typename Distance>
+bool CachedBruteForce(const std::string &directory, const Dataset<T> &images, const std::vector<ImageView<T>> &queries, int k,
+                      const Distance &distance, std::vector<std::vector<Neighbor>> &results)
+{
+    if (directory.empty())
+    {
+        BruteForceBatch(images, queries, k, distance, results);
+        return false;
+    }
+
+    std::string prefix = GroundTruthPrefix(directory, Distance::name(), k, HashImages(images), HashImages(queries));
+    if (ReadGroundTruth<Distance>(prefix, queries.size(), k, results))
+        return true;
+
+    MakeDirectory(directory);
+    BruteForceBatch(images, queries, k, distance, results);
+    WriteGroundTruth<Distance>(prefix, results);
+    return false;
+}
+
+template <typename T, typename Distance>
+ChunkedGroundTruth<T, Distance>::ChunkedGroundTruth(const std::string &directory, const Dataset<T> &images, uint64_t queriesHash,
+                                                    std::size_t numQueries, int k)
+    : directory(directory), images(images), numQueries(numQueries), k(k), fromCache(false), answered(0)
+{
+    if (directory.empty())
+        return;
+    prefix = GroundTruthPrefix(directory, Distance::name(), k, HashImages(images), queriesHash);
+    fromCache = ReadGroundTruth<Distance>(prefix, numQueries, k, rows);
+    if (!fromCache)
+        rows.resize(numQueries);
+}
+
+template <typename T, typename Distance>
+void ChunkedGroundTruth<T, Distance>::Chunk(const std::vector<ImageView<T>> &queries, std::size_t offset, const Distance &distance,
+                                            std::vector<std::vector<Neighbor>> &results)
+{
+    if (fromCache)
+    {
+        results.assign(rows.begin() + offset, rows.begin() + offset + queries.size());
+        return;
+    }
+
+    BruteForceBatch(images, queries, k, distance, results);
+    if (directory.empty())
+        return;
+    std::copy(results.begin(), results.end(), rows.begin() + offset);
+    answered += queries.size();
+    if (answered == numQueries)
+    {
+        MakeDirectory(directory);
+        WriteGroundTruth<Distance>(prefix, rows);
+    }
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template void WriteGroundTruth<EuclideanDistance>(const std::string &, const std::vector<std::vector<Neighbor>> &);
+template void WriteGroundTruth<ManhattanDistance>(const std::string &, const std::vector<std::vector<Neighbor>> &);
+template bool ReadGroundTruth<EuclideanDistance>(const std::string &, std::size_t, int, std::vector<std::vector<Neighbor>> &);
+template bool ReadGroundTruth<ManhattanDistance>(const std::string &, std::size_t, int, std::vector<std::vector<Neighbor>> &);
+
+template uint64_t HashImages(const std::vector<ImageView<uint8_t>> &);
+template uint64_t HashImages(const std::vector<ImageView<float>> &);
+template uint64_t HashImages(const std::vector<ImageView<double>> &);
+template uint64_t HashImages(const Dataset<uint8_t> &);
+template uint64_t HashImages(const Dataset<float> &);
+template uint64_t HashImages(const Dataset<double> &);
+template uint64_t HashImages(DatasetStream<uint8_t> &);
+template uint64_t HashImages(DatasetStream<float> &);
+template uint64_t HashImages(DatasetStream<double> &);
+template bool CachedBruteForce(const std::string &, const Dataset<uint8_t> &, const std::vector<ImageView<uint8_t>> &, int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template bool CachedBruteForce(const std::string &, const Dataset<float> &, const std::vector<ImageView<float>> &, int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template bool CachedBruteForce(const std::string &, const Dataset<double> &, const std::vector<ImageView<double>> &, int, const EuclideanDistance &, std::vector<std::vector<Neighbor>> &);
+template bool CachedBruteForce(const std::string &, const Dataset<uint8_t> &, const std::vector<ImageView<uint8_t>> &, int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template bool CachedBruteForce(const std::string &, const Dataset<float> &, const std::vector<ImageView<float>> &, int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template bool CachedBruteForce(const std::string &, const Dataset<double> &, const std::vector<ImageView<double>> &, int, const ManhattanDistance &, std::vector<std::vector<Neighbor>> &);
+template class ChunkedGroundTruth<uint8_t, EuclideanDistance>;
+template class ChunkedGroundTruth<float, EuclideanDistance>;
+template class ChunkedGroundTruth<double, EuclideanDistance>;
+template class ChunkedGroundTruth<uint8_t, ManhattanDistance>;
+template class ChunkedGroundTruth<float, ManhattanDistance>;
+template class ChunkedGroundTruth<double, ManhattanDistance>;
\ No newline at end of file
@@ -0,0 +1,89 @@
+#ifndef GROUNDTRUTH_HPP_
+#define GROUNDTRUTH_HPP_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "DatasetStream.hpp"
+#include "PublicTypes.hpp"
+
+/**
+ * @brief Files with the exact nearest neighbors of a query set, so that the brute force runs once per query set and
+ * not once per run. They use the layout of the public ANN benchmarks: <prefix>.ivecs has one row per query with the
+ * ids of its nearest neighbors and <prefix>.fvecs the true distances to them, every row starts with its length as a
+ * 32-bit integer. The distances are converted with Distance::toDistance before they are written and with
+ * Distance::toRank when they are read, so the files do not depend on the rank distance of the metric
+ *
+ * @method WriteGroundTruth writes the results of the brute force
+ * @method ReadGroundTruth reads the k nearest of every query, returns false if the files do not exist or hold less
+ * than numQueries rows or less than k neighbors in a row
+ */
+template <typename Distance>
+void WriteGroundTruth(const std::string &prefix, const std::vector<std::vector<Neighbor>> &results);
+
+template <typename Distance>
+bool ReadGroundTruth(const std::string &prefix, std::size_t numQueries, int k, std::vector<std::vector<Neighbor>> &results);
+
+/**
+ * @brief A cache of ground truth files in a directory. The files of a search are named after the metric, k and a 64-bit
+ * hash of the pixels of the input and of the queries, so a run finds the files of the same search whatever the paths
+ * of the image files were, and never the files of another subset of them
+ *
+ * @method HashImages hashes the number, dimension, pixel type and pixels of images. The hash of a stream reads the
+ * rest of it chunk by chunk and is the one of the whole file
+ * @method GroundTruthPrefix the prefix of the files of a search in the directory
+ * @method CachedBruteForce reads the ground truth of the search from the directory, or computes it with the batch brute
+ * force and writes it there. An empty directory always computes it
+ * @return whether the ground truth was read from the cache
+ */
+template <typename T>
+uint64_t HashImages(const std::vector<ImageView<T>> &images);
+
+template <typename T>
+uint64_t HashImages(const Dataset<T> &images);
+
+template <typename T>
+uint64_t HashImages(DatasetStream<T> &images);
+
+std::string GroundTruthPrefix(const std::string &directory, const char *metric, int k, uint64_t imagesHash, uint64_t queriesHash);
+
+template <typename T, typename Distance>
+bool CachedBruteForce(const std::string &directory, const Dataset<T> &images, const std::vector<ImageView<T>> &queries, int k,
+                      const Distance &distance, std::vector<std::vector<Neighbor>> &results);
+
+/**
+ * @brief The ground truth cache of a query file that is answered in chunks. The entry is the one of the whole file,
+ * the one CachedBruteForce and the groundtruth tool write for it, and every chunk takes its rows from it. Without an
+ * entry every chunk runs the batch brute force, and the entry of the file is written once its last query is answered
+ *
+ * @param queriesHash the HashImages of the whole query file
+ * @param numQueries the number of queries of the file
+ *
+ * @method Chunk the exact neighbors of the queries of a chunk, offset is the position of its first query in the file
+ * @method cached whether the entry was read from the directory
+ */
+template <typename T, typename Distance>
+class ChunkedGroundTruth
+{
+private:
+    std::string directory;
+    std::string prefix;
+    const Dataset<T> &images;
+    std::size_t numQueries;
+    int k;
+    bool fromCache;
+    std::size_t answered;
+    std::vector<std::vector<Neighbor>> rows;
+
+public:
+    ChunkedGroundTruth(const std::string &directory, const Dataset<T> &images, uint64_t queriesHash, std::size_t numQueries, int k);
+
+    void Chunk(const std::vector<ImageView<T>> &queries, std::size_t offset, const Distance &distance, std::vector<std::vector<Neighbor>> &results);
+
+    inline bool cached() const { return fromCache; }
+};
+
+#endif
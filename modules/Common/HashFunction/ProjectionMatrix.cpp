@@ -0,0 +1,87 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+#include "ProjectionMatrix.hpp"
+#include "SimdKernels.hpp"
+
+const std::size_t ProjectionMatrix::BatchImages;
+
+// The projections of up to this many functions are kept on the stack
+static const std::size_t MaxLocalFunctions = 64;
+
+ProjectionMatrix::ProjectionMatrix(std::size_t dimension, int w) : dim(dimension), w(w), numFunctions(0) {}
+
+ProjectionMatrix::~ProjectionMatrix() {}
+
+std::size_t ProjectionMatrix::blockSize() const { return (numFunctions + ProjectionBlock - 1) / ProjectionBlock * ProjectionBlock; }
+
+// A new block of zero rows is added when the last one is full, then v becomes the next row of the last block. The
+// matrix grows by exactly one block, the few reallocations cost less than the unused half of a doubled matrix
+void ProjectionMatrix::AddFunction(const std::vector<double> &v, double t)
+{
+    if (v.size() != dim)
+    {
+        std::cerr << "ProjectionMatrix: a vector of dimension " << v.size() << " does not match the images of dimension " << dim << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (numFunctions % ProjectionBlock == 0)
+    {
+        matrix.reserve(matrix.size() + dim * ProjectionBlock);
+        matrix.resize(matrix.size() + dim * ProjectionBlock, 0.0);
+        shifts.resize(shifts.size() + ProjectionBlock, 0.0);
+    }
+
+    double *block = matrix.data() + numFunctions / ProjectionBlock * dim * ProjectionBlock;
+    std::size_t row = numFunctions % ProjectionBlock;
+    for (std::size_t i = 0; i < dim; i++)
+        block[i * ProjectionBlock + row] = v[i];
+    shifts[numFunctions] = t;
+    numFunctions++;
+}
+
+// All the blocks are projected in one pass. The values go through int64_t before uint64_t, converting a negative
+// double straight to an unsigned integer is undefined, so a negative value wraps around
+template <typename T>
+void ProjectionMatrix::hash(const T *pixels, uint64_t *hashes, double *fractions) const
+{
+    double local[MaxLocalFunctions];
+    std::vector<double> allocated;
+    double *projections = local;
+    if (blockSize() > MaxLocalFunctions)
+    {
+        allocated.resize(blockSize());
+        projections = allocated.data();
+    }
+
+    Project(matrix.data(), blockSize() / ProjectionBlock, pixels, dim, projections);
+    for (std::size_t f = 0; f < numFunctions; f++)
+    {
+        double value = (projections[f] + shifts[f]) / (double)w;
+        hashes[f] = (uint64_t)(int64_t)floor(value);
+        if (fractions)
+            fractions[f] = value - floor(value);
+    }
+}
+
+// The images are hashed in parallel, each writes its own row of hashes
+template <typename T>
+void ProjectionMatrix::hashBatch(const Dataset<T> &images, std::size_t first, std::size_t count, std::vector<uint64_t> &hashes, ThreadPool &pool) const
+{
+    std::size_t stride = blockSize();
+    hashes.resize(count * stride);
+    pool.ParallelFor(count, [&](std::size_t i, int)
+                     { hash(images.row(first + i), hashes.data() + i * stride); });
+}
+
+std::size_t ProjectionMatrix::memoryUsage() const { return matrix.capacity() * sizeof(double) + shifts.capacity() * sizeof(double); }
+
+// Explicit instantiations for the supported pixel types
+template void ProjectionMatrix::hash(const uint8_t *, uint64_t *, double *) const;
+template void ProjectionMatrix::hash(const float *, uint64_t *, double *) const;
+template void ProjectionMatrix::hash(const double *, uint64_t *, double *) const;
+template void ProjectionMatrix::hashBatch(const Dataset<uint8_t> &, std::size_t, std::size_t, std::vector<uint64_t> &, ThreadPool &) const;
+template void ProjectionMatrix::hashBatch(const Dataset<float> &, std::size_t, std::size_t, std::vector<uint64_t> &, ThreadPool &) const;
+template void ProjectionMatrix::hashBatch(const Dataset<double> &, std::size_t, std::size_t, std::vector<uint64_t> &, ThreadPool &) const;
@@ -0,0 +1,63 @@
+#ifndef PROJECTION_MATRIX_HPP_
+#define PROJECTION_MATRIX_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * @brief The hash functions h_i(p) = floor((v_i·p + t_i) / w) of an Lsh or a Cube, all stored in one matrix.
+ * The vectors v_i are the rows of the matrix, kept in blocks of ProjectionBlock interleaved rows, so that the
+ * projections of an image on all of them are computed in one vectorized pass over its pixels. The last block is
+ * padded with zero rows. Every projection is summed in the order of the pixels, so the hashes do not depend on the
+ * instruction set.
+ *
+ * @param dimension the number of pixels of an image
+ * @param w the window of every function
+ *
+ * @method dimension the number of pixels of an image
+ * @method AddFunction appends the function with vector v and shift t, functions are numbered in the order they are added
+ * @method size the number of functions
+ * @method blockSize size() rounded up to ProjectionBlock, the length of a row of hashBatch
+ * @method hash writes the value of every function for an image to hashes[0..size()), and if fractions is given where
+ * (v_i·p + t_i) / w lies in its window, in [0, 1), to fractions[0..size())
+ * @method hashBatch the values of every function for count images from first, hashes[i * blockSize() + f] is function f of image first + i
+ * @method memoryUsage bytes of the matrix and of the shifts
+ */
+class ProjectionMatrix
+{
+public:
+    // The number of images hashBatch is given at a time when a whole dataset is hashed, so the hashes stay small
+    static const std::size_t BatchImages = 16384;
+
+private:
+    std::size_t dim;
+    int w;
+    std::size_t numFunctions;
+    std::vector<double> matrix;
+    std::vector<double> shifts;
+
+public:
+    ProjectionMatrix(std::size_t dimension, int w);
+    ~ProjectionMatrix();
+
+    void AddFunction(const std::vector<double> &v, double t);
+
+    inline std::size_t size() const { return numFunctions; }
+    inline std::size_t dimension() const { return dim; }
+    std::size_t blockSize() const;
+
+    template <typename T>
+    void hash(const T *pixels, uint64_t *hashes, double *fractions = nullptr) const;
+
+    template <typename T>
+    void hashBatch(const Dataset<T> &images, std::size_t first, std::size_t count, std::vector<uint64_t> &hashes, ThreadPool &pool) const;
+
+    std::size_t memoryUsage() const;
+};
+
+#endif
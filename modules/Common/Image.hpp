@@ -2,21 +2,21 @@
 #define IMAGE_HPP_
 
 #include <iostream>
-#include <vector>
 
-// Defines a data point of a MNIST dataset. The id is stored to later indentify neighbors and images found in the range search
-// Pixels is stored as double due to clustering which creates data points with non-existing coordinates from the dataset
-class Image
+// Defines a lightweight view to a data point of a MNIST dataset. The pixels are owned by the Dataset the view was taken from.
+// The id is the row index of the image in its dataset and is stored to later indentify neighbors and images found in the range search
+// T is the type of a pixel: uint8_t for the raw MNIST data, float for data points with non-existing coordinates such as centroids
+template <typename T>
+class ImageView
 {
 public:
     int id;
-    std::vector<double> pixels;
+    int dimension;
+    const T *pixels;
 
-    Image(int id, const std::vector<double> &pixels) : id(id), pixels(pixels) {}
+    ImageView(int id, int dimension, const T *pixels) : id(id), dimension(dimension), pixels(pixels) {}
 
-    Image() {}
-
-    ~Image() {}
+    ImageView() : id(-1), dimension(0), pixels(nullptr) {}
 };
 
 #endif
\ No newline at end of file
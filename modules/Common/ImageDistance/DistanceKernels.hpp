@@ -0,0 +1,109 @@
+#ifndef DISTANCE_KERNELS_HPP_
+#define DISTANCE_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Selects the types the distance kernels compute with for a pair of pixel types.
+ * Two uint8_t images are compared exactly in integers. Any other pair, such as uint8_t pixels
+ * against a float query or centroid, goes through float, unless one side is double.
+ *
+ * @param Difference type of the difference of two pixels
+ * @param Sum type the differences are accumulated in
+ */
+template <typename T, typename U>
+class KernelTraits
+{
+public:
+    typedef float Difference;
+    typedef float Sum;
+};
+
+template <>
+class KernelTraits<uint8_t, uint8_t>
+{
+public:
+    typedef int32_t Difference;
+    typedef uint64_t Sum;
+};
+
+template <>
+class KernelTraits<double, double>
+{
+public:
+    typedef double Difference;
+    typedef double Sum;
+};
+
+template <>
+class KernelTraits<double, float>
+{
+public:
+    typedef double Difference;
+    typedef double Sum;
+};
+
+// Sum of the squared differences of two images of dim pixels
+template <typename T, typename U>
+inline typename KernelTraits<T, U>::Sum SquaredEuclideanKernel(const T *first, const U *second, std::size_t dim)
+{
+    typedef typename KernelTraits<T, U>::Difference Difference;
+    typename KernelTraits<T, U>::Sum result = 0;
+    for (std::size_t i = 0; i < dim; i++)
+    {
+        Difference difference = (Difference)first[i] - (Difference)second[i];
+        result += difference * difference;
+    }
+    return result;
+}
+
+// Sum of the absolute differences of two images of dim pixels
+template <typename T, typename U>
+inline typename KernelTraits<T, U>::Sum ManhattanKernel(const T *first, const U *second, std::size_t dim)
+{
+    typedef typename KernelTraits<T, U>::Difference Difference;
+    typename KernelTraits<T, U>::Sum result = 0;
+    for (std::size_t i = 0; i < dim; i++)
+    {
+        Difference difference = (Difference)first[i] - (Difference)second[i];
+        result += difference < 0 ? -difference : difference;
+    }
+    return result;
+}
+
+// Number of queries the inner product kernels multiply with an image at a time, the register tile of the brute force
+static const std::size_t InnerProductTile = 4;
+
+// Inner products of one image with InnerProductTile queries of dim pixels, written to result[0..InnerProductTile)
+template <typename T>
+inline void InnerProductsKernel(const T *image, const T *const *queries, std::size_t dim, typename KernelTraits<T, T>::Sum *result)
+{
+    typedef typename KernelTraits<T, T>::Difference Product;
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = 0;
+    for (std::size_t i = 0; i < dim; i++)
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += (Product)image[i] * (Product)queries[j][i];
+}
+
+// Number of rows of a projection matrix that are interleaved, one 512-bit register of doubles
+static const std::size_t ProjectionBlock = 8;
+
+// Multiplies a vector of dim values with numBlocks blocks of ProjectionBlock rows, written to result[0..numBlocks * ProjectionBlock).
+// Block b stores its rows interleaved: matrix[(b * dim + i) * ProjectionBlock + r] is value i of row r. Every row is summed
+// in the order of its values, so the results are the same as those of one dot product per row
+template <typename T>
+inline void ProjectKernel(const double *matrix, std::size_t numBlocks, const T *x, std::size_t dim, double *result)
+{
+    for (std::size_t b = 0; b < numBlocks; b++, matrix += dim * ProjectionBlock, result += ProjectionBlock)
+    {
+        for (std::size_t r = 0; r < ProjectionBlock; r++)
+            result[r] = 0.0;
+        for (std::size_t i = 0; i < dim; i++)
+            for (std::size_t r = 0; r < ProjectionBlock; r++)
+                result[r] += matrix[i * ProjectionBlock + r] * (double)x[i];
+    }
+}
+
+#endif
@@ -1,44 +1,120 @@
 #ifndef ImageDistance_HPP_
 #define ImageDistance_HPP_
 
-#include <iostream>
-#include <vector>
+#include <cmath>
+#include <cstdint>
 
-#include "PublicTypes.hpp"
+#include "Image.hpp"
+#include "SimdKernels.hpp"
 
 /**
- * @brief singleton class that stores the metric that is preffered.
- * In the main call setMetric and then get access to the instance
- * with getInstance method.
- * @param metric choose from DistanceMetric enum
+ * @brief The distance functors. The metric is a template parameter of BruteForce, Lsh, Cube, GNNS and Mrng,
+ * so every call is resolved at compile time and inlined in the candidate loops of the algorithm.
+ * Each functor keeps the kernel table chosen for the running CPU, and indexes with different metrics
+ * can be used side by side in the same program.
+ * Images of the same pixel type (uint8_t, float, double) go through the vectorized kernels and any
+ * other pair, e.g. uint8_t images against a float centroid, through the portable ones.
+ * The functors return a rank distance that only preserves the order of the true distances, the squared
+ * distance for the euclidean metric, so ranking and pruning never call sqrt.
  *
+ * @method name the name of the metric, as given on the command line
+ * @method toDistance converts a rank distance to the true distance, apply it only to the reported results
+ * @method toRank converts a true distance, e.g. the radius of a range search, to a rank distance
+ * @method distance_if_less the rank distance if it is at most bound, else any value larger than bound, see BoundedKernel
+ * and the bounded float kernels.
+ * The candidate loops pass the farthest of the k nearest so far, so that a candidate that cannot enter them is dropped
+ * after part of its pixels
  */
-class ImageDistance
+class EuclideanDistance
 {
 private:
-    static DistanceMetric metric;
+    const DistanceKernelTable *kernels;
 
-    static ImageDistance instance;
-
-    static bool isMetricSet;
+public:
+    EuclideanDistance() : kernels(&ActiveKernels()) {}
+    static const char *name() { return "euclidean"; }
+    static double toDistance(double rank) { return sqrt(rank); }
+    static double toRank(double distance) { return distance * distance; }
 
-    ImageDistance();
+    double operator()(const ImageView<uint8_t> &first, const ImageView<uint8_t> &second) const
+    {
+        return (double)kernels->squaredEuclideanU8(first.pixels, second.pixels, first.dimension);
+    }
+    double operator()(const ImageView<float> &first, const ImageView<float> &second) const
+    {
+        return (double)kernels->squaredEuclideanF32(first.pixels, second.pixels, first.dimension);
+    }
+    double operator()(const ImageView<double> &first, const ImageView<double> &second) const
+    {
+        return kernels->squaredEuclideanF64(first.pixels, second.pixels, first.dimension);
+    }
+    template <typename T, typename U>
+    double operator()(const ImageView<T> &first, const ImageView<U> &second) const
+    {
+        return (double)SquaredEuclideanKernel(first.pixels, second.pixels, first.dimension);
+    }
 
-    double EuclideanImageDistance(const ImagePtr &first, const ImagePtr &second);
+    double distance_if_less(const ImageView<uint8_t> &first, const ImageView<uint8_t> &second, double bound) const
+    {
+        return (double)BoundedKernel(kernels->squaredEuclideanU8, first.pixels, second.pixels, first.dimension, IntegerBound(bound));
+    }
+    double distance_if_less(const ImageView<float> &first, const ImageView<float> &second, double bound) const
+    {
+        return (double)kernels->boundedSquaredEuclideanF32(first.pixels, second.pixels, first.dimension, FloatBound(bound));
+    }
+    double distance_if_less(const ImageView<double> &first, const ImageView<double> &second, double bound) const
+    {
+        return kernels->boundedSquaredEuclideanF64(first.pixels, second.pixels, first.dimension, bound);
+    }
+    // The portable kernels of mixed pixel types compute the whole distance
+    template <typename T, typename U>
+    double distance_if_less(const ImageView<T> &first, const ImageView<U> &second, double) const { return (*this)(first, second); }
+};
 
-    double ManhattanImageDistance(const ImagePtr &first, const ImagePtr &second);
+class ManhattanDistance
+{
+private:
+    const DistanceKernelTable *kernels;
 
 public:
-    ~ImageDistance();
-    static void setMetric(DistanceMetric metric);
-    static ImageDistance *getInstance();
-    double calculate(const ImagePtr &input, const ImagePtr &query);
-
-    // Delete copy/move constructors and assignment operators
-    ImageDistance(const ImageDistance &) = delete;
-    ImageDistance &operator=(const ImageDistance &) = delete;
-    ImageDistance(ImageDistance &&) = delete;
-    ImageDistance &operator=(ImageDistance &&) = delete;
+    ManhattanDistance() : kernels(&ActiveKernels()) {}
+    static const char *name() { return "manhattan"; }
+    static double toDistance(double rank) { return rank; }
+    static double toRank(double distance) { return distance; }
+
+    double operator()(const ImageView<uint8_t> &first, const ImageView<uint8_t> &second) const
+    {
+        return (double)kernels->manhattanU8(first.pixels, second.pixels, first.dimension);
+    }
+    double operator()(const ImageView<float> &first, const ImageView<float> &second) const
+    {
+        return (double)kernels->manhattanF32(first.pixels, second.pixels, first.dimension);
+    }
+    double operator()(const ImageView<double> &first, const ImageView<double> &second) const
+    {
+        return kernels->manhattanF64(first.pixels, second.pixels, first.dimension);
+    }
+    template <typename T, typename U>
+    double operator()(const ImageView<T> &first, const ImageView<U> &second) const
+    {
+        return (double)ManhattanKernel(first.pixels, second.pixels, first.dimension);
+    }
+
+    double distance_if_less(const ImageView<uint8_t> &first, const ImageView<uint8_t> &second, double bound) const
+    {
+        return (double)BoundedKernel(kernels->manhattanU8, first.pixels, second.pixels, first.dimension, IntegerBound(bound));
+    }
+    double distance_if_less(const ImageView<float> &first, const ImageView<float> &second, double bound) const
+    {
+        return (double)kernels->boundedManhattanF32(first.pixels, second.pixels, first.dimension, FloatBound(bound));
+    }
+    double distance_if_less(const ImageView<double> &first, const ImageView<double> &second, double bound) const
+    {
+        return kernels->boundedManhattanF64(first.pixels, second.pixels, first.dimension, bound);
+    }
+    // The portable kernels of mixed pixel types compute the whole distance
+    template <typename T, typename U>
+    double distance_if_less(const ImageView<T> &first, const ImageView<U> &second, double) const { return (*this)(first, second); }
 };
 
 #endif
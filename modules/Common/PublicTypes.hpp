@@ -7,21 +7,15 @@
 
 // Define types that should be used across multiple modules or programs
 
-typedef Image *ImagePtr;
-
-enum class DistanceMetric
-{
-    MANHATTAN,
-    EUCLIDEAN
-};
-
+// A neighbor is identified by its row index in the input dataset. The distance is the rank distance of the
+// metric (squared for euclidean), the programs convert it with Distance::toDistance before reporting it
 class Neighbor
 {
 public:
-    ImagePtr image;
+    int id;
     double distance;
     Neighbor() {}
-    Neighbor(ImagePtr image, double distance) : image(image), distance(distance) {}
+    Neighbor(int id, double distance) : id(id), distance(distance) {}
     ~Neighbor() {}
 };
 
@@ -35,4 +29,15 @@ public:
     }
 };
 
+// Orders by distance and then by id, so a set of neighbors keeps different images at the same distance, e.g. images
+// with the same PQ code, and only drops the same image found twice
+class CompareNeighborId
+{
+public:
+    bool operator()(const Neighbor &a, const Neighbor &b) const
+    {
+        return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+    }
+};
+
 #endif
\ No newline at end of file
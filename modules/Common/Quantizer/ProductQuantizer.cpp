@@ -0,0 +1,185 @@
+#include <iostream>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+#include "ProductQuantizer.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "Utils.hpp"
+
+const int ProductQuantizer::Centroids;
+
+// The index of the centroid of a codebook nearest to x, both have the pixels of one range
+static int NearestCentroid(const float *centroids, std::size_t subDim, const float *x, const EuclideanDistance &distance)
+{
+    ImageView<float> point(-1, (int)subDim, x);
+    int nearest = 0;
+    double minimum = std::numeric_limits<double>::infinity();
+    for (int c = 0; c < ProductQuantizer::Centroids; c++)
+    {
+        double dist = distance(point, ImageView<float>(c, (int)subDim, centroids + c * subDim));
+        if (dist < minimum)
+        {
+            minimum = dist;
+            nearest = c;
+        }
+    }
+    return nearest;
+}
+
+template <typename T>
+ProductQuantizer::ProductQuantizer(const Dataset<T> &images, int numSubspaces, int iterations, std::size_t sampleSize)
+    : dim(images.dimension()), numSubspaces(numSubspaces)
+{
+    if (numSubspaces < 1 || (std::size_t)numSubspaces > dim)
+    {
+        std::cerr << "ProductQuantizer: " << numSubspaces << " subspaces do not split images of dimension " << dim << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (images.size() == 0)
+    {
+        std::cerr << "ProductQuantizer: the codebooks cannot be trained without images" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The ranges differ by at most one pixel
+    offsets.resize(numSubspaces + 1);
+    for (int m = 0; m <= numSubspaces; m++)
+        offsets[m] = m * dim / numSubspaces;
+    codebooks.resize(dim * Centroids);
+
+    // The sample is converted to float once and shared by the codebooks, which are trained in parallel
+    std::size_t count = std::min(images.size(), std::max<std::size_t>(1, sampleSize));
+    std::vector<float> sample(count * dim);
+    for (std::size_t s = 0; s < count; s++)
+    {
+        const T *row = images.row(s * images.size() / count);
+        std::copy(row, row + dim, sample.begin() + s * dim);
+    }
+    ThreadPool::Default().ParallelFor(numSubspaces, [&](std::size_t m, int)
+                                      { Train(m, sample, count, iterations); });
+
+    codes.resize(images.size() * numSubspaces);
+    ThreadPool::Default().ParallelFor(images.size(), [&](std::size_t i, int)
+                                      { Encode(images.row(i), codes.data() + i * numSubspaces); });
+}
+
+ProductQuantizer::~ProductQuantizer() {}
+
+// k-means++ seeds the codebook of a range, then Lloyd iterations move every centroid to the mean of its points until
+// no point changes centroid. A centroid left without points takes a random point. The draws come from the stream of
+// the range, so the codebooks do not depend on the threads
+void ProductQuantizer::Train(int subspace, const std::vector<float> &sample, std::size_t sampleSize, int iterations)
+{
+    const std::size_t first = offsets[subspace], subDim = offsets[subspace + 1] - first;
+    float *centroids = codebooks.data() + first * Centroids;
+    Xoshiro256 generator = RandomStream(QuantizerStreams + subspace);
+    EuclideanDistance distance;
+    auto point = [&](std::size_t s)
+    { return sample.data() + s * dim + first; };
+
+    std::vector<double> nearest(sampleSize, std::numeric_limits<double>::infinity()), partial(sampleSize);
+    const float *seed = point(generator.Uniform(sampleSize));
+    std::copy(seed, seed + subDim, centroids);
+    for (int c = 1; c < Centroids; c++)
+    {
+        ImageView<float> last(c - 1, (int)subDim, centroids + (c - 1) * subDim);
+        double total = 0;
+        for (std::size_t s = 0; s < sampleSize; s++)
+        {
+            nearest[s] = std::min(nearest[s], distance(ImageView<float>(-1, (int)subDim, point(s)), last));
+            partial[s] = total += nearest[s];
+        }
+        // Every point is already a centroid when the sample has fewer distinct points than the codebook
+        std::size_t chosen = total > 0 ? std::min<std::size_t>(binarySearch(partial, generator.UniformReal() * total), sampleSize - 1)
+                                       : generator.Uniform(sampleSize);
+        std::copy(point(chosen), point(chosen) + subDim, centroids + c * subDim);
+    }
+
+    std::vector<int> assignment(sampleSize, -1), counts(Centroids);
+    std::vector<double> sums(Centroids * subDim);
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        bool changed = false;
+        for (std::size_t s = 0; s < sampleSize; s++)
+        {
+            int c = NearestCentroid(centroids, subDim, point(s), distance);
+            changed = changed || c != assignment[s];
+            assignment[s] = c;
+        }
+        if (!changed)
+            break;
+
+        std::fill(sums.begin(), sums.end(), 0.0);
+        std::fill(counts.begin(), counts.end(), 0);
+        for (std::size_t s = 0; s < sampleSize; s++)
+        {
+            counts[assignment[s]]++;
+            for (std::size_t j = 0; j < subDim; j++)
+                sums[assignment[s] * subDim + j] += point(s)[j];
+        }
+        for (int c = 0; c < Centroids; c++)
+        {
+            if (counts[c] == 0)
+            {
+                const float *random = point(generator.Uniform(sampleSize));
+                std::copy(random, random + subDim, centroids + c * subDim);
+            }
+            else
+                for (std::size_t j = 0; j < subDim; j++)
+                    centroids[c * subDim + j] = sums[c * subDim + j] / counts[c];
+        }
+    }
+}
+
+void ProductQuantizer::EncodeFloats(const float *pixels, uint8_t *code) const
+{
+    EuclideanDistance distance;
+    for (int m = 0; m < numSubspaces; m++)
+        code[m] = NearestCentroid(codebooks.data() + offsets[m] * Centroids, offsets[m + 1] - offsets[m], pixels + offsets[m], distance);
+}
+
+// The pixels are converted to float once, so every range goes through the vectorized float kernels
+template <typename T>
+void ProductQuantizer::Encode(const T *pixels, uint8_t *code) const
+{
+    std::vector<float> converted(pixels, pixels + dim);
+    EncodeFloats(converted.data(), code);
+}
+
+template <typename Distance, typename T>
+void ProductQuantizer::Table(const T *query, std::vector<float> &table) const
+{
+    std::vector<float> converted(query, query + dim);
+    Distance distance;
+    table.resize(numSubspaces * Centroids);
+    for (int m = 0; m < numSubspaces; m++)
+    {
+        std::size_t subDim = offsets[m + 1] - offsets[m];
+        const float *centroids = codebooks.data() + offsets[m] * Centroids;
+        ImageView<float> range(-1, (int)subDim, converted.data() + offsets[m]);
+        for (int c = 0; c < Centroids; c++)
+            table[m * Centroids + c] = distance(range, ImageView<float>(c, (int)subDim, centroids + c * subDim));
+    }
+}
+
+std::size_t ProductQuantizer::memoryUsage() const
+{
+    return codes.capacity() + codebooks.capacity() * sizeof(float) + offsets.capacity() * sizeof(std::size_t);
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template ProductQuantizer::ProductQuantizer(const Dataset<uint8_t> &, int, int, std::size_t);
+template ProductQuantizer::ProductQuantizer(const Dataset<float> &, int, int, std::size_t);
+template ProductQuantizer::ProductQuantizer(const Dataset<double> &, int, int, std::size_t);
+template void ProductQuantizer::Encode(const uint8_t *, uint8_t *) const;
+template void ProductQuantizer::Encode(const float *, uint8_t *) const;
+template void ProductQuantizer::Encode(const double *, uint8_t *) const;
+template void ProductQuantizer::Table<EuclideanDistance>(const uint8_t *, std::vector<float> &) const;
+template void ProductQuantizer::Table<EuclideanDistance>(const float *, std::vector<float> &) const;
+template void ProductQuantizer::Table<EuclideanDistance>(const double *, std::vector<float> &) const;
+template void ProductQuantizer::Table<ManhattanDistance>(const uint8_t *, std::vector<float> &) const;
+template void ProductQuantizer::Table<ManhattanDistance>(const float *, std::vector<float> &) const;
+template void ProductQuantizer::Table<ManhattanDistance>(const double *, std::vector<float> &) const;
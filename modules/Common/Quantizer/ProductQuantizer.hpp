@@ -0,0 +1,78 @@
+#ifndef PRODUCT_QUANTIZER_HPP_
+#define PRODUCT_QUANTIZER_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+
+/**
+ * @brief A product quantizer of the images of a dataset. The pixels are split in numSubspaces consecutive ranges and
+ * every range has a codebook of Centroids centroids, trained with k-means on a sample of the images. An image is
+ * stored as its code, the index of the nearest centroid of every range, one byte per range instead of the whole image.
+ * The distance of a query to a code is a sum of numSubspaces entries of the table of the query (asymmetric distance),
+ * the entry of a range and a centroid is the rank distance of the pixels of the query in the range to the centroid.
+ * The codebooks are trained and the codes assigned with the euclidean metric, the tables can be computed for any
+ * metric whose rank distance is a sum over the pixels
+ *
+ * @param dim the number of pixels of an image
+ * @param numSubspaces the number of ranges, the bytes of a code
+ * @param offsets the first pixel of every range, offsets[numSubspaces] is dim
+ * @param codebooks the centroids of range m start at offsets[m] * Centroids, a centroid has the pixels of its range
+ * @param codes the code of image i starts at i * numSubspaces
+ *
+ * @method Encode writes the code of an image to code[0..subspaces())
+ * @method Table writes the table of a query for the metric Distance, table[m * Centroids + c] is the distance of the
+ * pixels of range m to centroid c
+ * @method Adc the distance of the query of a table to the code of an image of the dataset
+ * @method size the number of images of the dataset
+ * @method codesUsage bytes of the codes
+ * @method memoryUsage bytes of the codes and of the codebooks
+ */
+class ProductQuantizer
+{
+public:
+    // The centroids of every codebook, so that the index of one fits in a byte
+    static const int Centroids = 256;
+
+private:
+    std::size_t dim;
+    int numSubspaces;
+    std::vector<std::size_t> offsets;
+    std::vector<float> codebooks;
+    std::vector<uint8_t> codes;
+
+    void Train(int subspace, const std::vector<float> &sample, std::size_t sampleSize, int iterations);
+    void EncodeFloats(const float *pixels, uint8_t *code) const;
+
+public:
+    // The codebooks are trained on at most sampleSize images spread over the dataset, then every image is encoded
+    template <typename T>
+    ProductQuantizer(const Dataset<T> &images, int numSubspaces, int iterations = 10, std::size_t sampleSize = 10000);
+    ~ProductQuantizer();
+
+    template <typename T>
+    void Encode(const T *pixels, uint8_t *code) const;
+
+    template <typename Distance, typename T>
+    void Table(const T *query, std::vector<float> &table) const;
+
+    inline double Adc(const float *table, int id) const
+    {
+        const uint8_t *code = codes.data() + (std::size_t)id * numSubspaces;
+        float sum = 0;
+        for (int m = 0; m < numSubspaces; m++, table += Centroids)
+            sum += table[code[m]];
+        return sum;
+    }
+
+    inline int subspaces() const { return numSubspaces; }
+    inline std::size_t dimension() const { return dim; }
+    inline std::size_t size() const { return codes.size() / numSubspaces; }
+    inline std::size_t codesUsage() const { return codes.capacity(); }
+    std::size_t memoryUsage() const;
+};
+
+#endif
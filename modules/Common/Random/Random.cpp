@@ -0,0 +1,70 @@
+#include <cmath>
+#include <atomic>
+
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+
+static inline uint64_t SplitMix64(uint64_t &x) { return Mix64(x += 0x9e3779b97f4a7c15ULL); }
+
+Xoshiro256::Xoshiro256(uint64_t seed) : spare(0), hasSpare(false)
+{
+    for (int i = 0; i < 4; i++)
+        s[i] = SplitMix64(seed);
+}
+
+double Xoshiro256::Normal()
+{
+    if (hasSpare)
+    {
+        hasSpare = false;
+        return spare;
+    }
+
+    double u, v, r;
+    do
+    {
+        u = 2.0 * UniformReal() - 1.0;
+        v = 2.0 * UniformReal() - 1.0;
+        r = u * u + v * v;
+    } while (r >= 1.0 || r == 0.0);
+
+    double scale = std::sqrt(-2.0 * std::log(r) / r);
+    spare = v * scale;
+    hasSpare = true;
+    return u * scale;
+}
+
+static std::atomic<uint64_t> globalSeed(1);
+// Incremented by every SetSeed, a thread generator that was seeded before it is seeded again
+static std::atomic<unsigned> seedVersion(0);
+
+void SetSeed(uint64_t seed)
+{
+    globalSeed = seed;
+    seedVersion++;
+}
+
+uint64_t GetSeed() { return globalSeed; }
+
+Xoshiro256 RandomStream(uint64_t stream)
+{
+    uint64_t mix = stream;
+    return Xoshiro256(globalSeed ^ SplitMix64(mix));
+}
+
+// Every thread is seeded from the seed and its index in the pool, in the range of ThreadStreams
+Xoshiro256 &ThreadGenerator()
+{
+    static thread_local Xoshiro256 generator;
+    static thread_local unsigned version = (unsigned)-1;
+    static thread_local int thread = -1;
+
+    int current = ThreadPool::CurrentThread();
+    if (version != seedVersion || thread != current)
+    {
+        generator = RandomStream(ThreadStreams + (uint64_t)current);
+        version = seedVersion;
+        thread = current;
+    }
+    return generator;
+}
@@ -0,0 +1,77 @@
+#ifndef RANDOM_HPP_
+#define RANDOM_HPP_
+
+#include <cstdint>
+
+/**
+ * @brief The xoshiro256** generator: 32 bytes of state, a few shifts and multiplications per draw and a period of
+ * 2^256 - 1. It meets the UniformRandomBitGenerator requirements, so it works with the std distributions and std::shuffle.
+ * The state is filled from the 64-bit seed with splitmix64, so close seeds give unrelated streams.
+ *
+ * @method Uniform returns an integer in [0, n) with Lemire's multiply and shift, n must be positive
+ * @method UniformReal returns a double in [0, 1) from the top 53 bits
+ * @method Normal returns a standard normal value with the polar method, the second value of a pair is kept for the next call
+ */
+class Xoshiro256
+{
+private:
+    uint64_t s[4];
+    double spare;
+    bool hasSpare;
+
+    static inline uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(uint64_t seed = 0);
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+
+    inline result_type operator()()
+    {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    inline uint64_t Uniform(uint64_t n) { return (uint64_t)(((unsigned __int128)(*this)() * n) >> 64); }
+    inline double UniformReal() { return ((*this)() >> 11) * (1.0 / 9007199254740992.0); }
+    double Normal();
+};
+
+// The splitmix64 finalizer, a stateless hash of x in which every bit depends on every bit of x
+inline uint64_t Mix64(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+// The seed every stream is derived from, 1 unless it is set with -seed before anything random is drawn
+void SetSeed(uint64_t seed);
+uint64_t GetSeed();
+
+// The first stream of every user of RandomStream. The ranges are far apart, so the streams of the queries of GNNS,
+// of the images of NN-Descent, of the codebooks of a quantizer and of the threads never meet
+static const uint64_t GnnsStreams = (uint64_t)1 << 56;
+static const uint64_t NnDescentStreams = (uint64_t)2 << 56;
+static const uint64_t QuantizerStreams = (uint64_t)3 << 56;
+static const uint64_t ThreadStreams = (uint64_t)1 << 63;
+
+// A generator of its own for a numbered stream of the current seed. The same seed and stream always give the same
+// draws, whatever thread uses them, so a parallel loop that takes the stream of every index is reproducible
+Xoshiro256 RandomStream(uint64_t stream);
+
+// The generator of the calling thread, the stream of its index in the thread pool. Draws on the thread that runs
+// main are reproducible, the draws of the pool threads depend on which indices they run
+Xoshiro256 &ThreadGenerator();
+
+#endif
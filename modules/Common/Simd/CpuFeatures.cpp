@@ -0,0 +1,46 @@
+#include <cstdint>
+
+#include "CpuFeatures.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+
+// Reads the extended control register 0, which tells which register states the operating system saves
+static uint64_t ReadXcr0()
+{
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+}
+#endif
+
+CpuFeatures::CpuFeatures() : sse2(false), avx2(false), avx512(false)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return;
+
+    sse2 = edx & (1u << 26);
+    bool fma = ecx & (1u << 12);
+    bool osxsave = ecx & (1u << 27);
+    bool avx = ecx & (1u << 28);
+
+    // XMM and YMM state (bits 1, 2) for AVX, plus opmask and ZMM state (bits 5, 6, 7) for AVX-512
+    uint64_t xcr0 = osxsave ? ReadXcr0() : 0;
+    bool osAvx = (xcr0 & 0x6) == 0x6;
+    bool osAvx512 = (xcr0 & 0xE6) == 0xE6;
+
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+        return;
+
+    avx2 = avx && fma && osAvx && (ebx & (1u << 5));
+    avx512 = osAvx512 && (ebx & (1u << 16)) && (ebx & (1u << 30));
+#endif
+}
+
+const CpuFeatures &CpuFeatures::get()
+{
+    static const CpuFeatures features;
+    return features;
+}
@@ -0,0 +1,27 @@
+#ifndef CPU_FEATURES_HPP_
+#define CPU_FEATURES_HPP_
+
+/**
+ * @brief Instruction set extensions of the running CPU that the distance kernels can use.
+ * The flags are read once with CPUID, and AVX/AVX-512 are only reported when the operating
+ * system also saves the wider registers (checked with XGETBV).
+ *
+ * @param sse2 SSE2, always present on x86-64
+ * @param avx2 AVX2 together with FMA
+ * @param avx512 AVX-512 Foundation together with the Byte/Word instructions
+ */
+class CpuFeatures
+{
+public:
+    bool sse2;
+    bool avx2;
+    bool avx512;
+
+    // The features of this machine, detected on the first call
+    static const CpuFeatures &get();
+
+private:
+    CpuFeatures();
+};
+
+#endif
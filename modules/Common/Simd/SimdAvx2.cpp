@@ -0,0 +1,308 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "SimdKernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+
+// Number of 32 byte steps the uint8_t kernels accumulate in 32-bit lanes before they are widened to 64 bits
+static const std::size_t U8Block = 4096;
+
+AVX2_TARGET static uint64_t SumLanesU32(__m256i acc)
+{
+    alignas(32) uint32_t lanes[8];
+    _mm256_store_si256((__m256i *)lanes, acc);
+    uint64_t result = 0;
+    for (int i = 0; i < 8; i++)
+        result += lanes[i];
+    return result;
+}
+
+AVX2_TARGET static float SumLanes(__m256 acc)
+{
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+AVX2_TARGET static double SumLanes(__m256d acc)
+{
+    __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+    sum = _mm_add_sd(sum, _mm_unpackhi_pd(sum, sum));
+    return _mm_cvtsd_f64(sum);
+}
+
+// The bytes are widened to 16 bits, subtracted and squared-and-added in pairs with madd
+AVX2_TARGET static uint64_t SquaredEuclideanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    uint64_t result = 0;
+    std::size_t i = 0;
+    while (i + 32 <= dim)
+    {
+        __m256i acc = _mm256_setzero_si256();
+        for (std::size_t steps = 0; steps < U8Block && i + 32 <= dim; steps++, i += 32)
+        {
+            __m256i d0 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(first + i))),
+                                          _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(second + i))));
+            __m256i d1 = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(first + i + 16))),
+                                          _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(second + i + 16))));
+            acc = _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_madd_epi16(d0, d0), _mm256_madd_epi16(d1, d1)));
+        }
+        result += SumLanesU32(acc);
+    }
+    for (; i < dim; i++)
+    {
+        int32_t d = (int32_t)first[i] - (int32_t)second[i];
+        result += d * d;
+    }
+    return result;
+}
+
+template <bool Bounded>
+AVX2_TARGET static float SquaredEuclideanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = SumLanes(_mm256_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(first + i + 8), _mm256_loadu_ps(second + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i + 8 <= dim; i += 8)
+    {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+    }
+    float result = SumLanes(_mm256_add_ps(acc0, acc1));
+    for (; i < dim; i++)
+        result += (first[i] - second[i]) * (first[i] - second[i]);
+    return result;
+}
+AVX2_TARGET static float SquaredEuclideanF32(const float *first, const float *second, std::size_t dim) { return SquaredEuclideanF32Kernel<false>(first, second, dim, 0); }
+AVX2_TARGET static float BoundedSquaredEuclideanF32(const float *first, const float *second, std::size_t dim, float bound) { return SquaredEuclideanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+AVX2_TARGET static double SquaredEuclideanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = SumLanes(_mm256_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i));
+        __m256d d1 = _mm256_sub_pd(_mm256_loadu_pd(first + i + 4), _mm256_loadu_pd(second + i + 4));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm256_fmadd_pd(d1, d1, acc1);
+    }
+    for (; i + 4 <= dim; i += 4)
+    {
+        __m256d d0 = _mm256_sub_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i));
+        acc0 = _mm256_fmadd_pd(d0, d0, acc0);
+    }
+    double result = SumLanes(_mm256_add_pd(acc0, acc1));
+    for (; i < dim; i++)
+        result += (first[i] - second[i]) * (first[i] - second[i]);
+    return result;
+}
+AVX2_TARGET static double SquaredEuclideanF64(const double *first, const double *second, std::size_t dim) { return SquaredEuclideanF64Kernel<false>(first, second, dim, 0); }
+AVX2_TARGET static double BoundedSquaredEuclideanF64(const double *first, const double *second, std::size_t dim, double bound) { return SquaredEuclideanF64Kernel<true>(first, second, dim, bound); }
+
+// vpsadbw sums the absolute differences of 8 bytes into a 64-bit lane
+AVX2_TARGET static uint64_t ManhattanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    __m256i acc = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + 32 <= dim; i += 32)
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i *)(first + i)),
+                                                    _mm256_loadu_si256((const __m256i *)(second + i))));
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256((__m256i *)lanes, acc);
+    uint64_t result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+
+template <bool Bounded>
+AVX2_TARGET static float ManhattanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = SumLanes(_mm256_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i))));
+        acc1 = _mm256_add_ps(acc1, _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(first + i + 8), _mm256_loadu_ps(second + i + 8))));
+    }
+    for (; i + 8 <= dim; i += 8)
+        acc0 = _mm256_add_ps(acc0, _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(first + i), _mm256_loadu_ps(second + i))));
+    float result = SumLanes(_mm256_add_ps(acc0, acc1));
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+AVX2_TARGET static float ManhattanF32(const float *first, const float *second, std::size_t dim) { return ManhattanF32Kernel<false>(first, second, dim, 0); }
+AVX2_TARGET static float BoundedManhattanF32(const float *first, const float *second, std::size_t dim, float bound) { return ManhattanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+AVX2_TARGET static double ManhattanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = SumLanes(_mm256_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i))));
+        acc1 = _mm256_add_pd(acc1, _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(first + i + 4), _mm256_loadu_pd(second + i + 4))));
+    }
+    for (; i + 4 <= dim; i += 4)
+        acc0 = _mm256_add_pd(acc0, _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(first + i), _mm256_loadu_pd(second + i))));
+    double result = SumLanes(_mm256_add_pd(acc0, acc1));
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+AVX2_TARGET static double ManhattanF64(const double *first, const double *second, std::size_t dim) { return ManhattanF64Kernel<false>(first, second, dim, 0); }
+AVX2_TARGET static double BoundedManhattanF64(const double *first, const double *second, std::size_t dim, double bound) { return ManhattanF64Kernel<true>(first, second, dim, bound); }
+
+// The image is widened once and multiplied with the InnerProductTile queries, madd adds the products in pairs
+AVX2_TARGET static void InnerProductsU8(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result)
+{
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = 0;
+    std::size_t i = 0;
+    while (i + 32 <= dim)
+    {
+        __m256i acc[InnerProductTile] = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+        for (std::size_t steps = 0; steps < U8Block && i + 32 <= dim; steps++, i += 32)
+        {
+            __m256i x0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(image + i)));
+            __m256i x1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(image + i + 16)));
+            for (std::size_t j = 0; j < InnerProductTile; j++)
+            {
+                __m256i y0 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(queries[j] + i)));
+                __m256i y1 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(queries[j] + i + 16)));
+                acc[j] = _mm256_add_epi32(acc[j], _mm256_add_epi32(_mm256_madd_epi16(x0, y0), _mm256_madd_epi16(x1, y1)));
+            }
+        }
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += SumLanesU32(acc[j]);
+    }
+    for (; i < dim; i++)
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += (uint32_t)image[i] * queries[j][i];
+}
+
+AVX2_TARGET static void InnerProductsF32(const float *image, const float *const *queries, std::size_t dim, float *result)
+{
+    __m256 acc[InnerProductTile] = {_mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps()};
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8)
+    {
+        __m256 x = _mm256_loadu_ps(image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm256_fmadd_ps(x, _mm256_loadu_ps(queries[j] + i), acc[j]);
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+    {
+        result[j] = SumLanes(acc[j]);
+        for (std::size_t t = i; t < dim; t++)
+            result[j] += image[t] * queries[j][t];
+    }
+}
+
+AVX2_TARGET static void InnerProductsF64(const double *image, const double *const *queries, std::size_t dim, double *result)
+{
+    __m256d acc[InnerProductTile] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4)
+    {
+        __m256d x = _mm256_loadu_pd(image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm256_fmadd_pd(x, _mm256_loadu_pd(queries[j] + i), acc[j]);
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+    {
+        result[j] = SumLanes(acc[j]);
+        for (std::size_t t = i; t < dim; t++)
+            result[j] += image[t] * queries[j][t];
+    }
+}
+
+// The rows of a block fill two registers. Up to ProjectGroup blocks are summed together, so that their additions are
+// independent, and the values are multiplied and added separately so that every row is summed exactly like ProjectKernel
+static const std::size_t ProjectGroup = 2;
+
+template <typename T>
+AVX2_TARGET static void ProjectBlocks(const double *matrix, std::size_t numBlocks, const T *x, std::size_t dim, double *result)
+{
+    for (std::size_t first = 0; first < numBlocks; first += ProjectGroup)
+    {
+        std::size_t count = std::min(ProjectGroup, numBlocks - first);
+        const double *block = matrix + first * dim * ProjectionBlock;
+        __m256d acc[2 * ProjectGroup] = {_mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd()};
+        for (std::size_t i = 0; i < dim; i++)
+        {
+            __m256d value = _mm256_set1_pd((double)x[i]);
+            for (std::size_t g = 0; g < count; g++)
+            {
+                const double *row = block + (g * dim + i) * ProjectionBlock;
+                acc[2 * g] = _mm256_add_pd(acc[2 * g], _mm256_mul_pd(_mm256_loadu_pd(row), value));
+                acc[2 * g + 1] = _mm256_add_pd(acc[2 * g + 1], _mm256_mul_pd(_mm256_loadu_pd(row + 4), value));
+            }
+        }
+        for (std::size_t g = 0; g < count; g++)
+        {
+            _mm256_storeu_pd(result + (first + g) * ProjectionBlock, acc[2 * g]);
+            _mm256_storeu_pd(result + (first + g) * ProjectionBlock + 4, acc[2 * g + 1]);
+        }
+    }
+}
+
+AVX2_TARGET static void ProjectU8(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+AVX2_TARGET static void ProjectF32(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+AVX2_TARGET static void ProjectF64(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+
+static const DistanceKernelTable avx2Table = {"avx2",
+                                              SquaredEuclideanU8, SquaredEuclideanF32, SquaredEuclideanF64,
+                                              ManhattanU8, ManhattanF32, ManhattanF64,
+                                              BoundedSquaredEuclideanF32, BoundedSquaredEuclideanF64, BoundedManhattanF32, BoundedManhattanF64,
+                                              InnerProductsU8, InnerProductsF32, InnerProductsF64,
+                                              ProjectU8, ProjectF32, ProjectF64};
+
+const DistanceKernelTable *Avx2Kernels() { return &avx2Table; }
+
+#else
+
+const DistanceKernelTable *Avx2Kernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,267 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "SimdKernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// GCC 12 reports the self initialized _mm256_undefined_* values inside the reduce and extract intrinsics
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+#include <immintrin.h>
+
+#define AVX512_TARGET __attribute__((target("avx512f,avx512bw")))
+
+// Number of 32 byte steps the uint8_t kernels accumulate in 32-bit lanes before they are widened to 64 bits
+static const std::size_t U8Block = 4096;
+
+AVX512_TARGET static uint64_t SumLanesU32(__m512i acc)
+{
+    __m512i lo = _mm512_cvtepu32_epi64(_mm512_castsi512_si256(acc));
+    __m512i hi = _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(acc, 1));
+    return (uint64_t)_mm512_reduce_add_epi64(_mm512_add_epi64(lo, hi));
+}
+
+// The bytes are widened to 16 bits, subtracted and squared-and-added in pairs with madd
+AVX512_TARGET static uint64_t SquaredEuclideanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    uint64_t result = 0;
+    std::size_t i = 0;
+    while (i + 32 <= dim)
+    {
+        __m512i acc = _mm512_setzero_si512();
+        for (std::size_t steps = 0; steps < U8Block && i + 32 <= dim; steps++, i += 32)
+        {
+            __m512i d = _mm512_sub_epi16(_mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(first + i))),
+                                         _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(second + i))));
+            acc = _mm512_add_epi32(acc, _mm512_madd_epi16(d, d));
+        }
+        result += SumLanesU32(acc);
+    }
+    for (; i < dim; i++)
+    {
+        int32_t d = (int32_t)first[i] - (int32_t)second[i];
+        result += d * d;
+    }
+    return result;
+}
+
+// The tail is read with a masked load, so there is no scalar loop
+template <bool Bounded>
+AVX512_TARGET static float SquaredEuclideanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= dim; i += 32)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(first + i), _mm512_loadu_ps(second + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(first + i + 16), _mm512_loadu_ps(second + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i < dim; i += 16)
+    {
+        __mmask16 mask = dim - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (dim - i)) - 1);
+        __m512 d0 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, first + i), _mm512_maskz_loadu_ps(mask, second + i));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+AVX512_TARGET static float SquaredEuclideanF32(const float *first, const float *second, std::size_t dim) { return SquaredEuclideanF32Kernel<false>(first, second, dim, 0); }
+AVX512_TARGET static float BoundedSquaredEuclideanF32(const float *first, const float *second, std::size_t dim, float bound) { return SquaredEuclideanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+AVX512_TARGET static double SquaredEuclideanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m512d d0 = _mm512_sub_pd(_mm512_loadu_pd(first + i), _mm512_loadu_pd(second + i));
+        __m512d d1 = _mm512_sub_pd(_mm512_loadu_pd(first + i + 8), _mm512_loadu_pd(second + i + 8));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+        acc1 = _mm512_fmadd_pd(d1, d1, acc1);
+    }
+    for (; i < dim; i += 8)
+    {
+        __mmask8 mask = dim - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (dim - i)) - 1);
+        __m512d d0 = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, first + i), _mm512_maskz_loadu_pd(mask, second + i));
+        acc0 = _mm512_fmadd_pd(d0, d0, acc0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+AVX512_TARGET static double SquaredEuclideanF64(const double *first, const double *second, std::size_t dim) { return SquaredEuclideanF64Kernel<false>(first, second, dim, 0); }
+AVX512_TARGET static double BoundedSquaredEuclideanF64(const double *first, const double *second, std::size_t dim, double bound) { return SquaredEuclideanF64Kernel<true>(first, second, dim, bound); }
+
+// vpsadbw sums the absolute differences of 8 bytes into a 64-bit lane
+AVX512_TARGET static uint64_t ManhattanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    __m512i acc = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 64 <= dim; i += 64)
+        acc = _mm512_add_epi64(acc, _mm512_sad_epu8(_mm512_loadu_si512((const void *)(first + i)),
+                                                    _mm512_loadu_si512((const void *)(second + i))));
+    uint64_t result = (uint64_t)_mm512_reduce_add_epi64(acc);
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+
+template <bool Bounded>
+AVX512_TARGET static float ManhattanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 32 <= dim; i += 32)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm512_add_ps(acc0, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(first + i), _mm512_loadu_ps(second + i))));
+        acc1 = _mm512_add_ps(acc1, _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(first + i + 16), _mm512_loadu_ps(second + i + 16))));
+    }
+    for (; i < dim; i += 16)
+    {
+        __mmask16 mask = dim - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (dim - i)) - 1);
+        acc0 = _mm512_add_ps(acc0, _mm512_abs_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(mask, first + i), _mm512_maskz_loadu_ps(mask, second + i))));
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+AVX512_TARGET static float ManhattanF32(const float *first, const float *second, std::size_t dim) { return ManhattanF32Kernel<false>(first, second, dim, 0); }
+AVX512_TARGET static float BoundedManhattanF32(const float *first, const float *second, std::size_t dim, float bound) { return ManhattanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+AVX512_TARGET static double ManhattanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(first + i), _mm512_loadu_pd(second + i))));
+        acc1 = _mm512_add_pd(acc1, _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(first + i + 8), _mm512_loadu_pd(second + i + 8))));
+    }
+    for (; i < dim; i += 8)
+    {
+        __mmask8 mask = dim - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (dim - i)) - 1);
+        acc0 = _mm512_add_pd(acc0, _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(mask, first + i), _mm512_maskz_loadu_pd(mask, second + i))));
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(acc0, acc1));
+}
+AVX512_TARGET static double ManhattanF64(const double *first, const double *second, std::size_t dim) { return ManhattanF64Kernel<false>(first, second, dim, 0); }
+AVX512_TARGET static double BoundedManhattanF64(const double *first, const double *second, std::size_t dim, double bound) { return ManhattanF64Kernel<true>(first, second, dim, bound); }
+
+// The image is widened once and multiplied with the InnerProductTile queries, madd adds the products in pairs
+AVX512_TARGET static void InnerProductsU8(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result)
+{
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = 0;
+    std::size_t i = 0;
+    while (i + 32 <= dim)
+    {
+        __m512i acc[InnerProductTile] = {_mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512(), _mm512_setzero_si512()};
+        for (std::size_t steps = 0; steps < U8Block && i + 32 <= dim; steps++, i += 32)
+        {
+            __m512i x = _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(image + i)));
+            for (std::size_t j = 0; j < InnerProductTile; j++)
+                acc[j] = _mm512_add_epi32(acc[j], _mm512_madd_epi16(x, _mm512_cvtepu8_epi16(_mm256_loadu_si256((const __m256i *)(queries[j] + i)))));
+        }
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += SumLanesU32(acc[j]);
+    }
+    for (; i < dim; i++)
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += (uint32_t)image[i] * queries[j][i];
+}
+
+// The tail is read with a masked load, so there is no scalar loop
+AVX512_TARGET static void InnerProductsF32(const float *image, const float *const *queries, std::size_t dim, float *result)
+{
+    __m512 acc[InnerProductTile] = {_mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps(), _mm512_setzero_ps()};
+    for (std::size_t i = 0; i < dim; i += 16)
+    {
+        __mmask16 mask = dim - i >= 16 ? (__mmask16)0xFFFF : (__mmask16)((1u << (dim - i)) - 1);
+        __m512 x = _mm512_maskz_loadu_ps(mask, image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm512_fmadd_ps(x, _mm512_maskz_loadu_ps(mask, queries[j] + i), acc[j]);
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = _mm512_reduce_add_ps(acc[j]);
+}
+
+AVX512_TARGET static void InnerProductsF64(const double *image, const double *const *queries, std::size_t dim, double *result)
+{
+    __m512d acc[InnerProductTile] = {_mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd()};
+    for (std::size_t i = 0; i < dim; i += 8)
+    {
+        __mmask8 mask = dim - i >= 8 ? (__mmask8)0xFF : (__mmask8)((1u << (dim - i)) - 1);
+        __m512d x = _mm512_maskz_loadu_pd(mask, image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm512_fmadd_pd(x, _mm512_maskz_loadu_pd(mask, queries[j] + i), acc[j]);
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = _mm512_reduce_add_pd(acc[j]);
+}
+
+// The rows of a block fill one register. Up to ProjectGroup blocks are summed together, so that their additions are
+// independent, and the values are multiplied and added separately so that every row is summed exactly like ProjectKernel
+static const std::size_t ProjectGroup = 4;
+
+template <typename T>
+AVX512_TARGET static void ProjectBlocks(const double *matrix, std::size_t numBlocks, const T *x, std::size_t dim, double *result)
+{
+    for (std::size_t first = 0; first < numBlocks; first += ProjectGroup)
+    {
+        std::size_t count = std::min(ProjectGroup, numBlocks - first);
+        const double *block = matrix + first * dim * ProjectionBlock;
+        __m512d acc[ProjectGroup] = {_mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd()};
+        for (std::size_t i = 0; i < dim; i++)
+        {
+            __m512d value = _mm512_set1_pd((double)x[i]);
+            for (std::size_t g = 0; g < count; g++)
+                acc[g] = _mm512_add_pd(acc[g], _mm512_mul_pd(_mm512_loadu_pd(block + (g * dim + i) * ProjectionBlock), value));
+        }
+        for (std::size_t g = 0; g < count; g++)
+            _mm512_storeu_pd(result + (first + g) * ProjectionBlock, acc[g]);
+    }
+}
+
+AVX512_TARGET static void ProjectU8(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+AVX512_TARGET static void ProjectF32(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+AVX512_TARGET static void ProjectF64(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+
+static const DistanceKernelTable avx512Table = {"avx512",
+                                                SquaredEuclideanU8, SquaredEuclideanF32, SquaredEuclideanF64,
+                                                ManhattanU8, ManhattanF32, ManhattanF64,
+                                                BoundedSquaredEuclideanF32, BoundedSquaredEuclideanF64, BoundedManhattanF32, BoundedManhattanF64,
+                                                InnerProductsU8, InnerProductsF32, InnerProductsF64,
+                                                ProjectU8, ProjectF32, ProjectF64};
+
+const DistanceKernelTable *Avx512Kernels() { return &avx512Table; }
+
+#else
+
+const DistanceKernelTable *Avx512Kernels() { return nullptr; }
+
+#endif
@@ -0,0 +1,83 @@
+#include <iostream>
+#include <cstdint>
+
+#include "SimdKernels.hpp"
+#include "CpuFeatures.hpp"
+#include "DistanceKernels.hpp"
+
+// The portable kernels are the plain loops of DistanceKernels.hpp
+static uint64_t ScalarSquaredEuclideanU8(const uint8_t *first, const uint8_t *second, std::size_t dim) { return SquaredEuclideanKernel(first, second, dim); }
+static float ScalarSquaredEuclideanF32(const float *first, const float *second, std::size_t dim) { return SquaredEuclideanKernel(first, second, dim); }
+static double ScalarSquaredEuclideanF64(const double *first, const double *second, std::size_t dim) { return SquaredEuclideanKernel(first, second, dim); }
+static uint64_t ScalarManhattanU8(const uint8_t *first, const uint8_t *second, std::size_t dim) { return ManhattanKernel(first, second, dim); }
+static float ScalarManhattanF32(const float *first, const float *second, std::size_t dim) { return ManhattanKernel(first, second, dim); }
+static double ScalarManhattanF64(const double *first, const double *second, std::size_t dim) { return ManhattanKernel(first, second, dim); }
+
+// The bounded portable kernels compare their running sum with the bound every AbandonBlock pixels, the sum is the one
+// of the plain loops
+template <typename T>
+static T ScalarBoundedSquaredEuclidean(const T *first, const T *second, std::size_t dim, T bound)
+{
+    T result = 0;
+    for (std::size_t i = 0; i < dim; i++)
+    {
+        if (i > 0 && i % AbandonBlock == 0 && result > bound)
+            return result;
+        T difference = first[i] - second[i];
+        result += difference * difference;
+    }
+    return result;
+}
+
+template <typename T>
+static T ScalarBoundedManhattan(const T *first, const T *second, std::size_t dim, T bound)
+{
+    T result = 0;
+    for (std::size_t i = 0; i < dim; i++)
+    {
+        if (i > 0 && i % AbandonBlock == 0 && result > bound)
+            return result;
+        T difference = first[i] - second[i];
+        result += difference < 0 ? -difference : difference;
+    }
+    return result;
+}
+
+static float ScalarBoundedSquaredEuclideanF32(const float *first, const float *second, std::size_t dim, float bound) { return ScalarBoundedSquaredEuclidean(first, second, dim, bound); }
+static double ScalarBoundedSquaredEuclideanF64(const double *first, const double *second, std::size_t dim, double bound) { return ScalarBoundedSquaredEuclidean(first, second, dim, bound); }
+static float ScalarBoundedManhattanF32(const float *first, const float *second, std::size_t dim, float bound) { return ScalarBoundedManhattan(first, second, dim, bound); }
+static double ScalarBoundedManhattanF64(const double *first, const double *second, std::size_t dim, double bound) { return ScalarBoundedManhattan(first, second, dim, bound); }
+
+static void ScalarInnerProductsU8(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result) { InnerProductsKernel(image, queries, dim, result); }
+static void ScalarInnerProductsF32(const float *image, const float *const *queries, std::size_t dim, float *result) { InnerProductsKernel(image, queries, dim, result); }
+static void ScalarInnerProductsF64(const double *image, const double *const *queries, std::size_t dim, double *result) { InnerProductsKernel(image, queries, dim, result); }
+static void ScalarProjectU8(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result) { ProjectKernel(matrix, numBlocks, x, dim, result); }
+static void ScalarProjectF32(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result) { ProjectKernel(matrix, numBlocks, x, dim, result); }
+static void ScalarProjectF64(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result) { ProjectKernel(matrix, numBlocks, x, dim, result); }
+
+static const DistanceKernelTable scalarTable = {"scalar",
+                                                ScalarSquaredEuclideanU8, ScalarSquaredEuclideanF32, ScalarSquaredEuclideanF64,
+                                                ScalarManhattanU8, ScalarManhattanF32, ScalarManhattanF64,
+                                                ScalarBoundedSquaredEuclideanF32, ScalarBoundedSquaredEuclideanF64, ScalarBoundedManhattanF32, ScalarBoundedManhattanF64,
+                                                ScalarInnerProductsU8, ScalarInnerProductsF32, ScalarInnerProductsF64,
+                                                ScalarProjectU8, ScalarProjectF32, ScalarProjectF64};
+
+const DistanceKernelTable *ScalarKernels() { return &scalarTable; }
+
+static const DistanceKernelTable &SelectKernels()
+{
+    const CpuFeatures &cpu = CpuFeatures::get();
+    if (cpu.avx512 && Avx512Kernels())
+        return *Avx512Kernels();
+    if (cpu.avx2 && Avx2Kernels())
+        return *Avx2Kernels();
+    if (cpu.sse2 && Sse2Kernels())
+        return *Sse2Kernels();
+    return scalarTable;
+}
+
+const DistanceKernelTable &ActiveKernels()
+{
+    static const DistanceKernelTable &table = SelectKernels();
+    return table;
+}
@@ -0,0 +1,113 @@
+#ifndef SIMD_KERNELS_HPP_
+#define SIMD_KERNELS_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "DistanceKernels.hpp"
+
+// Number of pixels a bounded distance adds before it compares the partial sum with the bound, a multiple of the width
+// of every instruction set
+static const std::size_t AbandonBlock = 128;
+
+/**
+ * @brief A set of distance kernels written for one instruction set.
+ * The euclidean kernels return the sum of the squared differences (no sqrt) and the manhattan ones
+ * the sum of the absolute differences. uint8_t kernels are exact, float kernels accumulate in float.
+ * The inner product kernels multiply one image with InnerProductTile queries at a time, so the image is loaded once for all of them.
+ * The project kernels multiply one vector with a projection matrix of interleaved blocks, see ProjectKernel. They
+ * vectorize over the rows of a block and not over the values, so they give exactly the results of ProjectKernel.
+ * The bounded float kernels sum like the unbounded ones of their set, and every AbandonBlock pixels they reduce their
+ * accumulators without changing them. The terms are never negative, so they stop with that partial sum once it is
+ * larger than bound, and a sum that is never larger is the one of the unbounded kernel, computed in the same pass.
+ *
+ * @param name the instruction set, used by the benchmarks
+ */
+class DistanceKernelTable
+{
+public:
+    const char *name;
+    uint64_t (*squaredEuclideanU8)(const uint8_t *first, const uint8_t *second, std::size_t dim);
+    float (*squaredEuclideanF32)(const float *first, const float *second, std::size_t dim);
+    double (*squaredEuclideanF64)(const double *first, const double *second, std::size_t dim);
+    uint64_t (*manhattanU8)(const uint8_t *first, const uint8_t *second, std::size_t dim);
+    float (*manhattanF32)(const float *first, const float *second, std::size_t dim);
+    double (*manhattanF64)(const double *first, const double *second, std::size_t dim);
+    float (*boundedSquaredEuclideanF32)(const float *first, const float *second, std::size_t dim, float bound);
+    double (*boundedSquaredEuclideanF64)(const double *first, const double *second, std::size_t dim, double bound);
+    float (*boundedManhattanF32)(const float *first, const float *second, std::size_t dim, float bound);
+    double (*boundedManhattanF64)(const double *first, const double *second, std::size_t dim, double bound);
+    void (*innerProductsU8)(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result);
+    void (*innerProductsF32)(const float *image, const float *const *queries, std::size_t dim, float *result);
+    void (*innerProductsF64)(const double *image, const double *const *queries, std::size_t dim, double *result);
+    void (*projectU8)(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result);
+    void (*projectF32)(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result);
+    void (*projectF64)(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result);
+};
+
+// The kernels of each instruction set. They return nullptr when the set is not compiled in (non x86 builds).
+// Only call a table the CPU supports, see CpuFeatures
+const DistanceKernelTable *ScalarKernels();
+const DistanceKernelTable *Sse2Kernels();
+const DistanceKernelTable *Avx2Kernels();
+const DistanceKernelTable *Avx512Kernels();
+
+// The best table the running CPU supports. It is chosen on the first call and never changes afterwards
+const DistanceKernelTable &ActiveKernels();
+
+// Overloads used by the distance functions, one per pixel type with a vectorized kernel
+inline uint64_t SquaredEuclidean(const uint8_t *first, const uint8_t *second, std::size_t dim) { return ActiveKernels().squaredEuclideanU8(first, second, dim); }
+inline float SquaredEuclidean(const float *first, const float *second, std::size_t dim) { return ActiveKernels().squaredEuclideanF32(first, second, dim); }
+inline double SquaredEuclidean(const double *first, const double *second, std::size_t dim) { return ActiveKernels().squaredEuclideanF64(first, second, dim); }
+inline uint64_t Manhattan(const uint8_t *first, const uint8_t *second, std::size_t dim) { return ActiveKernels().manhattanU8(first, second, dim); }
+inline float Manhattan(const float *first, const float *second, std::size_t dim) { return ActiveKernels().manhattanF32(first, second, dim); }
+inline double Manhattan(const double *first, const double *second, std::size_t dim) { return ActiveKernels().manhattanF64(first, second, dim); }
+inline void InnerProducts(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result) { ActiveKernels().innerProductsU8(image, queries, dim, result); }
+inline void InnerProducts(const float *image, const float *const *queries, std::size_t dim, float *result) { ActiveKernels().innerProductsF32(image, queries, dim, result); }
+inline void InnerProducts(const double *image, const double *const *queries, std::size_t dim, double *result) { ActiveKernels().innerProductsF64(image, queries, dim, result); }
+inline void Project(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result) { ActiveKernels().projectU8(matrix, numBlocks, x, dim, result); }
+inline void Project(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result) { ActiveKernels().projectF32(matrix, numBlocks, x, dim, result); }
+inline void Project(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result) { ActiveKernels().projectF64(matrix, numBlocks, x, dim, result); }
+
+/**
+ * @brief An integer distance that stops once it is known to be larger than bound. The pixels are added AbandonBlock at
+ * a time with a vectorized kernel, the terms are never negative so a partial sum larger than bound means a distance
+ * larger than bound. Returns the distance if it is at most bound, else a partial sum larger than bound. Integer sums
+ * do not depend on their order, the float kernels have bounded versions of their own instead
+ */
+template <typename T>
+inline uint64_t BoundedKernel(uint64_t (*kernel)(const T *, const T *, std::size_t), const T *first, const T *second, std::size_t dim, uint64_t bound)
+{
+    if (dim <= AbandonBlock)
+        return kernel(first, second, dim);
+    uint64_t result = 0;
+    for (std::size_t i = 0; i < dim; i += AbandonBlock)
+    {
+        result += kernel(first + i, second + i, std::min(AbandonBlock, dim - i));
+        if (result > bound)
+            return result;
+    }
+    return result;
+}
+
+// A bound of the integer kernels for a rank distance: an integer distance is larger than bound iff it is larger than floor(bound)
+inline uint64_t IntegerBound(double bound) { return bound <= 0 ? 0 : bound >= 1.8e19 ? UINT64_MAX : (uint64_t)bound; }
+
+// A bound of the float kernels, rounded up so that no distance of at most bound is abandoned
+inline float FloatBound(double bound)
+{
+    float rounded = (float)bound;
+    return rounded < bound ? std::nextafter(rounded, std::numeric_limits<float>::infinity()) : rounded;
+}
+
+// Pairs of different pixel types, e.g. uint8_t images against a float centroid, use the portable kernels
+template <typename T, typename U>
+inline typename KernelTraits<T, U>::Sum SquaredEuclidean(const T *first, const U *second, std::size_t dim) { return SquaredEuclideanKernel(first, second, dim); }
+
+template <typename T, typename U>
+inline typename KernelTraits<T, U>::Sum Manhattan(const T *first, const U *second, std::size_t dim) { return ManhattanKernel(first, second, dim); }
+
+#endif
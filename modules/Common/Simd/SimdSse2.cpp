@@ -0,0 +1,283 @@
+#include <cstdint>
+#include <algorithm>
+
+#include "SimdKernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define SSE2_TARGET __attribute__((target("sse2")))
+
+// Number of 16 byte steps the uint8_t kernels accumulate in 32-bit lanes before they are widened to 64 bits
+static const std::size_t U8Block = 4096;
+
+SSE2_TARGET static uint64_t SumLanesU32(__m128i acc)
+{
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128((__m128i *)lanes, acc);
+    return (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+SSE2_TARGET static float SumLanes(__m128 acc)
+{
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+SSE2_TARGET static double SumLanes(__m128d acc)
+{
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, acc);
+    return lanes[0] + lanes[1];
+}
+
+// |x - y| of unsigned bytes, widened to 16 bits and squared-and-added in pairs with madd
+SSE2_TARGET static uint64_t SquaredEuclideanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    const __m128i zero = _mm_setzero_si128();
+    uint64_t result = 0;
+    std::size_t i = 0;
+    while (i + 16 <= dim)
+    {
+        __m128i acc = zero;
+        for (std::size_t steps = 0; steps < U8Block && i + 16 <= dim; steps++, i += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i *)(first + i));
+            __m128i y = _mm_loadu_si128((const __m128i *)(second + i));
+            __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+            __m128i lo = _mm_unpacklo_epi8(d, zero);
+            __m128i hi = _mm_unpackhi_epi8(d, zero);
+            acc = _mm_add_epi32(acc, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        }
+        result += SumLanesU32(acc);
+    }
+    for (; i < dim; i++)
+    {
+        int32_t d = (int32_t)first[i] - (int32_t)second[i];
+        result += d * d;
+    }
+    return result;
+}
+
+template <bool Bounded>
+SSE2_TARGET static float SquaredEuclideanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = SumLanes(_mm_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(first + i + 4), _mm_loadu_ps(second + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    float result = SumLanes(_mm_add_ps(acc0, acc1));
+    for (; i < dim; i++)
+        result += (first[i] - second[i]) * (first[i] - second[i]);
+    return result;
+}
+SSE2_TARGET static float SquaredEuclideanF32(const float *first, const float *second, std::size_t dim) { return SquaredEuclideanF32Kernel<false>(first, second, dim, 0); }
+SSE2_TARGET static float BoundedSquaredEuclideanF32(const float *first, const float *second, std::size_t dim, float bound) { return SquaredEuclideanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+SSE2_TARGET static double SquaredEuclideanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = SumLanes(_mm_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        __m128d d0 = _mm_sub_pd(_mm_loadu_pd(first + i), _mm_loadu_pd(second + i));
+        __m128d d1 = _mm_sub_pd(_mm_loadu_pd(first + i + 2), _mm_loadu_pd(second + i + 2));
+        acc0 = _mm_add_pd(acc0, _mm_mul_pd(d0, d0));
+        acc1 = _mm_add_pd(acc1, _mm_mul_pd(d1, d1));
+    }
+    double result = SumLanes(_mm_add_pd(acc0, acc1));
+    for (; i < dim; i++)
+        result += (first[i] - second[i]) * (first[i] - second[i]);
+    return result;
+}
+SSE2_TARGET static double SquaredEuclideanF64(const double *first, const double *second, std::size_t dim) { return SquaredEuclideanF64Kernel<false>(first, second, dim, 0); }
+SSE2_TARGET static double BoundedSquaredEuclideanF64(const double *first, const double *second, std::size_t dim, double bound) { return SquaredEuclideanF64Kernel<true>(first, second, dim, bound); }
+
+// psadbw sums the absolute differences of 8 bytes into a 64-bit lane
+SSE2_TARGET static uint64_t ManhattanU8(const uint8_t *first, const uint8_t *second, std::size_t dim)
+{
+    __m128i acc = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + 16 <= dim; i += 16)
+        acc = _mm_add_epi64(acc, _mm_sad_epu8(_mm_loadu_si128((const __m128i *)(first + i)),
+                                              _mm_loadu_si128((const __m128i *)(second + i))));
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128((__m128i *)lanes, acc);
+    uint64_t result = lanes[0] + lanes[1];
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+
+template <bool Bounded>
+SSE2_TARGET static float ManhattanF32Kernel(const float *first, const float *second, std::size_t dim, float bound)
+{
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    std::size_t i = 0;
+    for (; i + 8 <= dim; i += 8)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            float partial = SumLanes(_mm_add_ps(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm_add_ps(acc0, _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(first + i), _mm_loadu_ps(second + i))));
+        acc1 = _mm_add_ps(acc1, _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(first + i + 4), _mm_loadu_ps(second + i + 4))));
+    }
+    float result = SumLanes(_mm_add_ps(acc0, acc1));
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+SSE2_TARGET static float ManhattanF32(const float *first, const float *second, std::size_t dim) { return ManhattanF32Kernel<false>(first, second, dim, 0); }
+SSE2_TARGET static float BoundedManhattanF32(const float *first, const float *second, std::size_t dim, float bound) { return ManhattanF32Kernel<true>(first, second, dim, bound); }
+
+template <bool Bounded>
+SSE2_TARGET static double ManhattanF64Kernel(const double *first, const double *second, std::size_t dim, double bound)
+{
+    const __m128d sign = _mm_set1_pd(-0.0);
+    __m128d acc0 = _mm_setzero_pd(), acc1 = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4)
+    {
+        if (Bounded && i > 0 && i % AbandonBlock == 0)
+        {
+            double partial = SumLanes(_mm_add_pd(acc0, acc1));
+            if (partial > bound)
+                return partial;
+        }
+        acc0 = _mm_add_pd(acc0, _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(first + i), _mm_loadu_pd(second + i))));
+        acc1 = _mm_add_pd(acc1, _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(first + i + 2), _mm_loadu_pd(second + i + 2))));
+    }
+    double result = SumLanes(_mm_add_pd(acc0, acc1));
+    for (; i < dim; i++)
+        result += first[i] > second[i] ? first[i] - second[i] : second[i] - first[i];
+    return result;
+}
+SSE2_TARGET static double ManhattanF64(const double *first, const double *second, std::size_t dim) { return ManhattanF64Kernel<false>(first, second, dim, 0); }
+SSE2_TARGET static double BoundedManhattanF64(const double *first, const double *second, std::size_t dim, double bound) { return ManhattanF64Kernel<true>(first, second, dim, bound); }
+
+// The image is widened once and multiplied with the InnerProductTile queries, madd adds the products in pairs
+SSE2_TARGET static void InnerProductsU8(const uint8_t *image, const uint8_t *const *queries, std::size_t dim, uint64_t *result)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+        result[j] = 0;
+    std::size_t i = 0;
+    while (i + 16 <= dim)
+    {
+        __m128i acc[InnerProductTile] = {zero, zero, zero, zero};
+        for (std::size_t steps = 0; steps < U8Block && i + 16 <= dim; steps++, i += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i *)(image + i));
+            __m128i lo = _mm_unpacklo_epi8(x, zero);
+            __m128i hi = _mm_unpackhi_epi8(x, zero);
+            for (std::size_t j = 0; j < InnerProductTile; j++)
+            {
+                __m128i y = _mm_loadu_si128((const __m128i *)(queries[j] + i));
+                acc[j] = _mm_add_epi32(acc[j], _mm_add_epi32(_mm_madd_epi16(lo, _mm_unpacklo_epi8(y, zero)),
+                                                             _mm_madd_epi16(hi, _mm_unpackhi_epi8(y, zero))));
+            }
+        }
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += SumLanesU32(acc[j]);
+    }
+    for (; i < dim; i++)
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            result[j] += (uint32_t)image[i] * queries[j][i];
+}
+
+SSE2_TARGET static void InnerProductsF32(const float *image, const float *const *queries, std::size_t dim, float *result)
+{
+    __m128 acc[InnerProductTile] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps()};
+    std::size_t i = 0;
+    for (; i + 4 <= dim; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm_add_ps(acc[j], _mm_mul_ps(x, _mm_loadu_ps(queries[j] + i)));
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+    {
+        result[j] = SumLanes(acc[j]);
+        for (std::size_t t = i; t < dim; t++)
+            result[j] += image[t] * queries[j][t];
+    }
+}
+
+SSE2_TARGET static void InnerProductsF64(const double *image, const double *const *queries, std::size_t dim, double *result)
+{
+    __m128d acc[InnerProductTile] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+    std::size_t i = 0;
+    for (; i + 2 <= dim; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(image + i);
+        for (std::size_t j = 0; j < InnerProductTile; j++)
+            acc[j] = _mm_add_pd(acc[j], _mm_mul_pd(x, _mm_loadu_pd(queries[j] + i)));
+    }
+    for (std::size_t j = 0; j < InnerProductTile; j++)
+    {
+        result[j] = SumLanes(acc[j]);
+        for (std::size_t t = i; t < dim; t++)
+            result[j] += image[t] * queries[j][t];
+    }
+}
+
+// The rows of a block fill four registers, whose additions are independent. The values are multiplied and added
+// separately so that every row is summed exactly like ProjectKernel
+template <typename T>
+SSE2_TARGET static void ProjectBlocks(const double *matrix, std::size_t numBlocks, const T *x, std::size_t dim, double *result)
+{
+    for (std::size_t b = 0; b < numBlocks; b++, matrix += dim * ProjectionBlock, result += ProjectionBlock)
+    {
+        __m128d acc[4] = {_mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd(), _mm_setzero_pd()};
+        for (std::size_t i = 0; i < dim; i++)
+        {
+            __m128d value = _mm_set1_pd((double)x[i]);
+            for (std::size_t r = 0; r < 4; r++)
+                acc[r] = _mm_add_pd(acc[r], _mm_mul_pd(_mm_loadu_pd(matrix + i * ProjectionBlock + 2 * r), value));
+        }
+        for (std::size_t r = 0; r < 4; r++)
+            _mm_storeu_pd(result + 2 * r, acc[r]);
+    }
+}
+
+SSE2_TARGET static void ProjectU8(const double *matrix, std::size_t numBlocks, const uint8_t *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+SSE2_TARGET static void ProjectF32(const double *matrix, std::size_t numBlocks, const float *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+SSE2_TARGET static void ProjectF64(const double *matrix, std::size_t numBlocks, const double *x, std::size_t dim, double *result) { ProjectBlocks(matrix, numBlocks, x, dim, result); }
+
+static const DistanceKernelTable sse2Table = {"sse2",
+                                              SquaredEuclideanU8, SquaredEuclideanF32, SquaredEuclideanF64,
+                                              ManhattanU8, ManhattanF32, ManhattanF64,
+                                              BoundedSquaredEuclideanF32, BoundedSquaredEuclideanF64, BoundedManhattanF32, BoundedManhattanF64,
+                                              InnerProductsU8, InnerProductsF32, InnerProductsF64,
+                                              ProjectU8, ProjectF32, ProjectF64};
+
+const DistanceKernelTable *Sse2Kernels() { return &sse2Table; }
+
+#else
+
+const DistanceKernelTable *Sse2Kernels() { return nullptr; }
+
+#endif
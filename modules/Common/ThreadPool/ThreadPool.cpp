@@ -0,0 +1,139 @@
+#include <algorithm>
+
+#include "ThreadPool.hpp"
+
+// Set on the threads of a pool while they run a loop, a loop started there runs on the calling thread alone
+static thread_local bool insideLoop = false;
+// The index of the thread in the loop it runs, 0 outside of loops
+static thread_local int currentThread = 0;
+
+// The number of threads of the default pool, 0 for the number of cores
+static int defaultThreads = 0;
+
+ThreadPool::ThreadPool(int numThreads)
+    : numThreads(numThreads > 0 ? numThreads : HardwareThreads()), job(nullptr), generation(0), running(0), stopping(false)
+{
+    ranges.reset(new WorkRange[this->numThreads]);
+    // The caller is thread 0, the workers are 1 to numThreads - 1
+    for (int t = 1; t < this->numThreads; t++)
+        workers.push_back(std::thread(&ThreadPool::Worker, this, t));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+ThreadPool &ThreadPool::Default()
+{
+    static ThreadPool pool(defaultThreads);
+    return pool;
+}
+
+void ThreadPool::SetDefaultThreads(int numThreads) { defaultThreads = numThreads; }
+
+int ThreadPool::HardwareThreads()
+{
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 0 ? (int)cores : 1;
+}
+
+bool ThreadPool::InsideLoop() { return insideLoop; }
+
+int ThreadPool::CurrentThread() { return currentThread; }
+
+void ThreadPool::Worker(int thread)
+{
+    unsigned long seen = 0;
+    while (true)
+    {
+        const std::function<void(int)> *task;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&]
+                      { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            task = job;
+        }
+
+        insideLoop = true;
+        currentThread = thread;
+        (*task)(thread);
+        insideLoop = false;
+        currentThread = 0;
+
+        std::lock_guard<std::mutex> guard(lock);
+        if (--running == 0)
+            finished.notify_one();
+    }
+}
+
+void ThreadPool::Run(const std::function<void(int)> &task)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &task;
+        running = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    insideLoop = true;
+    task(0);
+    insideLoop = false;
+
+    // The task lives on the stack of the caller, so every worker has to be done with it
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&]
+                  { return running == 0; });
+    job = nullptr;
+}
+
+// Takes the next chunk of the own range of the thread
+bool ThreadPool::Take(int thread, std::size_t chunkSize, std::size_t &start, std::size_t &end)
+{
+    WorkRange &range = ranges[thread];
+    std::lock_guard<std::mutex> guard(range.lock);
+    if (range.begin >= range.end)
+        return false;
+    start = range.begin;
+    end = std::min(range.end, start + chunkSize);
+    range.begin = end;
+    return true;
+}
+
+// Moves the back half of the remaining indices of another thread to the own range of the thread. The other threads
+// are tried in order starting after this one, so the thieves spread over the victims
+bool ThreadPool::Steal(int thread)
+{
+    for (int offset = 1; offset < numThreads; offset++)
+    {
+        WorkRange &victim = ranges[(thread + offset) % numThreads];
+        std::size_t start, end;
+        {
+            std::lock_guard<std::mutex> guard(victim.lock);
+            std::size_t remaining = victim.end > victim.begin ? victim.end - victim.begin : 0;
+            if (remaining == 0)
+                continue;
+            std::size_t half = (remaining + 1) / 2;
+            end = victim.end;
+            start = end - half;
+            victim.end = start;
+        }
+
+        WorkRange &own = ranges[thread];
+        std::lock_guard<std::mutex> guard(own.lock);
+        own.begin = start;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,109 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+// The indices of a loop that one thread still has to run, the owner takes chunks from the front and the other
+// threads steal the back half when they run out of work
+class WorkRange
+{
+public:
+    std::mutex lock;
+    std::size_t begin;
+    std::size_t end;
+
+    WorkRange() : begin(0), end(0) {}
+};
+
+/**
+ * @brief A fixed set of threads that run parallel loops with work stealing. The threads are created once and sleep
+ * between loops, the thread that calls ParallelFor works as one of them. Every thread starts with an equal contiguous
+ * part of the indices and takes them in chunks. A thread that finishes its part steals half of the remaining indices
+ * of another thread, so a loop whose iterations take very different times still keeps all the threads busy.
+ * A loop started from inside a loop runs on the calling thread. One loop runs at a time, a pool must not be used by
+ * several threads that are not its own at once.
+ *
+ * @param numThreads the number of threads of a loop including the caller, by default the number of cores
+ *
+ * @method ParallelFor calls function(i, thread) for every i in [0, n), thread is the index in [0, size()) of the
+ * thread that runs it, so per-thread state can be indexed with it. The indices are taken in chunks of chunkSize,
+ * 0 picks a size that gives every thread many chunks
+ * @method Default returns the pool shared by the index builds, the brute force and the batch queries
+ * @method SetDefaultThreads sets the number of threads of the default pool, it must be called before its first use
+ * @method HardwareThreads returns the number of cores, at least 1
+ * @method CurrentThread returns the index of the calling thread in the loop it runs, 0 outside of loops
+ */
+class ThreadPool
+{
+private:
+    int numThreads;
+    std::vector<std::thread> workers;
+    std::unique_ptr<WorkRange[]> ranges;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    const std::function<void(int)> *job;
+    unsigned long generation;
+    int running;
+    bool stopping;
+
+    void Worker(int thread);
+    void Run(const std::function<void(int)> &task);
+    bool Take(int thread, std::size_t chunkSize, std::size_t &start, std::size_t &end);
+    bool Steal(int thread);
+    static bool InsideLoop();
+
+public:
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+
+    // The threads wait on the pool, so it can not be copied
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    inline int size() const { return numThreads; }
+
+    template <typename Function>
+    void ParallelFor(std::size_t n, Function function, std::size_t chunkSize = 0)
+    {
+        // Nested loops and pools of one thread run the indices in order on the calling thread
+        if (InsideLoop() || workers.empty() || n <= 1)
+        {
+            int thread = CurrentThread();
+            for (std::size_t i = 0; i < n; i++)
+                function(i, thread);
+            return;
+        }
+
+        if (chunkSize == 0)
+            chunkSize = std::max<std::size_t>(1, n / (numThreads * 64));
+        for (int t = 0; t < numThreads; t++)
+        {
+            ranges[t].begin = n * t / numThreads;
+            ranges[t].end = n * (t + 1) / numThreads;
+        }
+
+        std::function<void(int)> task = [&](int thread)
+        {
+            std::size_t start, end;
+            while (Take(thread, chunkSize, start, end) || (Steal(thread) && Take(thread, chunkSize, start, end)))
+                for (std::size_t i = start; i < end; i++)
+                    function(i, thread);
+        };
+        Run(task);
+    }
+
+    static ThreadPool &Default();
+    static void SetDefaultThreads(int numThreads);
+    static int HardwareThreads();
+    static int CurrentThread();
+};
+
+#endif
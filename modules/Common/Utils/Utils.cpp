@@ -7,6 +7,7 @@
 #include <chrono>
 
 #include "Utils.hpp"
+#include "Random.hpp"
 
 #ifdef DEBUG
 #include <unistd.h>
@@ -73,14 +74,6 @@ std::chrono::nanoseconds stopClock()
     return duration;
 }
 
-double DotProduct(const std::vector<double> &first, const std::vector<double> &second)
-{
-    double sum = 0.0;
-    for (size_t i = 0; i < first.size(); ++i)
-        sum += first[i] * second[i];
-    return sum;
-}
-
 /**
  * @brief Binary search in probalities to find the index corresponding to x
  *
@@ -106,39 +99,9 @@ int binarySearch(const std::vector<double> &partial, double x)
     return l;
 }
 
-int HammingDistance(const int first, const int second)
-{
-    int xorResult = first ^ second;
-    int distance = 0;
+// The draws come from the generator of the calling thread, see Random.hpp
+double RealDistribution(int from, int to) { return from + (to - from) * ThreadGenerator().UniformReal(); }
 
-    while (xorResult > 0)
-    {
-        // Increment the distance for each set by 1 bit.
-        distance += xorResult & 1;
-
-        // Right-shift the XOR result to check the next bit.
-        xorResult >>= 1;
-    }
-
-    return distance;
-}
+int IntDistribution(int from, int to) { return from + (int)ThreadGenerator().Uniform((uint64_t)((int64_t)to - from + 1)); }
 
-static std::random_device generator;
-
-double RealDistribution(int from, int to)
-{
-    std::uniform_real_distribution<double> rd(from, to);
-    return rd(generator);
-}
-
-int IntDistribution(int from, int to)
-{
-    std::uniform_int_distribution<int> id(from, to);
-    return id(generator);
-}
-
-double NormalDistribution(double from, double to)
-{
-    std::normal_distribution<double> nd(from, to);
-    return nd(generator);
-}
\ No newline at end of file
+double NormalDistribution(double from, double to) { return from + to * ThreadGenerator().Normal(); }
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <chrono>
 #include <vector>
+#include <type_traits>
 #include <random>
 #include <cstdint>
 
@@ -19,15 +20,22 @@ void startClock();
 
 std::chrono::nanoseconds stopClock();
 
-double DotProduct(const std::vector<double> &first, const std::vector<double> &second);
-
+// Dot product of a real vector with the pixels of an image of any pixel type
+template <typename T>
+double DotProduct(const double *first, const T *second, std::size_t size)
+{
+    double sum = 0.0;
+    for (std::size_t i = 0; i < size; ++i)
+        sum += first[i] * second[i];
+    return sum;
+}
+
+// a % b in the common type of a and b, a bucket index can be as large as the number of buckets
 template <typename T, typename U>
-uint8_t Modulo(T a, U b) { return static_cast<uint8_t>(a % b); }
+typename std::common_type<T, U>::type Modulo(T a, U b) { return a % b; }
 
 int binarySearch(const std::vector<double> &probs, double x);
 
-int HammingDistance(const int first, const int second);
-
 double RealDistribution(int from, int to);
 
 int IntDistribution(int from, int to);
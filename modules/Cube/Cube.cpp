@@ -1,130 +1,115 @@
 #include <vector>
 #include <queue>
-#include <bitset>
+#include <algorithm>
+#include <limits>
 
 #include "Utils.hpp"
+#include "Dataset.hpp"
 #include "Cube.hpp"
 #include "PublicTypes.hpp"
-#include "HashFunction.hpp"
+#include "ProjectionMatrix.hpp"
+#include "HammingBall.hpp"
 #include "ImageDistance.hpp"
+#include "BruteForce.hpp"
 
 // Constructor for cube object, uses initialization list
-Cube::Cube(const std::vector<ImagePtr> images, int w, int dimension, int maxCanditates, int probes, int numNn, int numBuckets)
-    : dimension(dimension), maxCanditates(maxCanditates), probes(probes), numNn(numNn), w(w), numBuckets(numBuckets)
+template <typename T, typename Distance>
+Cube<T, Distance>::Cube(const Dataset<T> &images, int w, int dimension, int maxCanditates, int probes, int numNn, int numBuckets)
+    : dimension(dimension), maxCanditates(maxCanditates), probes(probes), numNn(numNn), w(w), numBuckets(numBuckets),
+      projections(images.dimension(), w), vertex(0), images(images), quantizer(nullptr), rerank(0)
 {
-    // Initialize the general distance
-    this->distance = ImageDistance::getInstance();
-
     // We make num of dimension hash_functions as were showed in slides
     for (int i = 0; i < dimension; i++)
     {
         std::vector<double> v;
         // Create the v vector
-        for (std::size_t j = 0; j < images[0]->pixels.size(); j++)
+        for (std::size_t j = 0; j < images.dimension(); j++)
             v.push_back(NormalDistribution(0.0, 1.0));
 
         // The RealDistribution is the t (shift)
-        hash_functions.push_back(HashFunction(w, RealDistribution(0, w), v));
+        projections.AddFunction(v, RealDistribution(0, w));
     }
 
+    // The f_i functions that turn the h_i values into bits
+    vertex = VertexHash(dimension);
+
     // Initially we have numBuckets empty buckets
     for (int i = 0; i < numBuckets; i++)
-        buckets.push_back(std::vector<ImagePtr>());
+        buckets.push_back(std::vector<int>());
 
-    // We have a pointer to an unordered_map for f_i(h_i()) values
-    map = new std::unordered_map<int, int>[dimension];
-
-    // We begin filling the buckets with images
-    for (std::size_t i = 0; i < images.size(); i++)
-        insert(images[i]);
+    // We begin filling the buckets with images. A batch of images is projected in parallel, then the images are
+    // inserted in the order of the ids
+    std::vector<uint64_t> hashes;
+    for (std::size_t first = 0; first < images.size(); first += ProjectionMatrix::BatchImages)
+    {
+        std::size_t count = std::min(ProjectionMatrix::BatchImages, images.size() - first);
+        projections.hashBatch(images, first, count, hashes, ThreadPool::Default());
+        for (std::size_t i = 0; i < count; i++)
+            insert(first + i, hashes.data() + i * projections.blockSize());
+    }
 }
 
-// Utilizes the respective hash_functions to make a string consisting from 0 and 1. Then we convert this binary number into decimal
-// and the index to the bucket the current image will be inserted
-int Cube::hash(ImagePtr image)
+template <typename T, typename Distance>
+Cube<T, Distance>::~Cube() {}
+
+template <typename T, typename Distance>
+void Cube<T, Distance>::UseQuantizer(const ProductQuantizer *quantizer, int rerank)
 {
-    std::string res = "";
-    for (int i = 0; i < dimension; i++)
+    if (quantizer && quantizer->size() != images.size())
     {
-        int hash = hash_functions[i].hash(image);
-        if (map[i].find(hash) == map[i].end())
-            map[i][hash] = IntDistribution(0, 1);
-
-        res += std::to_string(map[i][hash]);
+        std::cerr << "Cube: the quantizer encodes " << quantizer->size() << " images instead of " << images.size() << std::endl;
+        exit(EXIT_FAILURE);
     }
-    return std::bitset<32>(res).to_ulong();
+    this->quantizer = quantizer;
+    this->rerank = rerank;
 }
 
-// Free allocated memory for map
-Cube::~Cube() { delete[] map; }
-
 // Insert the current image to the bucket showed from hash
-void Cube::insert(ImagePtr image) { buckets[hash(image)].push_back(image); }
+template <typename T, typename Distance>
+void Cube<T, Distance>::insert(int id, const uint64_t *hashes) { buckets[vertex(hashes)].push_back(id); }
 
 // Returns the k approximate nearest neighbors
-std::vector<Neighbor> Cube::Approximate_kNN(ImagePtr query)
+template <typename T, typename Distance>
+std::vector<Neighbor> Cube<T, Distance>::Approximate_kNN(const ImageView<T> &query)
 {
     // We are using a priority queue to store the objects efficiently with a custom compare class
     std::priority_queue<Neighbor, std::vector<Neighbor>, CompareNeighbor> nearestNeighbors;
 
+    // With a quantizer the candidates are ranked by the distances of their codes, and we keep the rerank nearest of them
+    std::vector<float> table;
+    if (quantizer)
+        quantizer->Table<Distance>(query.pixels, table);
+    int keep = quantizer ? std::max(numNn, rerank) : numNn;
+
     // We get the bucket that the query would be inserted to in order to search there
-    int query_bucket = hash(query);
+    std::vector<uint64_t> hashes(projections.blockSize());
+    projections.hash(query.pixels, hashes.data());
+    int query_bucket = vertex(hashes.data());
     int candidates = 0;
-    std::vector<ImagePtr> bucket;
-    int hamDistance = 0;
 
+    // The query bucket is the first probe, then the buckets in the order of their hamming distance from it.
     // This loop will run until one of the conditions are satisfied, either the number of probes that was searched is reached or the number of candidates is reached
-    for (int i = 0; i < probes + 1 && candidates < maxCanditates; hamDistance++)
+    HammingBall probe(query_bucket, dimension);
+    int current;
+    for (int i = 0; i < probes + 1 && candidates < maxCanditates && probe.Next(current); i++)
     {
-        // This is the query bucket we are searching in
-        if (i == 0)
+        // Iterate over all images for the current bucket
+        for (int input : buckets[current])
         {
-            bucket = buckets[query_bucket];
-
-            // Iterate over all images for the current bucket
-            for (ImagePtr input : bucket)
+            // We calculate the distance from this image to the query, it is dropped as soon as it is farther than all the numNn we have
+            double bound = nearestNeighbors.empty() || (int)nearestNeighbors.size() < keep ? std::numeric_limits<double>::infinity() : nearestNeighbors.top().distance;
+            double dist = quantizer ? quantizer->Adc(table.data(), input) : distance.distance_if_less(images[input], query, bound);
+            if (dist <= bound)
             {
-                // We calculate the distance from this image to the query
-                double dist = distance->calculate(input, query);
                 // Push it to the priority queue
                 nearestNeighbors.push(Neighbor(input, dist));
                 // In order to save time later we only store numNn of approximate nearest neighbors
-                if ((int)nearestNeighbors.size() > numNn)
+                if ((int)nearestNeighbors.size() > keep)
                     nearestNeighbors.pop();
-                // If the number of candidates is reached stop the loop
-                if (++candidates == maxCanditates)
-                    break;
-            }
-            // We are letting the loop know that we are moving to the next bucket
-            i++;
-        }
-        else
-        {
-            // For every bucket
-            for (int j = 0; j < numBuckets && candidates < maxCanditates && i < probes + 1; j++)
-            {
-                // We examine its hamming distance from the query
-                if (HammingDistance(query_bucket, j) == hamDistance)
-                {
-                    bucket = buckets[j];
-                    // Iterate over all images for the current bucket
-                    for (ImagePtr input : bucket)
-                    {
-                        // We calculate the distance from this image to the query
-                        double dist = distance->calculate(input, query);
-                        // Push it to the priority queue
-                        nearestNeighbors.push(Neighbor(input, dist));
-                        // In order to save time later we only store numNn of approximate nearest neighbors
-                        if ((int)nearestNeighbors.size() > numNn)
-                            nearestNeighbors.pop();
-                        // If the number of candidates is reached stop the loop
-                        if (++candidates == maxCanditates)
-                            break;
-                    }
-                    // We also let know the loop that we searched one more bucket
-                    ++i;
-                }
             }
+            // If the number of candidates is reached stop the loop
+            if (++candidates == maxCanditates)
+                break;
         }
     }
 
@@ -132,72 +117,75 @@ std::vector<Neighbor> Cube::Approximate_kNN(ImagePtr query)
     std::vector<Neighbor> KnearestNeighbors;
     while (!nearestNeighbors.empty())
     {
-        // We insert it in the beginning of the vector because the elements in priority queue are stored in descending order based on their distances
-        KnearestNeighbors.insert(KnearestNeighbors.begin(), nearestNeighbors.top());
+        KnearestNeighbors.push_back(nearestNeighbors.top());
         nearestNeighbors.pop();
     }
+    // The elements in priority queue are popped in descending order based on their distances
+    std::reverse(KnearestNeighbors.begin(), KnearestNeighbors.end());
+    if (quantizer)
+        return Rerank(images, query, KnearestNeighbors, numNn, distance);
     return KnearestNeighbors;
 }
 
+// The queries only read the buckets, the f_i functions have no state, so they need no state of their own
+template <typename T, typename Distance>
+void Cube<T, Distance>::SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool)
+{
+    results.resize(queries.size());
+    pool.ParallelFor(queries.size(), [&](std::size_t q, int)
+                     { results[q] = Approximate_kNN(queries[q]); });
+}
+
 // Returns a vector with images inside the given radius
-std::vector<ImagePtr> Cube::Approximate_Range_Search(ImagePtr query, const double radius)
+template <typename T, typename Distance>
+std::vector<int> Cube<T, Distance>::Approximate_Range_Search(const ImageView<T> &query, const double radius)
 {
-    std::vector<ImagePtr> RangeSearch;
+    std::vector<int> RangeSearch;
 
-    int query_bucket = hash(query);
+    // The distances are rank distances, so we compare them with the radius converted once (radius² for euclidean)
+    const double rankRadius = Distance::toRank(radius);
+
+    std::vector<uint64_t> hashes(projections.blockSize());
+    projections.hash(query.pixels, hashes.data());
+    int query_bucket = vertex(hashes.data());
     int candidates = 0;
-    std::vector<ImagePtr> bucket;
-    int hamDistance = 0;
+
+    // The probes are the query bucket and then the buckets in the order of their hamming distance from it.
     // This loop will run until one of the conditions are satisfied, either the number of probes that was searched is reached or the number of candidates is reached
-    for (int i = 0; i < probes + 1 && candidates < maxCanditates; hamDistance++)
+    HammingBall probe(query_bucket, dimension);
+    int current;
+    for (int i = 0; i < probes + 1 && candidates < maxCanditates && probe.Next(current); i++)
     {
-        // This is the query bucket we are searching in
-        if (i == 0)
+        // Iterate over all images for the current bucket
+        for (int input : buckets[current])
         {
-            bucket = buckets[query_bucket];
-            // Iterate over all images for the current bucket
-            for (ImagePtr input : bucket)
-            {
-                // We calculate the distance from this image to the query
-                double dist = distance->calculate(input, query);
-                // If its distance is less or equal to the given radius
-                if (dist <= radius)
-                    // We push it to the vector
-                    RangeSearch.push_back(input);
-                // If the number of candidates is reached stop the loop
-                if (++candidates == maxCanditates)
-                    break;
-            }
-            // We are letting the loop know that we are moving to the next bucket
-            i++;
-        }
-        else
-        {
-            // For every bucket
-            for (int j = 0; j < numBuckets && candidates < maxCanditates && i < probes + 1; j++)
-            {
-                // We examine its hamming distance from the query
-                if (HammingDistance(query_bucket, j) == hamDistance)
-                {
-                    bucket = buckets[j];
-                    // Iterate over all images for the current bucket
-                    for (ImagePtr input : bucket)
-                    {
-                        // We calculate the distance from this image to the query
-                        double dist = distance->calculate(input, query);
-                        // If its distance is less or equal to the given radius
-                        if (dist <= radius)
-                            // We push it to the vector
-                            RangeSearch.push_back(input);
-                        // If the number of candidates is reached stop the loop
-                        if (++candidates == maxCanditates)
-                            break;
-                    }
-                    // We also let know the loop that we searched one more bucket
-                    ++i;
-                }
-            }
+            // We calculate the distance from this image to the query
+            double dist = distance(images[input], query);
+            // If its distance is less or equal to the given radius
+            if (dist <= rankRadius)
+                // We push it to the vector
+                RangeSearch.push_back(input);
+            // If the number of candidates is reached stop the loop
+            if (++candidates == maxCanditates)
+                break;
         }
     }
     return RangeSearch;
-}
\ No newline at end of file
+}
+
+template <typename T, typename Distance>
+std::size_t Cube<T, Distance>::memoryUsage() const
+{
+    std::size_t bytes = buckets.capacity() * sizeof(std::vector<int>);
+    for (const std::vector<int> &bucket : buckets)
+        bytes += bucket.capacity() * sizeof(int);
+    return bytes + projections.memoryUsage() + vertex.memoryUsage();
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template class Cube<uint8_t, EuclideanDistance>;
+template class Cube<float, EuclideanDistance>;
+template class Cube<double, EuclideanDistance>;
+template class Cube<uint8_t, ManhattanDistance>;
+template class Cube<float, ManhattanDistance>;
+template class Cube<double, ManhattanDistance>;
\ No newline at end of file
@@ -2,12 +2,15 @@
 #define CUBE_HPP_
 
 #include <vector>
-#include <unordered_map>
 
 #include "PublicTypes.hpp"
 #include "Image.hpp"
-#include "HashFunction.hpp"
+#include "Dataset.hpp"
+#include "ProjectionMatrix.hpp"
+#include "VertexHash.hpp"
 #include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "ProductQuantizer.hpp"
 
 /**
  * @brief The class of a cube consists of the following
@@ -18,16 +21,23 @@
  * @param numNn the number of nearest neighbors needed
  * @param w the window
  * @param numBuckets the number of buckets which will be used which is essentially 2^k since {0,1}^d'
- * @param buckets the buckets in a vector form
- * @param map the map to match f_i(h_i()) values
- * @param hash_functions the h_i functions that are used
- * @param distance the generic distance
+ * @param buckets the buckets in a vector form, each bucket stores the ids of its images
+ * @param projections the h_i functions that are used, one row of the projection matrix each
+ * @param vertex the f_i functions that map the h_i values to the bits of a bucket
+ * @param images the dataset the ids stored in the buckets refer to
+ * @param distance the metric functor, the Distance template parameter (EuclideanDistance or ManhattanDistance)
+ * @param quantizer the codes of the images the candidates are ranked with, nullptr ranks them with their exact distances
+ * @param rerank the number of candidates nearest by their codes that are ranked again with their exact distances
  *
- * @method hash utilizies the h_i functions to insert an image
- * @method insert inserts an image into the buckets according to the hash
+ * @method UseQuantizer ranks the candidates of the next queries with the codes of quantizer, which encodes the same images, and
+ * the rerank nearest of them with their exact distances. nullptr goes back to the exact distances
+ * @method insert inserts an image into the buckets according to the values of the h_i functions for it
  * @method Approximate_kNN returns a vector with numNn aproxximate nearest neighbors
+ * @method SearchBatch answers many queries in parallel on the threads of the pool, results[q] are the neighbors of queries[q]
  * @method Approximate_Range_Search returns a vector with points inside the given radius
+ * @method memoryUsage bytes of the buckets and the hash functions, without the images
  */
+template <typename T, typename Distance>
 class Cube
 {
 private:
@@ -37,18 +47,23 @@ private:
     int numNn;         // -Ν number of nearest Neighbors
     int w;
     int numBuckets;
-    std::vector<std::vector<ImagePtr>> buckets;
-    std::unordered_map<int, int> *map;
-    std::vector<HashFunction> hash_functions;
-    int hash(ImagePtr image);
-    ImageDistance *distance;
+    std::vector<std::vector<int>> buckets;
+    ProjectionMatrix projections;
+    VertexHash vertex;
+    const Dataset<T> &images;
+    Distance distance;
+    const ProductQuantizer *quantizer;
+    int rerank;
 
 public:
-    Cube(const std::vector<ImagePtr> images, int w, int dimension, int maxCanditates, int probes, int numNn, int numBuckets);
+    Cube(const Dataset<T> &images, int w, int dimension, int maxCanditates, int probes, int numNn, int numBuckets);
     ~Cube();
-    void insert(ImagePtr image);
-    std::vector<Neighbor> Approximate_kNN(ImagePtr query);
-    std::vector<ImagePtr> Approximate_Range_Search(ImagePtr query, const double radius);
+    void UseQuantizer(const ProductQuantizer *quantizer, int rerank);
+    void insert(int id, const uint64_t *hashes);
+    std::vector<Neighbor> Approximate_kNN(const ImageView<T> &query);
+    void SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool);
+    std::vector<int> Approximate_Range_Search(const ImageView<T> &query, const double radius);
+    std::size_t memoryUsage() const;
 };
 
 #endif
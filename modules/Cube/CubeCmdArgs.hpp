@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
 
 // A simple class which stores the command line argument for hypercube algorithms
 // The arguments are initialized to their default values except from input,
@@ -18,6 +20,7 @@ public:
     int probes;             // -probes <int>
     int numNn;              // -Ν <number of nearest>
     double radius;          // -R radius
+    uint64_t seed;          // -seed <int> seed of the random projections
 
     CubeCmdArgs(const int argc, const char *argv[]) : inputFile(""),
                                                       queryFile(""),
@@ -26,7 +29,8 @@ public:
                                                       maxCanditates(10),
                                                       probes(2),
                                                       numNn(1),
-                                                      radius(10000)
+                                                      radius(10000),
+                                                      seed(1)
     {
         for (int i = 0; i < argc; i++)
         {
@@ -46,6 +50,8 @@ public:
                 numNn = atoi(argv[i + 1]);
             else if (!strcmp(argv[i], "-R"))
                 radius = atof(argv[i + 1]);
+            else if (!strcmp(argv[i], "-seed"))
+                seed = strtoull(argv[i + 1], nullptr, 10);
         }
     }
 };
@@ -0,0 +1,28 @@
+#include "HammingBall.hpp"
+
+HammingBall::HammingBall(int center, int dimension) : center(center), dimension(dimension), radius(0), mask(0) {}
+
+HammingBall::~HammingBall() {}
+
+bool HammingBall::Next(int &vertex)
+{
+    // When the masks of radius bits run out of the dimension we move on to the masks of one more bit
+    while (mask >> dimension)
+    {
+        if (++radius > dimension)
+            return false;
+        mask = ((uint64_t)1 << radius) - 1;
+    }
+    vertex = center ^ mask;
+
+    // Gosper's hack: the next larger number with as many bits set. The only mask of no bits is followed by the end
+    if (mask == 0)
+        mask = (uint64_t)1 << dimension;
+    else
+    {
+        uint64_t lowest = mask & -mask;
+        uint64_t ripple = mask + lowest;
+        mask = (((ripple ^ mask) >> 2) / lowest) | ripple;
+    }
+    return true;
+}
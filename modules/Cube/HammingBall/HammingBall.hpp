@@ -0,0 +1,33 @@
+#ifndef HAMMINGBALL_HPP_
+#define HAMMINGBALL_HPP_
+
+#include <cstdint>
+
+/**
+ * @brief Enumerates the vertices of a hypercube around a vertex in the order of their Hamming distance from it, the
+ * probes of a Cube query. The vertices at distance h are center ^ mask for every mask of h bits, taken in increasing
+ * order with Gosper's hack, so every vertex costs O(1) and no other vertex is looked at
+ *
+ * @param center the vertex the enumeration starts from, it is the first vertex
+ * @param dimension the number of bits of a vertex, at most 31
+ * @param radius the Hamming distance of the vertices that are enumerated now
+ * @param mask the bits of center that are flipped for the next vertex
+ *
+ * @method Next writes the next vertex to vertex, returns false when all the 2^dimension vertices were enumerated
+ */
+class HammingBall
+{
+private:
+    uint32_t center;
+    int dimension;
+    int radius;
+    uint64_t mask;
+
+public:
+    HammingBall(int center, int dimension);
+    ~HammingBall();
+
+    bool Next(int &vertex);
+};
+
+#endif
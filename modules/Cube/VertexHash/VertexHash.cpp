@@ -0,0 +1,12 @@
+#include "VertexHash.hpp"
+
+// The salts are drawn from the generator of the calling thread like the h_i functions, so they follow the seed
+VertexHash::VertexHash(int dimension)
+{
+    for (int i = 0; i < dimension; i++)
+        salts.push_back(ThreadGenerator()());
+}
+
+VertexHash::~VertexHash() {}
+
+std::size_t VertexHash::memoryUsage() const { return salts.capacity() * sizeof(uint64_t); }
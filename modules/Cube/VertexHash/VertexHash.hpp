@@ -0,0 +1,44 @@
+#ifndef VERTEXHASH_HPP_
+#define VERTEXHASH_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Random.hpp"
+
+/**
+ * @brief The f_i functions of a Cube, that map the value of every h_i function to a bit of the vertex of an image.
+ * f_i(h) is the top bit of the splitmix64 hash of h and the salt of f_i, a coin flip that is random for every value h
+ * but fixed once the salt is drawn. So no value has to be remembered, the functions have no state to update and the
+ * images and the queries are hashed the same way by any number of threads
+ *
+ * @param salts one random 64-bit salt per function, drawn by the constructor
+ *
+ * @method dimension the number of bits of a vertex
+ * @method operator() the vertex of the values hashes[0..dimension()), the bit of f_0 is the most significant one
+ * @method memoryUsage bytes of the salts
+ */
+class VertexHash
+{
+private:
+    std::vector<uint64_t> salts;
+
+public:
+    explicit VertexHash(int dimension);
+    ~VertexHash();
+
+    inline int dimension() const { return salts.size(); }
+
+    inline int operator()(const uint64_t *hashes) const
+    {
+        int vertex = 0;
+        for (std::size_t i = 0; i < salts.size(); i++)
+            vertex = (vertex << 1) | (int)(Mix64(hashes[i] ^ salts[i]) >> 63);
+        return vertex;
+    }
+
+    std::size_t memoryUsage() const;
+};
+
+#endif
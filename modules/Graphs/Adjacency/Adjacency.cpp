@@ -0,0 +1,97 @@
+#include <iostream>
+#include <algorithm>
+
+#include "Adjacency.hpp"
+
+Adjacency::Adjacency() : numImages(0), offsets(nullptr), neighbors(nullptr) {}
+
+Adjacency::Adjacency(const std::vector<std::vector<int>> &lists) : numImages(lists.size())
+{
+    ownedOffsets.resize(numImages + 1, 0);
+    for (std::size_t i = 0; i < numImages; i++)
+        ownedOffsets[i + 1] = ownedOffsets[i] + lists[i].size();
+
+    ownedNeighbors.reserve(ownedOffsets.back());
+    for (const std::vector<int> &list : lists)
+        for (int id : list)
+            ownedNeighbors.push_back((uint32_t)id);
+
+    offsets = ownedOffsets.data();
+    neighbors = ownedNeighbors.data();
+}
+
+Adjacency::Adjacency(std::size_t numImages, const uint64_t *offsets, const uint32_t *neighbors, std::shared_ptr<const void> owner)
+    : numImages(numImages), owner(owner), offsets(offsets), neighbors(neighbors)
+{
+    // A bad offset or id would be read out of bounds by every search, so they are checked once here
+    if (offsets[0] != 0)
+    {
+        std::cerr << "The graph has invalid offsets." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    for (std::size_t i = 0; i < numImages; i++)
+    {
+        if (offsets[i] > offsets[i + 1])
+        {
+            std::cerr << "The graph has invalid offsets." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+        for (uint64_t e = offsets[i]; e < offsets[i + 1]; e++)
+            if (neighbors[e] >= numImages)
+            {
+                std::cerr << "The graph has an edge to image " << neighbors[e] << ", which does not exist." << std::endl;
+                exit(EXIT_FAILURE);
+            }
+    }
+}
+
+// The lists are copied and sorted, so this costs more than the bounds checks of the constructor
+void Adjacency::Verify() const
+{
+    std::vector<uint32_t> list;
+    for (std::size_t i = 0; i < numImages; i++)
+    {
+        list.assign(neighbors + offsets[i], neighbors + offsets[i + 1]);
+        std::sort(list.begin(), list.end());
+        if (std::adjacent_find(list.begin(), list.end()) != list.end() || std::binary_search(list.begin(), list.end(), (uint32_t)i))
+        {
+            std::cerr << "The neighbors of image " << i << " contain the image itself or an image twice." << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+// Moving a vector keeps its buffer, so the pointers stay valid
+Adjacency::Adjacency(Adjacency &&other)
+    : numImages(other.numImages), ownedOffsets(std::move(other.ownedOffsets)), ownedNeighbors(std::move(other.ownedNeighbors)),
+      owner(std::move(other.owner)), offsets(other.offsets), neighbors(other.neighbors)
+{
+    other.numImages = 0;
+    other.offsets = nullptr;
+    other.neighbors = nullptr;
+}
+
+Adjacency &Adjacency::operator=(Adjacency &&other)
+{
+    if (this != &other)
+    {
+        numImages = other.numImages;
+        ownedOffsets = std::move(other.ownedOffsets);
+        ownedNeighbors = std::move(other.ownedNeighbors);
+        owner = std::move(other.owner);
+        offsets = other.offsets;
+        neighbors = other.neighbors;
+        other.numImages = 0;
+        other.offsets = nullptr;
+        other.neighbors = nullptr;
+    }
+    return *this;
+}
+
+std::size_t Adjacency::maxDegree() const
+{
+    std::size_t degree = 0;
+    for (std::size_t i = 0; i < numImages; i++)
+        degree = std::max(degree, (std::size_t)(offsets[i + 1] - offsets[i]));
+    return degree;
+}
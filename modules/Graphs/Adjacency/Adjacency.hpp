@@ -0,0 +1,74 @@
+#ifndef ADJACENCY_HPP_
+#define ADJACENCY_HPP_
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// The neighbors of one image, a range of consecutive ids inside an Adjacency
+class NeighborList
+{
+private:
+    const uint32_t *first;
+    const uint32_t *last;
+
+public:
+    NeighborList(const uint32_t *first, const uint32_t *last) : first(first), last(last) {}
+
+    inline const uint32_t *begin() const { return first; }
+    inline const uint32_t *end() const { return last; }
+    inline std::size_t size() const { return last - first; }
+    inline int operator[](std::size_t i) const { return (int)first[i]; }
+};
+
+/**
+ * @brief The edges of a graph in compressed sparse row form, built once and never changed afterwards.
+ * The neighbors of all the images are stored back to back as uint32_t ids, the neighbors of image i are the ids in
+ * [offsets[i], offsets[i + 1]). Iterating the neighbors of an image reads one contiguous range.
+ * The arrays are either owned or borrowed from memory that is kept alive by owner, as with a mapped graph file.
+ *
+ * @param numImages the number of images, offsets has numImages + 1 entries
+ * @param offsets the start of the neighbors of every image
+ * @param neighbors the neighbor ids
+ *
+ * @method operator[] returns the neighbors of an image
+ * @method memoryUsage returns the bytes occupied by the offsets and the neighbor ids
+ * @method Verify checks that no image is its own neighbor and that no list has an image twice
+ */
+class Adjacency
+{
+private:
+    std::size_t numImages;
+    std::vector<uint64_t> ownedOffsets;
+    std::vector<uint32_t> ownedNeighbors;
+    std::shared_ptr<const void> owner;
+    const uint64_t *offsets;
+    const uint32_t *neighbors;
+
+public:
+    Adjacency();
+    // Copies the lists, which may have different sizes
+    explicit Adjacency(const std::vector<std::vector<int>> &lists);
+    // Borrows the arrays, the offsets and the ids are checked once here. owner keeps them alive
+    Adjacency(std::size_t numImages, const uint64_t *offsets, const uint32_t *neighbors, std::shared_ptr<const void> owner);
+
+    // The arrays may be borrowed, so an adjacency can only be moved
+    Adjacency(const Adjacency &) = delete;
+    Adjacency &operator=(const Adjacency &) = delete;
+    Adjacency(Adjacency &&other);
+    Adjacency &operator=(Adjacency &&other);
+
+    inline std::size_t size() const { return numImages; }
+    inline std::size_t numEdges() const { return numImages ? offsets[numImages] : 0; }
+    inline const uint64_t *GetOffsets() const { return offsets; }
+    inline const uint32_t *GetNeighbors() const { return neighbors; }
+
+    inline NeighborList operator[](std::size_t i) const { return NeighborList(neighbors + offsets[i], neighbors + offsets[i + 1]); }
+
+    std::size_t maxDegree() const;
+    void Verify() const;
+    inline std::size_t memoryUsage() const { return (numImages + 1) * sizeof(uint64_t) + numEdges() * sizeof(uint32_t); }
+};
+
+#endif
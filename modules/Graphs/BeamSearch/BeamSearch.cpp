@@ -0,0 +1,44 @@
+#include <algorithm>
+
+#include "BeamSearch.hpp"
+
+VisitedList::VisitedList(std::size_t numImages) : stamps(numImages, 0), epoch(0) {}
+
+void VisitedList::Reset()
+{
+    epoch++;
+    // After a wrap around old stamps could equal the new epoch
+    if (epoch == 0)
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        epoch = 1;
+    }
+}
+
+CandidatePool::CandidatePool(int capacity) : entries(capacity), count(0) {}
+
+void CandidatePool::Clear(int capacity)
+{
+    if ((int)entries.size() != capacity)
+        entries.resize(capacity);
+    count = 0;
+}
+
+int CandidatePool::Insert(int id, double distance)
+{
+    int capacity = entries.size();
+    if (count == capacity && (capacity == 0 || distance >= entries[count - 1].distance))
+        return capacity;
+
+    // Shift the farther candidates one place, the worst one falls off a full pool
+    int position = count < capacity ? count : capacity - 1;
+    while (position > 0 && entries[position - 1].distance > distance)
+    {
+        entries[position] = entries[position - 1];
+        position--;
+    }
+    entries[position] = PoolCandidate(id, distance);
+    if (count < capacity)
+        count++;
+    return position;
+}
@@ -0,0 +1,174 @@
+#ifndef BEAM_SEARCH_HPP_
+#define BEAM_SEARCH_HPP_
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Image.hpp"
+#include "Dataset.hpp"
+#include "PublicTypes.hpp"
+
+/**
+ * @brief Marks the images a search has already met. Every image has a stamp and it is marked when its stamp equals
+ * the current epoch, so starting a new search only increments the epoch instead of clearing the array.
+ * The array is only cleared when the epoch wraps around.
+ *
+ * @method Reset forgets all the marks, called once before every search
+ * @method Visit marks an image and returns whether it was not marked before
+ */
+class VisitedList
+{
+private:
+    std::vector<uint32_t> stamps;
+    uint32_t epoch;
+
+public:
+    explicit VisitedList(std::size_t numImages = 0);
+
+    void Reset();
+    inline bool IsVisited(int id) const { return stamps[id] == epoch; }
+    inline bool Visit(int id)
+    {
+        if (stamps[id] == epoch)
+            return false;
+        stamps[id] = epoch;
+        return true;
+    }
+    inline std::size_t size() const { return stamps.size(); }
+};
+
+// An entry of the candidate pool, expanded is set once the neighbors of the image have been checked
+class PoolCandidate
+{
+public:
+    int id;
+    double distance;
+    bool expanded;
+
+    PoolCandidate() : id(-1), distance(0), expanded(false) {}
+    PoolCandidate(int id, double distance) : id(id), distance(distance), expanded(false) {}
+};
+
+/**
+ * @brief The best candidates of a search, at most capacity of them, kept sorted by their distance to the query in an
+ * array that is allocated once. A candidate that is not closer than the worst one of a full pool is rejected.
+ *
+ * @method Insert adds a candidate and returns its position, or the capacity if it was rejected
+ * @method IsFull returns whether a new candidate has to beat the worst one to enter
+ */
+class CandidatePool
+{
+private:
+    std::vector<PoolCandidate> entries;
+    int count;
+
+public:
+    explicit CandidatePool(int capacity = 0);
+
+    void Clear(int capacity);
+    int Insert(int id, double distance);
+
+    inline int size() const { return count; }
+    inline int capacity() const { return (int)entries.size(); }
+    inline bool IsFull() const { return count == (int)entries.size(); }
+    inline const PoolCandidate &worst() const { return entries[count - 1]; }
+    inline PoolCandidate &operator[](int i) { return entries[i]; }
+    inline const PoolCandidate &operator[](int i) const { return entries[i]; }
+};
+
+/**
+ * @brief Search on graph with a bounded beam, shared by the graph algorithms. The search starts from the entry images
+ * and repeatedly expands the closest candidate that is not expanded yet, it stops when all the candidates in the pool
+ * are expanded. Every image is compared to the query at most once per search.
+ * The visited marks and the pool are allocated once and reused by all the searches, so a BeamSearch must not be
+ * shared by concurrent searches. Graph is any type whose operator[] returns a list of neighbor ids, as Adjacency.
+ *
+ * @param images the images of the graph
+ * @param visited the images compared to the query by the current search
+ * @param pool the l best candidates of the current search
+ *
+ * @method Search returns at most numResults of the nearest candidates found with a pool of l candidates. If expanded
+ * is given, every expanded image is appended to it with its distance, in the order of expansion
+ * @method SearchBy the same search with the distance of image id to the query given by measure(id), e.g. the distance
+ * of its PQ code
+ * @method Distances returns how many distances the last search computed
+ */
+template <typename T, typename Distance>
+class BeamSearch
+{
+private:
+    const Dataset<T> &images;
+    Distance distance;
+    VisitedList visited;
+    CandidatePool pool;
+    int numDistances;
+
+public:
+    BeamSearch(const Dataset<T> &images) : images(images), visited(images.size()), numDistances(0) {}
+
+    template <typename Graph>
+    std::vector<Neighbor> Search(const Graph &graph, const ImageView<T> &query, const std::vector<int> &entries, int numResults, int l,
+                                 std::vector<Neighbor> *expanded = nullptr)
+    {
+        return SearchBy(graph, [&](int id)
+                        { return distance(images[id], query); }, entries, numResults, l, expanded);
+    }
+
+    template <typename Graph, typename Measure>
+    std::vector<Neighbor> SearchBy(const Graph &graph, Measure measure, const std::vector<int> &entries, int numResults, int l,
+                                   std::vector<Neighbor> *expanded = nullptr)
+    {
+        visited.Reset();
+        pool.Clear(l);
+        numDistances = 0;
+
+        for (int entry : entries)
+            if (visited.Visit(entry))
+            {
+                pool.Insert(entry, measure(entry));
+                numDistances++;
+            }
+
+        // k is the first candidate that is not expanded, everything before it is expanded
+        int k = 0;
+        while (k < pool.size())
+        {
+            PoolCandidate &current = pool[k];
+            current.expanded = true;
+            int id = current.id;
+            if (expanded)
+                expanded->push_back(Neighbor(id, current.distance));
+
+            // The position of the closest new candidate, the search continues from there if it is before k
+            int next = pool.size();
+            for (int neighbor : graph[id])
+            {
+                if (!visited.Visit(neighbor))
+                    continue;
+                double dist = measure(neighbor);
+                numDistances++;
+                if (pool.IsFull() && dist >= pool.worst().distance)
+                    continue;
+                int position = pool.Insert(neighbor, dist);
+                if (position < next)
+                    next = position;
+            }
+
+            if (next <= k)
+                k = next;
+            else
+                while (k < pool.size() && pool[k].expanded)
+                    k++;
+        }
+
+        std::vector<Neighbor> results;
+        for (int i = 0; i < pool.size() && (int)results.size() < numResults; i++)
+            results.push_back(Neighbor(pool[i].id, pool[i].distance));
+        return results;
+    }
+
+    inline int Distances() const { return numDistances; }
+};
+
+#endif
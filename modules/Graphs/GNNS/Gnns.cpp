@@ -1,74 +1,40 @@
 #include <vector>
-#include <set>
-#include <pthread.h>
+#include <algorithm>
 
 #include "Image.hpp"
-#include "Lsh.hpp"
+#include "Dataset.hpp"
+#include "KnnGraph.hpp"
 #include "PublicTypes.hpp"
 #include "ImageDistance.hpp"
+#include "BruteForce.hpp"
 #include "Gnns.hpp"
 #include "Utils.hpp"
+#include "Random.hpp"
 
-class threadArgs
+template <typename T, typename Distance>
+GNNS<T, Distance>::GNNS(const Dataset<T> &images, int graphNN, int expansions, int restarts, int numNn, KnnGraphMethod init)
+    : graphNN(graphNN), expansions(expansions), restarts(restarts), numNn(numNn), images(images), visited(images.size()), nearest(numNn), quantizer(nullptr), rerank(0)
 {
-public:
-    int start;
-    int end;
-    std::vector<std::vector<ImagePtr>> *storage;
-    std::vector<ImagePtr> images;
-    Lsh *lsh;
-    threadArgs(int start, int end, const std::vector<ImagePtr> &images, Lsh *lsh, std::vector<std::vector<ImagePtr>> *storage) : start(start), end(end), storage(storage), images(images), lsh(lsh) {}
-};
-
-static void *parallel_initialization(void *arg)
-{
-    threadArgs *args = (threadArgs *)arg;
-    for (int i = args->start; i < args->end; i++)
-        for (auto neighbor : args->lsh->Approximate_kNN(args->images[i]))
-            (*args->storage)[i].push_back(neighbor.image);
-
-    delete args;
-    return nullptr;
-}
-
-GNNS::GNNS(const std::vector<ImagePtr> &images, int graphNN, int expansions, int restarts, int numNn)
-    : graphNN(graphNN), expansions(expansions), restarts(restarts), numNn(numNn)
-{
-    // Initialize the general distance
-    this->distance = ImageDistance::getInstance();
-
-    // Initialize lsh which will be used to initialize the graph
-    Lsh lsh(images, 4, 5, graphNN + 1, 2240, (int)images.size() / 8);
-
     // startClock();
 
-    // In order to avoid multiple reallocs we will resize the vector
-    PointsWithNeighbors.resize((int)images.size());
-
     // We need to initialize our graph, for every image in the input file we will get its neighbors
     // and store them in a 2d vector the first dimension will represent the Image in the input file
     // and the second its neighbors
-    // for (int i = 0; i < (int)images.size(); i++)
-    //     for (auto neighbor : lsh.Approximate_kNN(images[i]))
-    //         PointsWithNeighbors[i].push_back(neighbor.image);
-    const int threadNum = 4;
-    std::vector<pthread_t> threads(threadNum);
-    for (int i = 0; i < threadNum; i++)
-        pthread_create(&threads[i], nullptr, parallel_initialization,
-                       new threadArgs(i * ((int)images.size() / threadNum),
-                                      (i == threadNum - 1) ? (int)images.size() : (i + 1) * ((int)images.size() / threadNum),
-                                      images,
-                                      &lsh,
-                                      &PointsWithNeighbors));
-
-    for (int i = 0; i < threadNum; i++)
-        pthread_join(threads[i], nullptr);
+    std::vector<std::vector<Neighbor>> knnGraph = KnnGraph<T, Distance>(images, graphNN, init);
+    std::vector<std::vector<int>> lists(images.size());
+    for (int i = 0; i < (int)images.size(); i++)
+        for (auto neighbor : knnGraph[i])
+            lists[i].push_back(neighbor.id);
+    knnGraph.clear();
+
+    // The graph does not change after this point, so it is frozen in CSR form
+    PointsWithNeighbors = Adjacency(lists);
 
     // auto gnnsDuration = stopClock();
     // std::cout << "GNNS initialized in: " << gnnsDuration.count() * 1e-9 << " seconds" << std::endl;
 }
 
-// GNNS::GNNS(const std::vector<ImagePtr> &images, int graphNN, int expansions, int restarts, int numNn)
+// GNNS::GNNS(const Dataset &images, int graphNN, int expansions, int restarts, int numNn)
 //     : graphNN(graphNN), expansions(expansions), restarts(restarts), numNn(numNn)
 // {
 //     // Initialize the general distance
@@ -82,61 +48,129 @@ GNNS::GNNS(const std::vector<ImagePtr> &images, int graphNN, int expansions, int
 //     // and the second its neighbors
 //     for (int i = 0; i < (int)images.size(); i++)
 //         for (auto neighbor : lsh.Approximate_kNN(images[i]))
-//             PointsWithNeighbors[i].push_back(neighbor.image);
+//             PointsWithNeighbors[i].push_back(neighbor.id);
 // }
 
-GNNS::~GNNS() {}
+// Takes a graph that is already built, graphNN is the size of the longest neighbor list
+template <typename T, typename Distance>
+GNNS<T, Distance>::GNNS(const Dataset<T> &images, Adjacency &&graph, int expansions, int restarts, int numNn)
+    : graphNN(graph.maxDegree()), expansions(expansions), restarts(restarts), numNn(numNn), images(images), PointsWithNeighbors(std::move(graph)),
+      visited(images.size()), nearest(numNn), quantizer(nullptr), rerank(0) {}
+
+template <typename T, typename Distance>
+GNNS<T, Distance>::~GNNS() {}
+
+template <typename T, typename Distance>
+void GNNS<T, Distance>::save(const std::string &path) const
+{
+    GraphFileHeader header(GraphKind::GNNS, Distance::name(), images.size(), images.dimension(), -1);
+    WriteGraphFile(path, header, PointsWithNeighbors);
+}
+
+template <typename T, typename Distance>
+GNNS<T, Distance> *GNNS<T, Distance>::load(const Dataset<T> &images, const std::string &path, int expansions, int restarts, int numNn, bool verify)
+{
+    std::shared_ptr<GraphFile> file = std::make_shared<GraphFile>(path, GraphFileHeader(GraphKind::GNNS, Distance::name(), images.size(), images.dimension(), -1));
+    // The neighbors are read from the mapped file, it stays mapped as long as the graph uses it
+    return new GNNS(images, file->adjacency(verify), expansions, restarts, numNn);
+}
 
-std::vector<Neighbor> GNNS::Approximate_kNN(ImagePtr query)
+template <typename T, typename Distance>
+void GNNS<T, Distance>::UseQuantizer(const ProductQuantizer *quantizer, int rerank)
 {
-    // We are using a set to store the objects efficiently with a custom compare class
-    std::set<Neighbor, CompareNeighbor> nearestNeighbors;
-    // std::cout << "Query: " << query->id << std::endl;
+    if (quantizer && quantizer->size() != images.size())
+    {
+        std::cerr << "GNNS: the quantizer encodes " << quantizer->size() << " images instead of " << images.size() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    this->quantizer = quantizer;
+    this->rerank = rerank;
+}
+
+template <typename T, typename Distance>
+std::vector<Neighbor> GNNS<T, Distance>::Approximate_kNN(const ImageView<T> &query) { return Search(query, visited, nearest); }
+
+template <typename T, typename Distance>
+void GNNS<T, Distance>::SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool)
+{
+    std::vector<VisitedList> threadVisited(pool.size(), VisitedList(images.size()));
+    std::vector<CandidatePool> threadNearest(pool.size(), CandidatePool(numNn));
+
+    results.resize(queries.size());
+    pool.ParallelFor(queries.size(), [&](std::size_t q, int thread)
+                     { results[q] = Search(queries[q], threadVisited[thread], threadNearest[thread]); });
+}
+
+// The greedy search with restarts, visited and nearest are the state of the calling thread
+template <typename T, typename Distance>
+std::vector<Neighbor> GNNS<T, Distance>::Search(const ImageView<T> &query, VisitedList &visited, CandidatePool &nearest) const
+{
+    // The numNn nearest images go to a bounded pool and every image is compared to the query only once,
+    // even when several restarts reach it
+    // With a quantizer the images are compared by the distances of their codes, and the pool keeps the rerank nearest
+    std::vector<float> table;
+    if (quantizer)
+        quantizer->Table<Distance>(query.pixels, table);
+    visited.Reset();
+    nearest.Clear(quantizer ? std::max(numNn, rerank) : numNn);
+    // The restarts of a query come from its own stream, so they do not depend on the thread or on the other queries
+    Xoshiro256 generator = RandomStream(GnnsStreams + query.id);
+    // std::cout << "Query: " << query.id << std::endl;
     // We will do the same update process for all restarts
     for (int r = 0; r < restarts; r++)
     {
         // find Y_0 uniformly over D
-        int Y_prev = IntDistribution(0, (int)PointsWithNeighbors.size() - 1);
+        int Y_prev = generator.Uniform(PointsWithNeighbors.size());
         int t;
         // We will find new points t-1 times because the first one was done outside the loop
         for (t = 1; t <= 30; t++)
         {
             double min = -1;
             int index = -1;
-            // We first check that the LSH returned expansions number of neighbors otherwise we are doing
-            // the same process for size() numbers of neighbors
-            int limit = (expansions > (int)PointsWithNeighbors[Y_prev].size() ? (int)PointsWithNeighbors[Y_prev].size() : expansions + 1);
-            // We skip the first neighbor because it is itself with distance 0 and we go until + 1
-            // to take all the expanded neighbors
-            for (int i = 1; i < limit; i++)
+            // We first check that the graph has expansions number of neighbors otherwise we are doing
+            // the same process for size() numbers of neighbors, the image itself is not one of them
+            NeighborList neighbors = PointsWithNeighbors[Y_prev];
+            int limit = std::min(expansions, (int)neighbors.size());
+            for (int i = 0; i < limit; i++)
             {
+                // A visited neighbor is already in S, so its distance is not computed again
+                if (!visited.Visit(neighbors[i]))
+                    continue;
                 // Calculate the distance of the neighbor with the query
-                double dist = distance->calculate(PointsWithNeighbors[Y_prev][i], query);
+                double dist = quantizer ? quantizer->Adc(table.data(), neighbors[i]) : distance(images[neighbors[i]], query);
                 // Update set with S U N(Y_t-1,E,G)
-                nearestNeighbors.insert(Neighbor(PointsWithNeighbors[Y_prev][i], dist));
+                nearest.Insert(neighbors[i], dist);
                 // Find Y_t = argmin_Y_in_N(Y_t-1,E,G) δ(Y,query)
                 if (min == -1 || dist < min)
                 {
                     min = dist;
-                    index = PointsWithNeighbors[Y_prev][i]->id;
+                    index = neighbors[i];
                 }
             }
             if (index == -1)
                 break;
-            if (nearestNeighbors.size() > 1)
-            {
-                Neighbor smallest = *nearestNeighbors.begin();
-                if (min > smallest.distance)
-                    break;
-            }
+            if (nearest.size() > 1 && min > nearest[0].distance)
+                break;
 
             Y_prev = index;
         }
         // std::cout << "For restart: " << r << std::endl;
         // std::cout << "Stopped at greedy step: " << t << std::endl;
     }
-    // The set is already sorted so we can skip the sorting step
+    // The pool is already sorted so we can skip the sorting step
     // Lastly we want to make a vector from those neighbors
-    std::vector<Neighbor> KnearestNeighbors(nearestNeighbors.begin(), std::next(nearestNeighbors.begin(), std::min(numNn, static_cast<int>(nearestNeighbors.size()))));
+    std::vector<Neighbor> KnearestNeighbors;
+    for (int i = 0; i < nearest.size(); i++)
+        KnearestNeighbors.push_back(Neighbor(nearest[i].id, nearest[i].distance));
+    if (quantizer)
+        return Rerank(images, query, KnearestNeighbors, numNn, distance);
     return KnearestNeighbors;
-}
\ No newline at end of file
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template class GNNS<uint8_t, EuclideanDistance>;
+template class GNNS<float, EuclideanDistance>;
+template class GNNS<double, EuclideanDistance>;
+template class GNNS<uint8_t, ManhattanDistance>;
+template class GNNS<float, ManhattanDistance>;
+template class GNNS<double, ManhattanDistance>;
\ No newline at end of file
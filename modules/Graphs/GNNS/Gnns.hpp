@@ -3,32 +3,62 @@
 
 #include <vector>
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "ImageDistance.hpp"
 #include "GraphAlgorithm.hpp"
+#include "KnnGraph.hpp"
+#include "Adjacency.hpp"
+#include "GraphFile.hpp"
+#include "BeamSearch.hpp"
 /**
  * @brief The class of a GNNS consists of the following
  *
- * @param graphNN the number of nearest neighbors for lsh
+ * @param graphNN the number of nearest neighbors of every image in the graph, found with NN-Descent or lsh (init)
  * @param expansions the number of expansions to find Y_t
  * @param restarts the number of restart which starts from a random point
  * @param numNn the number of nearest neighbors needed
+ * @param images the input dataset, the graph stores the ids of the neighbors of every image
+ * @param PointsWithNeighbors the kNN graph, frozen in CSR form once it is built
+ * @param visited the images compared to the query, reused by all the queries
+ * @param nearest the numNn nearest images found by the query
+ * @param quantizer the codes of the images the search walks the graph with, nullptr walks it with the exact distances
+ * @param rerank the number of images nearest by their codes that are ranked again with their exact distances
  *
  * @method Approximate_kNN returns a vector with numNn aproxximate nearest neighbors
+ * @method SearchBatch answers many queries in parallel, every thread has its own visited list and pool
+ * @method UseQuantizer walks the graph of the next queries with the codes of quantizer, see GraphAlgorithm
+ * @method memoryUsage bytes of the graph, without the images
+ * @method save writes the graph to a graph file
+ * @method load creates a GNNS from a graph file that was saved for the same images and metric, without building it.
+ * With verify the lists are checked more thoroughly, see GraphFile::adjacency
  */
-class GNNS : public GraphAlgorithm
+template <typename T, typename Distance>
+class GNNS : public GraphAlgorithm<T>
 {
 private:
     int graphNN;
     int expansions;
     int restarts;
     int numNn;
-    ImageDistance *distance;
-    std::vector<std::vector<ImagePtr>> PointsWithNeighbors;
+    const Dataset<T> &images;
+    Distance distance;
+    Adjacency PointsWithNeighbors;
+    VisitedList visited;
+    CandidatePool nearest;
+    const ProductQuantizer *quantizer;
+    int rerank;
+    GNNS(const Dataset<T> &images, Adjacency &&graph, int expansions, int restarts, int numNn);
+    std::vector<Neighbor> Search(const ImageView<T> &query, VisitedList &visited, CandidatePool &nearest) const;
 
 public:
-    GNNS(const std::vector<ImagePtr> &images, int graphNN, int expansions, int restarts, int numNn);
+    GNNS(const Dataset<T> &images, int graphNN, int expansions, int restarts, int numNn, KnnGraphMethod init = KnnGraphMethod::NN_DESCENT);
     ~GNNS();
-    std::vector<Neighbor> Approximate_kNN(ImagePtr query);
+    std::vector<Neighbor> Approximate_kNN(const ImageView<T> &query);
+    void SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool);
+    void save(const std::string &path) const;
+    std::size_t memoryUsage() const { return PointsWithNeighbors.memoryUsage(); }
+    void UseQuantizer(const ProductQuantizer *quantizer, int rerank);
+    static GNNS *load(const Dataset<T> &images, const std::string &path, int expansions, int restarts, int numNn, bool verify = false);
 };
 
 #endif
\ No newline at end of file
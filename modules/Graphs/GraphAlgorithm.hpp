@@ -2,14 +2,27 @@
 #define SEARCH_ALGORITHM_HPP_
 
 #include <vector>
+#include "Image.hpp"
 #include "PublicTypes.hpp"
+#include "ThreadPool.hpp"
+#include "ProductQuantizer.hpp"
 
-// Search Algorithm interface
+// Search Algorithm interface, T is the pixel type of the input and query images.
+// SearchBatch answers all the queries on the threads of the pool, results[q] are the neighbors of queries[q].
+// Every thread has its own search state, so a batch gives the same results as calling Approximate_kNN on each query.
+// memoryUsage is the size of the index in bytes, without the images.
+// UseQuantizer makes the next searches walk the graph with the distances of the PQ codes of quantizer, which encodes
+// the same images, and rank the rerank nearest images found again with their exact distances, nullptr goes back to the
+// exact distances
+template <typename T>
 class GraphAlgorithm
 {
 public:
     virtual ~GraphAlgorithm() = default;
-    virtual std::vector<Neighbor> Approximate_kNN(ImagePtr query) = 0;
+    virtual std::vector<Neighbor> Approximate_kNN(const ImageView<T> &query) = 0;
+    virtual void SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool) = 0;
+    virtual std::size_t memoryUsage() const = 0;
+    virtual void UseQuantizer(const ProductQuantizer *quantizer, int rerank) = 0;
 };
 
 #endif
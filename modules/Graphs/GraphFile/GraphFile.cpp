@@ -0,0 +1,121 @@
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "GraphFile.hpp"
+
+static const char GraphFileMagic[8] = {'A', 'N', 'N', 'G', 'R', 'A', 'P', 'H'};
+
+GraphFileHeader::GraphFileHeader() { memset(this, 0, sizeof(GraphFileHeader)); }
+
+GraphFileHeader::GraphFileHeader(GraphKind kind, const char *metric, uint32_t numImages, uint32_t dimension, int32_t navNode)
+{
+    memset(this, 0, sizeof(GraphFileHeader));
+    memcpy(this->magic, GraphFileMagic, sizeof(GraphFileMagic));
+    this->version = CurrentVersion;
+    this->kind = kind;
+    strncpy(this->metric, metric, sizeof(this->metric) - 1);
+    this->numImages = numImages;
+    this->dimension = dimension;
+    this->navNode = navNode;
+}
+
+void WriteGraphFile(const std::string &path, GraphFileHeader header, const Adjacency &graph)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        std::cerr << "Failed to open the graph file " << path << " for writing." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The graph is already in the layout of the file
+    header.numEdges = graph.numEdges();
+    uint64_t emptyOffset = 0;
+    const uint64_t *offsets = graph.size() ? graph.GetOffsets() : &emptyOffset;
+
+    file.write((const char *)&header, sizeof(GraphFileHeader));
+    file.write((const char *)offsets, (graph.size() + 1) * sizeof(uint64_t));
+    file.write((const char *)graph.GetNeighbors(), graph.numEdges() * sizeof(uint32_t));
+
+    if (!file)
+    {
+        std::cerr << "Failed to write the graph file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+GraphFile::GraphFile(const std::string &path, const GraphFileHeader &expected) : data(nullptr), size(0), header(nullptr)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open the graph file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0 || (std::size_t)status.st_size < sizeof(GraphFileHeader))
+    {
+        std::cerr << "The graph file " << path << " is too small." << std::endl;
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+    size = status.st_size;
+
+    // The mapping stays valid after the descriptor is closed
+    data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        std::cerr << "Failed to map the graph file " << path << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    header = (const GraphFileHeader *)data;
+
+    if (memcmp(header->magic, GraphFileMagic, sizeof(GraphFileMagic)))
+    {
+        std::cerr << path << " is not a graph file." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (header->version != GraphFileHeader::CurrentVersion)
+    {
+        std::cerr << "The graph file " << path << " has version " << header->version << ", expected " << GraphFileHeader::CurrentVersion << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (header->kind != expected.kind || strncmp(header->metric, expected.metric, sizeof(header->metric)))
+    {
+        std::cerr << "The graph file " << path << " was written by another algorithm or for another metric." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (header->numImages != expected.numImages || header->dimension != expected.dimension)
+    {
+        std::cerr << "The graph file " << path << " was built for " << header->numImages << " images of dimension "
+                  << header->dimension << ", the input has " << expected.numImages << " of dimension " << expected.dimension << "." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    if (size != sizeof(GraphFileHeader) + (header->numImages + 1) * sizeof(uint64_t) + header->numEdges * sizeof(uint32_t) ||
+        offsets()[header->numImages] != header->numEdges)
+    {
+        std::cerr << "The graph file " << path << " is truncated or corrupted." << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+GraphFile::~GraphFile()
+{
+    if (data)
+        munmap(data, size);
+}
+
+Adjacency GraphFile::adjacency(bool verify) const
+{
+    Adjacency graph(header->numImages, offsets(), neighbors(), shared_from_this());
+    if (verify)
+        graph.Verify();
+    return graph;
+}
@@ -0,0 +1,83 @@
+#ifndef GRAPH_FILE_HPP_
+#define GRAPH_FILE_HPP_
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "Adjacency.hpp"
+
+// The graph algorithm a file was written by, a file can only be loaded by the same algorithm
+enum class GraphKind : uint32_t
+{
+    GNNS = 1,
+    MRNG = 2
+};
+
+/**
+ * @brief The header at the start of a graph file. It is followed by the graph in CSR form: numImages + 1 uint64_t
+ * offsets and then numEdges uint32_t neighbor ids, the neighbors of image i are the ids in [offsets[i], offsets[i + 1]).
+ * Everything is stored in the byte order of the machine that wrote the file.
+ *
+ * @param magic always "ANNGRAPH"
+ * @param version the version of the format, files of another version are rejected
+ * @param metric the name of the metric the graph was built with
+ * @param navNode the image every search starts from, -1 if the algorithm has none
+ */
+class GraphFileHeader
+{
+public:
+    char magic[8];
+    uint32_t version;
+    GraphKind kind;
+    char metric[16];
+    uint32_t numImages;
+    uint32_t dimension;
+    int32_t navNode;
+    uint32_t reserved;
+    uint64_t numEdges;
+
+    static const uint32_t CurrentVersion = 1;
+
+    GraphFileHeader();
+    GraphFileHeader(GraphKind kind, const char *metric, uint32_t numImages, uint32_t dimension, int32_t navNode);
+};
+
+// Writes the header and the CSR arrays of the graph to path
+void WriteGraphFile(const std::string &path, GraphFileHeader header, const Adjacency &graph);
+
+/**
+ * @brief A graph file mapped read-only in memory. Only the header and the last offset are read when it is opened, the
+ * pages are loaded on first access and are shared by all the processes that map the same file. The header is checked
+ * against the expected one: the kind, the metric, the number of images and their dimension must match, and the size
+ * of the file must be the one of the header. The offsets and the ids are read once by adjacency, which checks them.
+ *
+ * @method offsets the numImages + 1 CSR offsets
+ * @method neighbors the numEdges neighbor ids
+ * @method adjacency returns the graph without copying it, the adjacency keeps the file mapped. The file must be owned by a shared_ptr.
+ * Every offset and neighbor id is checked, with verify the lists are also checked for self edges and duplicate ids
+ */
+class GraphFile : public std::enable_shared_from_this<GraphFile>
+{
+private:
+    void *data;
+    std::size_t size;
+    const GraphFileHeader *header;
+
+public:
+    GraphFile(const std::string &path, const GraphFileHeader &expected);
+    ~GraphFile();
+
+    // The file is unmapped by the destructor, so it can not be copied
+    GraphFile(const GraphFile &) = delete;
+    GraphFile &operator=(const GraphFile &) = delete;
+
+    inline const GraphFileHeader &GetHeader() const { return *header; }
+    inline const uint64_t *offsets() const { return (const uint64_t *)(header + 1); }
+    inline const uint32_t *neighbors() const { return (const uint32_t *)(offsets() + header->numImages + 1); }
+
+    Adjacency adjacency(bool verify = false) const;
+};
+
+#endif
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
 
 // A simple class which stores the command line argument for graphs algorithms
 // The arguments are initialized to their default values except from input,
@@ -17,6 +19,18 @@ public:
     std::string outputFile; // -o <output file>
     int m;                  // -m <1 for GNNS, 2 for MRNG>
     int l;                  // -l <int, only for Search-on-Graph> number of candidates
+    std::string metric;     // -metric <euclidean or manhattan>
+    int maxDegree;          // -degree <int, only for Search-on-Graph> maximum number of edges of an image
+    std::string init;       // -init <nndescent or lsh> how the kNN graph of GNNS and of the MRNG candidates is built
+    std::string saveFile;   // -save <graph file> where the built graph is written
+    std::string loadFile;   // -load <graph file> a saved graph that is used instead of building one
+    bool verify;            // -verify also checks the lists of a loaded graph for self edges and duplicate ids
+    int threads;            // -threads <int> number of threads of the build and of the queries, 0 for all the cores
+    std::string groundTruth; // -gt <directory> cache of ground truth files, the exact neighbors are read from it or written to it
+    uint64_t seed;          // -seed <int> seed of every random choice, the same seed gives the same graph and results
+    int chunk;              // -chunk <int> number of queries read and answered at a time, the next ones are read meanwhile
+    std::string format;     // -format <idx, fvecs, bvecs, ivecs or f32> format of the input and query files, by default from their extension
+    int dimension;          // -dim <int> dimension of the vectors of a raw f32 file
 
     int graphNN;    // -k number of Nearest Neighbors in the GRAPH
     int expansions; // -E number of extensions
@@ -28,6 +42,18 @@ public:
                                                         outputFile(""),
                                                         m(-1),
                                                         l(-1),
+                                                        metric("euclidean"),
+                                                        maxDegree(30),
+                                                        init("nndescent"),
+                                                        saveFile(""),
+                                                        loadFile(""),
+                                                        verify(false),
+                                                        threads(0),
+                                                        groundTruth(""),
+                                                        seed(1),
+                                                        chunk(10000),
+                                                        format(""),
+                                                        dimension(-1),
                                                         graphNN(50),
                                                         expansions(30),
                                                         restarts(1)
@@ -52,6 +78,30 @@ public:
                 m = atoi(argv[i + 1]);
             else if (!strcmp(argv[i], "-o"))
                 outputFile = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-degree"))
+                maxDegree = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "-init"))
+                init = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-save"))
+                saveFile = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-load"))
+                loadFile = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-verify"))
+                verify = true;
+            else if (!strcmp(argv[i], "-threads"))
+                threads = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "-gt"))
+                groundTruth = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-seed"))
+                seed = strtoull(argv[i + 1], nullptr, 10);
+            else if (!strcmp(argv[i], "-chunk"))
+                chunk = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "-format"))
+                format = std::string(argv[i + 1]);
+            else if (!strcmp(argv[i], "-dim"))
+                dimension = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "-metric"))
+                metric = std::string(argv[i + 1]);
         }
     }
 };
@@ -0,0 +1,50 @@
+#include <vector>
+
+#include "Dataset.hpp"
+#include "Lsh.hpp"
+#include "PublicTypes.hpp"
+#include "ImageDistance.hpp"
+#include "KnnGraph.hpp"
+#include "ThreadPool.hpp"
+
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> KnnGraph(const Dataset<T> &images, int k, KnnGraphMethod method)
+{
+    if (method == KnnGraphMethod::LSH)
+        return LshKnnGraph<T, Distance>(images, k);
+    return NnDescentKnnGraph<T, Distance>(images, k);
+}
+
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> LshKnnGraph(const Dataset<T> &images, int k)
+{
+    // The neighbors are found with lsh, we ask for one more because the image itself is returned too
+    Lsh<T, Distance> lsh(images, 4, 5, k + 1, 2240, (int)images.size() / 8);
+
+    // In order to avoid multiple reallocs we will resize the vector
+    std::vector<std::vector<Neighbor>> graph(images.size());
+
+    // Every image fills its own row
+    ThreadPool::Default().ParallelFor(images.size(), [&](std::size_t i, int)
+                                      {
+                                          for (const Neighbor &neighbor : lsh.Approximate_kNN(images[i]))
+                                              // The image itself is (almost always) its own nearest neighbor, it is not an edge of the graph
+                                              if (neighbor.id != (int)i && (int)graph[i].size() < k)
+                                                  graph[i].push_back(neighbor); });
+
+    return graph;
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template std::vector<std::vector<Neighbor>> KnnGraph<uint8_t, EuclideanDistance>(const Dataset<uint8_t> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> KnnGraph<float, EuclideanDistance>(const Dataset<float> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> KnnGraph<double, EuclideanDistance>(const Dataset<double> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> KnnGraph<uint8_t, ManhattanDistance>(const Dataset<uint8_t> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> KnnGraph<float, ManhattanDistance>(const Dataset<float> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> KnnGraph<double, ManhattanDistance>(const Dataset<double> &, int, KnnGraphMethod);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<uint8_t, EuclideanDistance>(const Dataset<uint8_t> &, int);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<float, EuclideanDistance>(const Dataset<float> &, int);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<double, EuclideanDistance>(const Dataset<double> &, int);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<uint8_t, ManhattanDistance>(const Dataset<uint8_t> &, int);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<float, ManhattanDistance>(const Dataset<float> &, int);
+template std::vector<std::vector<Neighbor>> LshKnnGraph<double, ManhattanDistance>(const Dataset<double> &, int);
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef KNN_GRAPH_HPP_
+#define KNN_GRAPH_HPP_
+
+#include <vector>
+
+#include "Dataset.hpp"
+#include "PublicTypes.hpp"
+
+// How the approximate k nearest neighbor graph is built
+enum class KnnGraphMethod
+{
+    LSH,
+    NN_DESCENT
+};
+
+/**
+ * @brief Builds an approximate k nearest neighbor graph of the dataset. Row i holds at most k neighbors of
+ * image i, never i itself, sorted by their rank distance. It is the initial graph of GNNS and the pool
+ * the Mrng edges are chosen from.
+ *
+ * @param images the dataset
+ * @param k the number of neighbors of every image
+ * @param method NN_DESCENT refines random neighbor lists with local joins, LSH queries an Lsh index for every image
+ */
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> KnnGraph(const Dataset<T> &images, int k, KnnGraphMethod method = KnnGraphMethod::NN_DESCENT);
+
+// One full Lsh query for every image, answered in parallel on the threads of ThreadPool::Default()
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> LshKnnGraph(const Dataset<T> &images, int k);
+
+/**
+ * @brief NN-Descent (Dong et al.): starts from random neighbor lists and compares the neighbors of every image
+ * with each other (local join), a neighbor of a neighbor is likely to be a neighbor. Only the pairs with at
+ * least one neighbor that is new since the last iteration are compared. The iterations stop when fewer than
+ * delta * n * k entries inserted by an iteration are still in the lists at its end. The lists keep the nearest
+ * neighbors by distance and then by id, and every image draws from its own streams, so the graph depends on the seed
+ * only and not on the threads.
+ *
+ * @param sampleRate the fraction of the k new neighbors (and of the reverse ones) joined in one iteration
+ * @param delta the convergence threshold
+ * @param maxIterations an upper bound on the iterations
+ */
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> NnDescentKnnGraph(const Dataset<T> &images, int k, double sampleRate = 0.5, double delta = 0.001, int maxIterations = 20);
+
+#endif
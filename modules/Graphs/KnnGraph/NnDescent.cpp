@@ -0,0 +1,186 @@
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include <cmath>
+
+#include "Dataset.hpp"
+#include "PublicTypes.hpp"
+#include "ImageDistance.hpp"
+#include "KnnGraph.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+
+// An entry of a neighbor list, isNew stays set until the entry takes part in a local join. iteration is the one
+// that inserted the entry, -1 for the random start
+class NnDescentEntry
+{
+public:
+    int id;
+    double distance;
+    bool isNew;
+    int iteration;
+    NnDescentEntry(int id, double distance, bool isNew, int iteration) : id(id), distance(distance), isNew(isNew), iteration(iteration) {}
+
+    inline bool operator<(const NnDescentEntry &other) const
+    {
+        return distance < other.distance || (distance == other.distance && id < other.id);
+    }
+};
+
+// The neighbor list of one image sorted by distance and then by id. The local joins of different images update the
+// same list, so every list has its own lock. The order of the ids makes the list the k smallest entries of all the
+// insertions, whatever order the threads insert them in
+class NnDescentList
+{
+public:
+    std::vector<NnDescentEntry> entries;
+    std::mutex lock;
+
+    // Inserts the neighbor if it is closer than the farthest one and not in the list yet
+    void insert(int id, double distance, int k, int iteration)
+    {
+        NnDescentEntry entry(id, distance, true, iteration);
+        std::lock_guard<std::mutex> guard(lock);
+        if ((int)entries.size() >= k && !(entry < entries.back()))
+            return;
+        for (const NnDescentEntry &other : entries)
+            if (other.id == id)
+                return;
+
+        entries.insert(std::upper_bound(entries.begin(), entries.end(), entry), entry);
+        if ((int)entries.size() > k)
+            entries.pop_back();
+    }
+};
+
+// Keeps at most count randomly chosen ids
+static void Sample(std::vector<int> &ids, int count, Xoshiro256 &generator)
+{
+    for (int i = 0; i < count && i < (int)ids.size(); i++)
+        std::swap(ids[i], ids[i + generator.Uniform(ids.size() - i)]);
+    if ((int)ids.size() > count)
+        ids.resize(count);
+}
+
+template <typename T, typename Distance>
+std::vector<std::vector<Neighbor>> NnDescentKnnGraph(const Dataset<T> &images, int k, double sampleRate, double delta, int maxIterations)
+{
+    const int n = images.size();
+    k = std::min(k, n - 1);
+    const int sampleCount = std::max(1, (int)std::ceil(sampleRate * k));
+    Distance distance;
+
+    std::vector<NnDescentList> lists(n);
+    // The images are spread over the threads of the default pool. Every step of an image draws from its own stream,
+    // step 0 is the random start and an iteration has two steps, so the draws do not depend on the threads
+    ThreadPool &threads = ThreadPool::Default();
+    auto generator = [n](int step, int i)
+    { return RandomStream(NnDescentStreams + (uint64_t)step * n + i); };
+
+    // Every image starts with k random neighbors
+    threads.ParallelFor(n, [&](int i, int)
+                        {
+                            Xoshiro256 random = generator(0, i);
+                            while ((int)lists[i].entries.size() < k)
+                            {
+                                int j = random.Uniform(n);
+                                if (j != i)
+                                    lists[i].insert(j, distance(images[i], images[j]), k, -1);
+                            } });
+
+    std::vector<std::vector<int>> newNeighbors(n), oldNeighbors(n), reverseNew(n), reverseOld(n);
+    std::vector<long> updates(threads.size());
+
+    for (int iteration = 0; iteration < maxIterations; iteration++)
+    {
+        // Split every list in old neighbors and a sample of the new ones. The sampled ones will have been joined
+        // by the end of this iteration, so they are old from now on
+        threads.ParallelFor(n, [&](int i, int)
+                            {
+                                Xoshiro256 random = generator(2 * iteration + 1, i);
+                                newNeighbors[i].clear();
+                                oldNeighbors[i].clear();
+                                for (const NnDescentEntry &entry : lists[i].entries)
+                                    (entry.isNew ? newNeighbors[i] : oldNeighbors[i]).push_back(entry.id);
+                                Sample(newNeighbors[i], sampleCount, random);
+                                for (NnDescentEntry &entry : lists[i].entries)
+                                    if (std::find(newNeighbors[i].begin(), newNeighbors[i].end(), entry.id) != newNeighbors[i].end())
+                                        entry.isNew = false; });
+
+        // The reverse neighbors: j is a reverse neighbor of i if i is in the list of j
+        for (int i = 0; i < n; i++)
+        {
+            reverseNew[i].clear();
+            reverseOld[i].clear();
+        }
+        for (int i = 0; i < n; i++)
+        {
+            for (int j : newNeighbors[i])
+                reverseNew[j].push_back(i);
+            for (int j : oldNeighbors[i])
+                reverseOld[j].push_back(i);
+        }
+
+        // Local join: every pair of new neighbors and every new neighbor with every old one is a candidate edge in both directions
+        threads.ParallelFor(n, [&](int i, int)
+                            {
+                                Xoshiro256 random = generator(2 * iteration + 2, i);
+                                std::vector<int> joinNew = newNeighbors[i], joinOld = oldNeighbors[i];
+                                std::vector<int> sampledNew = reverseNew[i], sampledOld = reverseOld[i];
+                                Sample(sampledNew, sampleCount, random);
+                                Sample(sampledOld, sampleCount, random);
+                                joinNew.insert(joinNew.end(), sampledNew.begin(), sampledNew.end());
+                                joinOld.insert(joinOld.end(), sampledOld.begin(), sampledOld.end());
+                                std::sort(joinNew.begin(), joinNew.end());
+                                joinNew.erase(std::unique(joinNew.begin(), joinNew.end()), joinNew.end());
+                                std::sort(joinOld.begin(), joinOld.end());
+                                joinOld.erase(std::unique(joinOld.begin(), joinOld.end()), joinOld.end());
+
+                                for (std::size_t a = 0; a < joinNew.size(); a++)
+                                {
+                                    int u = joinNew[a];
+                                    for (std::size_t b = a + 1; b < joinNew.size(); b++)
+                                    {
+                                        int v = joinNew[b];
+                                        double d = distance(images[u], images[v]);
+                                        lists[u].insert(v, d, k, iteration);
+                                        lists[v].insert(u, d, k, iteration);
+                                    }
+                                    for (int v : joinOld)
+                                    {
+                                        if (u == v)
+                                            continue;
+                                        double d = distance(images[u], images[v]);
+                                        lists[u].insert(v, d, k, iteration);
+                                        lists[v].insert(u, d, k, iteration);
+                                    }
+                                } });
+
+        // The updates are the entries this iteration inserted that are still in the lists, unlike the insertions
+        // they do not depend on the order of the joins
+        std::fill(updates.begin(), updates.end(), 0);
+        threads.ParallelFor(n, [&](int i, int thread)
+                            {
+                                for (const NnDescentEntry &entry : lists[i].entries)
+                                    updates[thread] += entry.iteration == iteration; });
+        long total = 0;
+        for (long count : updates)
+            total += count;
+        if (total < delta * n * k)
+            break;
+    }
+
+    std::vector<std::vector<Neighbor>> graph(n);
+    for (int i = 0; i < n; i++)
+        for (const NnDescentEntry &entry : lists[i].entries)
+            graph[i].push_back(Neighbor(entry.id, entry.distance));
+    return graph;
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<uint8_t, EuclideanDistance>(const Dataset<uint8_t> &, int, double, double, int);
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<float, EuclideanDistance>(const Dataset<float> &, int, double, double, int);
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<double, EuclideanDistance>(const Dataset<double> &, int, double, double, int);
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<uint8_t, ManhattanDistance>(const Dataset<uint8_t> &, int, double, double, int);
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<float, ManhattanDistance>(const Dataset<float> &, int, double, double, int);
+template std::vector<std::vector<Neighbor>> NnDescentKnnGraph<double, ManhattanDistance>(const Dataset<double> &, int, double, double, int);
@@ -1,159 +1,204 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <set>
 
 #include "Mrng.hpp"
 #include "Utils.hpp"
 #include "BruteForce.hpp"
-
-class ThreadData
-{
-public:
-    int id;
-    std::vector<std::vector<ImagePtr>> &graph;
-    const std::vector<ImagePtr> &images;
-    int startIdx;
-    int endIdx;
-    ImageDistance *distHelper;
-    std::vector<double> &sum;
-
-    ThreadData(int id, std::vector<std::vector<ImagePtr>> &graph, const std::vector<ImagePtr> &images, int startIdx, int endIdx,
-               ImageDistance *distHelper, std::vector<double> &sum)
-        : id(id), graph(graph), images(images), startIdx(startIdx), endIdx(endIdx), distHelper(distHelper), sum(sum) {}
-};
-
-void *ThreadFunction(void *threadData)
+#include "KnnGraph.hpp"
+
+// Chooses the Mrng edges of image p among its candidates, which must be sorted by their distance to p.
+// A candidate r becomes a neighbor unless pr is the longest edge of the triangle prt for a neighbor t that
+// was already chosen. The distances to p are the ones cached in the candidates, only rt is computed.
+// At most maxDegree neighbors are kept
+template <typename T, typename Distance>
+static std::vector<Neighbor> Prune(const Dataset<T> &images, int p, const std::vector<Neighbor> &candidates, int maxDegree, const Distance &distHelper)
 {
-    ThreadData *data = static_cast<ThreadData *>(threadData);
-
-    int dim = data->images[0]->pixels.size();
-    data->sum.resize(dim);
-
-    for (int i = data->startIdx; i <= data->endIdx; i++)
+    std::vector<Neighbor> Lp;
+    for (const Neighbor &r : candidates)
     {
-        std::vector<Neighbor> Rp = BruteForce(data->images, data->images[i], data->images.size());
-        Rp.erase(Rp.begin());
-
-        // Compute the sum in all dimensions of image
-        for (int d = 0; d < dim; d++)
-        {
-            data->sum[d] += data->images[i]->pixels[d];
-        }
-
-        std::vector<ImagePtr> Lp;
-        double minDistance = Rp[0].distance;
-        for (int j = 0; j < (int)Rp.size(); j++)
-        {
-            if (Rp[j].distance > minDistance)
-            {
-                break; // No more points with the minimum distance to add
-            }
-            Lp.push_back(Rp[j].image);
-        }
+        if ((int)Lp.size() >= maxDegree)
+            break;
+        if (r.id == p)
+            continue;
 
-        // For each element of Rp check the Mrng condition and add it to Lp
-        for (int r = 0; r < (int)Rp.size(); r++)
+        // Mrng condition to ensure monotonic path
+        bool condition = true;
+        for (const Neighbor &t : Lp)
         {
-            if (std::find(Lp.begin(), Lp.end(), Rp[r].image) != Lp.end())
-            {
-                continue; // Point already in Lp
-            }
-
-            // Mrng condition to ensure monotonic path
-            bool condition = true;
-            for (int t = 0; t < (int)Lp.size(); t++)
+            if (t.id == r.id)
             {
-                double prDistance = Rp[r].distance; // same as dist(images[i], Rp[r].image)
-                double ptDistance = data->distHelper->calculate(data->images[i], Lp[t]);
-                double rtDistance = data->distHelper->calculate(Rp[r].image, Lp[t]);
-
-                // Check if pr is the longest edge in the triangle prt
-                if (prDistance > rtDistance && prDistance > ptDistance)
-                {
-                    // pr is the longest edge, so it is not a valid neighbor for Mrng
-                    condition = false;
-                    break;
-                }
+                condition = false; // Point already in Lp
+                break;
             }
+            double prDistance = r.distance; // same as dist(images[p], images[r.id])
+            double ptDistance = t.distance; // same as dist(images[p], images[t.id])
 
-            if (condition)
+            // Check if pr is the longest edge in the triangle prt, the distance rt is only needed when pr is longer than pt
+            if (prDistance > ptDistance && prDistance > distHelper(images[r.id], images[t.id]))
             {
-                Lp.push_back(Rp[r].image);
+                // pr is the longest edge, so it is not a valid neighbor for Mrng
+                condition = false;
+                break;
             }
         }
 
-        data->graph[i] = Lp; // Add neighbors of current image to graph
+        if (condition)
+            Lp.push_back(r);
     }
-
-    delete data;
-    pthread_exit(nullptr);
+    return Lp;
 }
 
-Mrng::Mrng(const std::vector<ImagePtr> &images, int numNn, int l) : numNn(numNn), candidates(l),
-                                                                    distHelper(ImageDistance::getInstance()), navNode(nullptr)
+template <typename T, typename Distance>
+Mrng<T, Distance>::Mrng(const Dataset<T> &images, int numNn, int l, int poolSize, int maxDegree, KnnGraphMethod init)
+    : numNn(numNn), candidates(l), images(images), navNode(-1), searcher(images), quantizer(nullptr), rerank(0)
 {
     // startClock();
 
-    graph.resize(images.size());
-
-    const int numThreads = 4;
-    std::vector<std::vector<double>> sums(numThreads);
-    std::vector<pthread_t> threads(numThreads);
-    int imagesPerThread = images.size() / numThreads;
-    int remainingImages = images.size() % numThreads;
+    // calculate mean, the centroid has real coordinates so it is compared to the images through the float path
+    int dim = images.dimension();
+    std::vector<double> totalSum(dim);
+    for (int i = 0; i < (int)images.size(); i++)
+        for (int d = 0; d < dim; d++)
+            totalSum[d] += images[i].pixels[d];
 
-    for (int i = 0; i < numThreads; i++)
+    std::vector<float> meanPixels(dim);
+    for (int i = 0; i < dim; i++)
     {
-        int startIdx = i * imagesPerThread;
+        meanPixels[i] = totalSum[i] / (double)images.size();
+    }
 
-        bool addRemaining = startIdx + 2 * imagesPerThread > (int)images.size();
+    ImageView<float> centroid(-1, dim, meanPixels.data()); // use dummy id
 
-        int endIdx = startIdx + imagesPerThread - 1 + (addRemaining ? remainingImages : 0);
+    // Find the closest image from dataset to centroid with brute force
+    std::vector<Neighbor> closest = BruteForce(images, centroid, 1, distHelper);
+
+    navNode = closest[0].id;
+
+    // The candidate neighbors of every image come from its poolSize approximate nearest neighbors instead of the whole
+    // dataset, they come sorted and with their distances, which are reused by the pruning.
+    // Until the Mrng edges are chosen the search runs on the kNN graph
+    std::vector<std::vector<Neighbor>> pool = KnnGraph<T, Distance>(images, poolSize, init);
+
+    std::vector<std::vector<int>> lists(images.size());
+    for (int i = 0; i < (int)images.size(); i++)
+        for (const Neighbor &neighbor : pool[i])
+            lists[i].push_back(neighbor.id);
+
+    // An exact kNN graph splits into one component per cluster of images, the search could not leave the one of the navigating node
+    Connect(lists);
+
+    // Chooses the edges of every image. As in NSG, the candidates of an image are its approximate nearest neighbors
+    // together with the images expanded while searching for it from the navigating node on the kNN graph.
+    // The second ones give the long edges that lead the search from the navigating node to the right region, so all of
+    // them are kept and not only the closest. That search keeps as many candidates as the pool size.
+    // The cost of an image varies a lot, so the images are spread over the threads with work stealing
+    std::vector<std::vector<Neighbor>> edges(images.size());
+    ThreadPool &threads = ThreadPool::Default();
+    std::vector<BeamSearch<T, Distance>> searchers(threads.size(), BeamSearch<T, Distance>(images));
+    std::vector<std::vector<Neighbor>> expanded(threads.size());
+    std::vector<int> entries(1, navNode);
+
+    threads.ParallelFor(images.size(), [&](std::size_t i, int thread)
+                        {
+                            std::vector<Neighbor> candidates = pool[i];
+                            expanded[thread].clear();
+                            searchers[thread].Search(lists, images[i], entries, 0, std::max<int>(pool[i].size(), 1), &expanded[thread]);
+                            for (const Neighbor &visited : expanded[thread])
+                            {
+                                bool exists = false;
+                                for (const Neighbor &c : pool[i])
+                                    exists = exists || c.id == visited.id;
+                                if (!exists)
+                                    candidates.push_back(visited);
+                            }
+                            std::sort(candidates.begin(), candidates.end(), CompareNeighbor());
+
+                            edges[i] = Prune(images, i, candidates, maxDegree, distHelper); });
+    pool.clear();
+
+    // Every edge pr is also offered to r as a candidate, as in NSG. The distance is the one of pr, so it is not computed
+    // again, and r is pruned again only if it now has more than maxDegree candidates
+    std::vector<std::vector<Neighbor>> reverse(images.size());
+    for (int p = 0; p < (int)images.size(); p++)
+        for (const Neighbor &r : edges[p])
+            reverse[r.id].push_back(Neighbor(p, r.distance));
+
+    // Every image only changes its own list, so the images are merged and pruned again on the threads like above
+    threads.ParallelFor(images.size(), [&](std::size_t r, int)
+                        {
+                            std::vector<Neighbor> &Lr = edges[r];
+                            for (const Neighbor &p : reverse[r])
+                            {
+                                bool exists = false;
+                                for (const Neighbor &t : Lr)
+                                    exists = exists || t.id == p.id;
+                                if (!exists)
+                                    Lr.push_back(p);
+                            }
+                            reverse[r].clear();
+                            if ((int)Lr.size() > maxDegree)
+                            {
+                                std::sort(Lr.begin(), Lr.end(), CompareNeighbor());
+                                Lr = Prune(images, r, Lr, maxDegree, distHelper);
+                            } });
+
+    for (int i = 0; i < (int)images.size(); i++)
+    {
+        lists[i].clear();
+        for (const Neighbor &neighbor : edges[i])
+            lists[i].push_back(neighbor.id);
+    }
+    edges.clear();
 
-        ThreadData *threadData = new ThreadData(i, graph, images, startIdx, endIdx, distHelper, sums[i]);
+    Connect(lists);
 
-        if (pthread_create(&threads[i], NULL, ThreadFunction, threadData))
-        {
-            std::cerr << "Error creating thread " << i << std::endl;
-            return;
-        }
-    }
+    // The graph does not change after this point, so it is frozen in CSR form
+    graph = Adjacency(lists);
 
-    for (int i = 0; i < numThreads; i++)
-    {
-        pthread_join(threads[i], NULL);
-    }
+    // auto mrngDuration = stopClock();
+    // std::cout << "Mrng index construction finished in: " << mrngDuration.count() * 1e-9 << std::endl;
+}
+
+// Makes every image reachable from the navigating node. An image that the edges do not reach gets an edge from the
+// closest image the search finds for it, which is reachable by construction. The graph is built as lists and frozen afterwards
+template <typename T, typename Distance>
+void Mrng<T, Distance>::Connect(std::vector<std::vector<int>> &lists)
+{
+    std::vector<bool> reached(images.size(), false);
+    std::vector<int> stack;
 
-    int dim = images[0]->pixels.size();
-    std::vector<double> totalSum;
-    totalSum.resize(dim);
+    reached[navNode] = true;
+    stack.push_back(navNode);
 
-    for (int i = 0; i < numThreads; i++)
+    for (int next = 0; next <= (int)images.size(); next++)
     {
-        for (int j = 0; j < dim; j++)
+        // Mark everything reachable from the images in the stack
+        while (!stack.empty())
         {
-            totalSum[j] += sums[i][j];
+            int p = stack.back();
+            stack.pop_back();
+            for (int r : lists[p])
+                if (!reached[r])
+                {
+                    reached[r] = true;
+                    stack.push_back(r);
+                }
         }
-    }
-
-    // calculate mean
-    std::vector<double> meanPixels(dim);
-    for (int i = 0; i < dim; i++)
-    {
-        meanPixels[i] = totalSum[i] / (double)images.size();
-    }
-
-    Image centroid(0, meanPixels); // use dummy id
-
-    // Find the closest image from dataset to centroid with brute force
-    std::vector<Neighbor> closest = BruteForce(images, &centroid, 1);
 
-    navNode = images[closest[0].image->id];
+        // Find the next image that is not reached yet and link it to the graph
+        while (next < (int)images.size() && reached[next])
+            next++;
+        if (next == (int)images.size())
+            break;
 
-    // auto mrngDuration = stopClock();
-    // std::cout << "Mrng index construction finished in: " << mrngDuration.count() * 1e-9 << std::endl;
+        std::vector<Neighbor> closest = searcher.Search(lists, images[next], std::vector<int>(1, navNode), 1, candidates);
+        lists[closest[0].id].push_back(next);
+        reached[next] = true;
+        stack.push_back(next);
+    }
 }
+
 // Mrng::Mrng(const std::vector<ImagePtr> &images, int numNn, int l)
 //     : numNn(numNn), candidates(l), distHelper(ImageDistance::getInstance()), navNode(nullptr)
 // {
@@ -200,8 +245,8 @@ Mrng::Mrng(const std::vector<ImagePtr> &images, int numNn, int l) : numNn(numNn)
 //             for (int t = 0; t < (int)Lp.size(); t++)
 //             {
 //                 double prDistance = Rp[r].distance;                          // same as dist(images[i], Rp[r])
-//                 double ptDistance = distHelper->calculate(images[i], Lp[t]); // same as dist(images[i], Lp[t])
-//                 double rtDistance = distHelper->calculate(Rp[r].image, Lp[t]);
+//                 double ptDistance = distHelper(images[i], Lp[t]); // same as dist(images[i], Lp[t])
+//                 double rtDistance = distHelper(Rp[r].image, Lp[t]);
 
 //                 // prDistance is always greater than ptDistance = minDistance since Rp is sorted
 //                 // Need to check between prDistance and rtDistance for triangle prt
@@ -240,87 +285,82 @@ Mrng::Mrng(const std::vector<ImagePtr> &images, int numNn, int l) : numNn(numNn)
 //     std::cout << "Mrng index construction finished in: " << mrngDuration.count() * 1e-9 << std::endl;
 // }
 
-Mrng::~Mrng() {}
-
-class NeighborInSet
+// Takes a graph and a navigating node that are already built
+template <typename T, typename Distance>
+Mrng<T, Distance>::Mrng(const Dataset<T> &images, Adjacency &&graph, int navNode, int numNn, int l)
+    : numNn(numNn), candidates(l), images(images), navNode(navNode), graph(std::move(graph)), searcher(images), quantizer(nullptr), rerank(0)
 {
-public:
-    Neighbor neighbor;
-    bool checked;
-
-    NeighborInSet(ImagePtr image, double distance, bool checked) : neighbor(image, distance), checked(checked) {}
-};
-
-class CompareNeighborInSet
-{
-public:
-    bool operator()(const NeighborInSet &a, const NeighborInSet &b) const
+    if (navNode < 0 || navNode >= (int)images.size())
     {
-        // Compare based on the double value (distance) within Neighbor objects.
-        return a.neighbor.distance < b.neighbor.distance;
+        std::cerr << "The graph has no valid navigating node." << std::endl;
+        exit(EXIT_FAILURE);
     }
-};
+}
+
+template <typename T, typename Distance>
+Mrng<T, Distance>::~Mrng() {}
 
-std::vector<Neighbor> Mrng::Approximate_kNN(ImagePtr query)
+template <typename T, typename Distance>
+void Mrng<T, Distance>::save(const std::string &path) const
 {
-    // Initialize R to an empty set
-    std::set<NeighborInSet, CompareNeighborInSet> R;
+    GraphFileHeader header(GraphKind::MRNG, Distance::name(), images.size(), images.dimension(), navNode);
+    WriteGraphFile(path, header, graph);
+}
 
-    // Start with the navigating node
-    NeighborInSet p = NeighborInSet(navNode, distHelper->calculate(navNode, query), false);
-    R.insert(p);
+template <typename T, typename Distance>
+Mrng<T, Distance> *Mrng<T, Distance>::load(const Dataset<T> &images, const std::string &path, int numNn, int l, bool verify)
+{
+    std::shared_ptr<GraphFile> file = std::make_shared<GraphFile>(path, GraphFileHeader(GraphKind::MRNG, Distance::name(), images.size(), images.dimension(), -1));
+    // The neighbors are read from the mapped file, it stays mapped as long as the graph uses it
+    return new Mrng(images, file->adjacency(verify), file->GetHeader().navNode, numNn, l);
+}
 
-    int i = 1;
-    int visitedNodes = 0;
+template <typename T, typename Distance>
+std::vector<Neighbor> Mrng<T, Distance>::Approximate_kNN(const ImageView<T> &query) { return Search(searcher, query, std::vector<int>(1, navNode)); }
 
-    // Search for the number of candidates
-    while (i < candidates && (int)R.size() > visitedNodes)
+template <typename T, typename Distance>
+void Mrng<T, Distance>::UseQuantizer(const ProductQuantizer *quantizer, int rerank)
+{
+    if (quantizer && quantizer->size() != images.size())
     {
-        // Each time get the first unchecked node of R
-        for (auto it = R.begin(); it != R.end(); ++it)
-        {
-            if (!it->checked)
-            {
-                // Erase the existing NeighborInSet and insert the updated one
-                R.erase(it);
-
-                // Mark the element as checked
-                NeighborInSet updatedNeighborInSet = *it;
-                updatedNeighborInSet.checked = true;
-
-                R.insert(updatedNeighborInSet);
-
-                p = *it; // update p
-                break;
-            }
-        }
-
-        visitedNodes++;
-
-        // Get neighbors of p based on the graph
-        std::vector<ImagePtr> neighborImages = graph[p.neighbor.image->id];
-        for (int k = 0; k < (int)neighborImages.size(); k++)
-        {
-            NeighborInSet element = NeighborInSet(neighborImages[k], distHelper->calculate(neighborImages[k], query), false);
-            auto result = R.insert(element);
-            if (result.second) // insert succeeded
-            {
-                i++;
-            }
-        }
+        std::cerr << "Mrng: the quantizer encodes " << quantizer->size() << " images instead of " << images.size() << std::endl;
+        exit(EXIT_FAILURE);
     }
-    std::vector<Neighbor> KnearestNeighbors;
+    this->quantizer = quantizer;
+    this->rerank = rerank;
+}
 
-    // Iterate R and extract Neighbor objects
-    for (const auto &NeighborInSet : R)
-    {
-        if ((int)KnearestNeighbors.size() >= numNn)
-        {
-            break;
-        }
+// Search on graph from the navigating node with a pool of candidates images. With a quantizer the pool is ranked by
+// the distances of the codes and holds at least the rerank images that are ranked again with their exact distances
+template <typename T, typename Distance>
+std::vector<Neighbor> Mrng<T, Distance>::Search(BeamSearch<T, Distance> &searcher, const ImageView<T> &query, const std::vector<int> &entries) const
+{
+    if (!quantizer)
+        return searcher.Search(graph, query, entries, numNn, candidates);
+
+    std::vector<float> table;
+    quantizer->Table<Distance>(query.pixels, table);
+    int keep = std::max(numNn, rerank);
+    std::vector<Neighbor> nearest = searcher.SearchBy(graph, [&](int id)
+                                                      { return quantizer->Adc(table.data(), id); }, entries, keep, std::max(candidates, keep));
+    return Rerank(images, query, nearest, numNn, distHelper);
+}
 
-        KnearestNeighbors.push_back(NeighborInSet.neighbor);
-    }
+template <typename T, typename Distance>
+void Mrng<T, Distance>::SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool)
+{
+    std::vector<BeamSearch<T, Distance>> searchers(pool.size(), BeamSearch<T, Distance>(images));
+    std::vector<int> entries(1, navNode);
+
+    results.resize(queries.size());
+    pool.ParallelFor(queries.size(), [&](std::size_t q, int thread)
+                     { results[q] = Search(searchers[thread], queries[q], entries); });
+}
 
-    return KnearestNeighbors;
-}
\ No newline at end of file
+// Explicit instantiations for the supported pixel types and metrics
+template class Mrng<uint8_t, EuclideanDistance>;
+template class Mrng<float, EuclideanDistance>;
+template class Mrng<double, EuclideanDistance>;
+template class Mrng<uint8_t, ManhattanDistance>;
+template class Mrng<float, ManhattanDistance>;
+template class Mrng<double, ManhattanDistance>;
\ No newline at end of file
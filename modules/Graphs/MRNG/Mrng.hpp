@@ -2,21 +2,60 @@
 #include <vector>
 
 #include "PublicTypes.hpp"
+#include "Dataset.hpp"
 #include "ImageDistance.hpp"
 #include "GraphAlgorithm.hpp"
-#include "Lsh.hpp"
+#include "KnnGraph.hpp"
+#include "Adjacency.hpp"
+#include "GraphFile.hpp"
+#include "BeamSearch.hpp"
 
-class Mrng : public GraphAlgorithm
+/**
+ * @brief The class of a Mrng consists of the following
+ *
+ * @param numNn the number of nearest neighbors needed
+ * @param candidates the number of candidates of the search on graph
+ * @param images the input dataset, the graph stores the ids of the neighbors of every image
+ * @param navNode the image closest to the centroid of the dataset, every search starts there
+ * @param graph the Mrng edges. Every image keeps at most maxDegree of its candidates, chosen with the Mrng condition,
+ * plus the reverse edges and the ones that keep every image reachable from navNode. The candidates are the poolSize
+ * approximate nearest neighbors and the images the search for it expands on the kNN graph. It is stored in CSR form
+ * @param searcher the beam search of the queries, with a pool of candidates images
+ * @param quantizer the codes of the images the search walks the graph with, nullptr walks it with the exact distances
+ * @param rerank the number of images nearest by their codes that are ranked again with their exact distances
+ *
+ * @method Approximate_kNN returns a vector with numNn aproxximate nearest neighbors
+ * @method SearchBatch answers many queries in parallel, every thread has its own beam search
+ * @method UseQuantizer walks the graph of the next queries with the codes of quantizer, see GraphAlgorithm
+ * @method memoryUsage bytes of the graph, without the images
+ * @method save writes the graph and the navigating node to a graph file
+ * @method load creates a Mrng from a graph file that was saved for the same images and metric, without building it.
+ * With verify the lists are checked more thoroughly, see GraphFile::adjacency
+ */
+template <typename T, typename Distance>
+class Mrng : public GraphAlgorithm<T>
 {
 private:
     int numNn;
     int candidates;
-    ImageDistance *distHelper;
-    ImagePtr navNode;
-    std::vector<std::vector<ImagePtr>> graph;
+    const Dataset<T> &images;
+    Distance distHelper;
+    int navNode;
+    Adjacency graph;
+    BeamSearch<T, Distance> searcher;
+    const ProductQuantizer *quantizer;
+    int rerank;
+    void Connect(std::vector<std::vector<int>> &lists);
+    Mrng(const Dataset<T> &images, Adjacency &&graph, int navNode, int numNn, int l);
+    std::vector<Neighbor> Search(BeamSearch<T, Distance> &searcher, const ImageView<T> &query, const std::vector<int> &entries) const;
 
 public:
-    Mrng(const std::vector<ImagePtr> &images, int numNn, int l);
+    Mrng(const Dataset<T> &images, int numNn, int l, int poolSize, int maxDegree, KnnGraphMethod init = KnnGraphMethod::NN_DESCENT);
     ~Mrng();
-    std::vector<Neighbor> Approximate_kNN(ImagePtr query);
+    std::vector<Neighbor> Approximate_kNN(const ImageView<T> &query);
+    void SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool);
+    void save(const std::string &path) const;
+    std::size_t memoryUsage() const { return graph.memoryUsage(); }
+    void UseQuantizer(const ProductQuantizer *quantizer, int rerank);
+    static Mrng *load(const Dataset<T> &images, const std::string &path, int numNn, int l, bool verify = false);
 };
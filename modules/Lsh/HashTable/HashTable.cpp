@@ -1,6 +1,5 @@
+#include <iostream>
 #include <vector>
-#include <unordered_map>
-#include <string>
 #include <climits>
 #include <cstdint>
 
@@ -10,8 +9,8 @@
 // That's the number from the slides
 static const int64_t M = ((int64_t)(1) << 32) - 5;
 
-// The constructor of the amplified function g_i
-AmpLsh::AmpLsh(int w, int numHashFuncs, int dimension)
+// The constructor of the amplified function g_i, its h_i functions are added to the projection matrix
+AmpLsh::AmpLsh(int w, int numHashFuncs, ProjectionMatrix &projections) : first(projections.size())
 {
     // We are using num hash functions h_i
     for (int i = 0; i < numHashFuncs; i++)
@@ -21,41 +20,83 @@ AmpLsh::AmpLsh(int w, int numHashFuncs, int dimension)
 
         // But we are also creating different v vector for each hash_function
         std::vector<double> v;
-        for (int j = 0; j < dimension; j++)
+        for (std::size_t j = 0; j < projections.dimension(); j++)
             v.push_back(NormalDistribution(0.0, 1.0));
         // The RealDistribution is the t (shift)
-        hash_functions.push_back(HashFunction(w, RealDistribution(0, w), v));
+        projections.AddFunction(v, RealDistribution(0, w));
     }
 }
 AmpLsh::~AmpLsh() {}
 
-// Utilizes the respective hash_functions with r to get the sum of their multiplications. Then we take the modulo of it with M.
-int AmpLsh::hash(ImagePtr image)
+// Combines the values of its hash_functions with r to get the sum of their multiplications. Then we take the modulo of it with M.
+uint32_t AmpLsh::hash(const uint64_t *hashes) const
 {
     uint64_t hashval = 0;
-    for (int i = 0, num_hashes = hash_functions.size(); i < num_hashes; i++)
-        hashval += r[i] * hash_functions[i].hash(image);
+    for (int i = 0, num_hashes = r.size(); i < num_hashes; i++)
+        hashval += r[i] * hashes[first + i];
     return Modulo(hashval, M);
 }
 
+std::size_t AmpLsh::memoryUsage() const { return r.capacity() * sizeof(int); }
 // We are making a HashTable object with numBuckets empty buckets
-HashTable::HashTable(int numBuckets, const AmpLsh &hash) : numBuckets(numBuckets), hashmap(hash)
+HashTable::HashTable(int numBuckets, const AmpLsh &hash) : numBuckets(numBuckets), hashmap(hash) {}
+
+HashTable::~HashTable() {}
+
+// The images are only kept with their ID(p) until the table is frozen, the bucket follows from it
+void HashTable::insert(int id, const uint64_t *hashes)
 {
-    buckets.resize(numBuckets);
-    for (int i = 0; i < numBuckets; i++)
+    if (!offsets.empty())
     {
-        std::vector<ImagePtr> new_bucket;
-        buckets[i] = new_bucket;
+        std::cerr << "HashTable: an image was inserted after the table was frozen" << std::endl;
+        exit(EXIT_FAILURE);
     }
+    pendingIds.push_back(id);
+    pendingKeys.push_back(hashmap.hash(hashes));
 }
 
-HashTable::~HashTable() {}
+// A counting sort of the inserted images by bucket, as were showed in slides the bucket is ID(p) mod table_size.
+// The sort is stable, so the images of a bucket stay in the order they were inserted
+void HashTable::freeze()
+{
+    offsets.assign(numBuckets + 1, 0);
+    for (uint32_t key : pendingKeys)
+        offsets[Modulo(key, numBuckets) + 1]++;
+    for (uint32_t b = 0; b < numBuckets; b++)
+        offsets[b + 1] += offsets[b];
+
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    ids.resize(pendingIds.size());
+    keys.resize(pendingKeys.size());
+    for (std::size_t j = 0; j < pendingIds.size(); j++)
+    {
+        uint32_t position = next[Modulo(pendingKeys[j], numBuckets)]++;
+        ids[position] = pendingIds[j];
+        keys[position] = pendingKeys[j];
+    }
+
+    // The inserted images are not needed anymore
+    std::vector<uint32_t>().swap(pendingIds);
+    std::vector<uint32_t>().swap(pendingKeys);
+}
 
-// To insert the image we are using the hash with mod table_size as were showed in slides
-void HashTable::insert(ImagePtr image)
+BucketView HashTable::get_bucket(uint32_t key) const
 {
-    buckets.at(Modulo(hashmap.hash(image), numBuckets)).push_back(image);
+    if (offsets.empty())
+    {
+        std::cerr << "HashTable: the table was searched before it was frozen" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    uint32_t b = Modulo(key, numBuckets);
+    BucketView bucket;
+    bucket.ids = ids.data() + offsets[b];
+    bucket.keys = keys.data() + offsets[b];
+    bucket.count = offsets[b + 1] - offsets[b];
+    return bucket;
 }
 
-// Returns the bucket of the given image with the formula used to insert the image
-std::vector<ImagePtr> HashTable::get_bucket(ImagePtr image) { return buckets.at(Modulo(hashmap.hash(image), numBuckets)); }
+std::size_t HashTable::memoryUsage() const
+{
+    return (offsets.capacity() + ids.capacity() + keys.capacity() + pendingIds.capacity() + pendingKeys.capacity()) * sizeof(uint32_t) +
+           hashmap.memoryUsage();
+}
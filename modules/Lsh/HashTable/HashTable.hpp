@@ -2,60 +2,98 @@
 #define HASHTABLE_HPP_
 
 #include <vector>
-#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
 
 #include "Image.hpp"
-#include "HashFunction.hpp"
+#include "ProjectionMatrix.hpp"
 #include "PublicTypes.hpp"
 
 /**
  * @brief The class of a amplified lsh function (g_i) consists of the following
  *
  * @param r the random vector
- * @param hash_functions all the hash_functions h_i that are used
+ * @param first the first of its h_i functions in the projection matrix of the lsh, the others follow it
  *
- * @method hash utilizies the h_i functions and a combination of the r vector to insert an image
+ * @method hash combines the values of the h_i functions with the r vector, the ID(p) of the slides in [0, M)
+ * @method memoryUsage bytes of r, the h_i functions are counted with their matrix
  */
 class AmpLsh
 {
 private:
     std::vector<int> r;
-    std::vector<HashFunction> hash_functions;
+    int first;
 
 public:
-    AmpLsh(int w, int numHashFuncs, int dimension);
+    AmpLsh(int w, int numHashFuncs, ProjectionMatrix &projections);
     ~AmpLsh();
 
-    int hash(ImagePtr image);
+    // hashes are the values of all the functions of the projection matrix
+    uint32_t hash(const uint64_t *hashes) const;
+
+    std::size_t memoryUsage() const;
+};
+
+/**
+ * @brief The entries of one bucket of a frozen HashTable, a view into the arrays of the table that is valid as long as
+ * the table is. ids[j] is an image of the bucket and keys[j] its ID(p), the images are in the order they were inserted
+ *
+ * @method size the number of images of the bucket
+ * @method begin, end iterate over the ids, so that a bucket can be walked like a vector of ids
+ */
+class BucketView
+{
+public:
+    const uint32_t *ids;
+    const uint32_t *keys;
+    std::size_t count;
+
+    inline std::size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline const uint32_t *begin() const { return ids; }
+    inline const uint32_t *end() const { return ids + count; }
 };
 
 /**
- * @brief The class of a HashTable consists of the following
+ * @brief The class of a HashTable consists of the following. The images are inserted first, then the table is frozen
+ * into a compressed sparse row layout: the entries of bucket b are [offsets[b], offsets[b + 1]) of ids and keys
  *
  * @param numBuckets the number of buckets which will be used which is essentially 2^k since {0,1}^d'
- * @param buckets the buckets in a 2d vector form, the first vector is for the buckets and the second for the elements of each bucket
+ * @param offsets where every bucket starts in ids and keys, numBuckets + 1 of them once frozen
+ * @param ids the ids of the images of all the buckets, bucket after bucket
+ * @param keys the ID(p) of every entry of ids, a query only compares the images with its own ID(p)
+ * @param pending the ids and keys inserted since the table was created, in the order they were inserted
  * @param hashmap the amplified hash function for the hashtable
  *
- * @method insert inserts an image into the buckets according to the hash
- * @method get_bucket returns the bucket for the given image
+ * @method key the ID(p) of an image with the given values of the functions of the projection matrix
+ * @method insert adds an image with the given values of the functions of the projection matrix, before freeze
+ * @method freeze moves the inserted images into the buckets, the table can only be searched after it
+ * @method get_bucket returns a view of the bucket of an ID(p)
+ * @method memoryUsage bytes of the buckets and of the amplified hash function
  */
-template <typename T>
-using Bucket = std::vector<T>;
-
 class HashTable
 {
 private:
-    int numBuckets;
-    std::vector<Bucket<ImagePtr>> buckets;
+    uint32_t numBuckets;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> ids;
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> pendingIds;
+    std::vector<uint32_t> pendingKeys;
     AmpLsh hashmap;
 
 public:
     HashTable(int numBuckets, const AmpLsh &hashmap);
     ~HashTable();
 
-    void insert(ImagePtr image);
+    inline uint32_t key(const uint64_t *hashes) const { return hashmap.hash(hashes); }
+
+    void insert(int id, const uint64_t *hashes);
+    void freeze();
+
+    BucketView get_bucket(uint32_t key) const;
 
-    std::vector<ImagePtr> get_bucket(ImagePtr image);
+    std::size_t memoryUsage() const;
 };
 
 #endif
\ No newline at end of file
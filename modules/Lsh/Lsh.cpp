@@ -3,88 +3,202 @@
 #include <queue>
 #include <set>
 #include <unordered_set>
+#include <algorithm>
+#include <limits>
 
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "Utils.hpp"
 #include "HashTable.hpp"
+#include "MultiProbe.hpp"
 #include "Lsh.hpp"
 #include "PublicTypes.hpp"
 #include "ImageDistance.hpp"
+#include "BruteForce.hpp"
 
 // Constructor for lsh object, uses initialization list
-Lsh::Lsh(const std::vector<ImagePtr> &images, int numHashFuncs, int numHtables, int numNn, int w, int numBuckets)
-    : numHashFuncs(numHashFuncs), numHtables(numHtables), numNn(numNn), w(w), numBuckets(numBuckets)
+template <typename T, typename Distance>
+Lsh<T, Distance>::Lsh(const Dataset<T> &images, int numHashFuncs, int numHtables, int numNn, int w, int numBuckets, int probes)
+    : numHashFuncs(numHashFuncs), numHtables(numHtables), numNn(numNn), w(w), numBuckets(numBuckets), probes(probes),
+      projections(images.dimension(), w), images(images), quantizer(nullptr), rerank(0)
 {
-  // Initialize the general distance
-  this->distance = ImageDistance::getInstance();
-
-  int dimension = images.at(0)->pixels.size();
-  // We need num hash tables
+  // We need num hash tables, their functions all go to one projection matrix
   for (int i = 0; i < numHtables; i++)
+    hashtables.push_back(HashTable(numBuckets, AmpLsh(w, numHashFuncs, projections)));
+
+  // Then we initialize every table with every image. A batch of images is projected once on the functions of all
+  // the tables in parallel, then inserted in the order of the ids
+  std::vector<uint64_t> hashes;
+  for (std::size_t first = 0; first < images.size(); first += ProjectionMatrix::BatchImages)
   {
-    // we make one HashTable object and push it to the vector
-    hashtables.push_back(HashTable(numBuckets, AmpLsh(w, numHashFuncs, dimension)));
+    std::size_t count = std::min(ProjectionMatrix::BatchImages, images.size() - first);
+    projections.hashBatch(images, first, count, hashes, ThreadPool::Default());
+    for (int i = 0; i < numHtables; i++)
+      for (std::size_t j = 0; j < count; j++)
+        hashtables[i].insert(first + j, hashes.data() + j * projections.blockSize());
+  }
 
-    // Then we initialize it with every image
-    for (std::size_t j = 0; j < images.size(); j++)
-      hashtables[i].insert(images[j]);
+  // The tables are only searched from now on, so their buckets are packed
+  for (HashTable &table : hashtables)
+    table.freeze();
+}
+
+template <typename T, typename Distance>
+Lsh<T, Distance>::~Lsh() {}
+
+template <typename T, typename Distance>
+void Lsh<T, Distance>::UseQuantizer(const ProductQuantizer *quantizer, int rerank)
+{
+  if (quantizer && quantizer->size() != images.size())
+  {
+    std::cerr << "Lsh: the quantizer encodes " << quantizer->size() << " images instead of " << images.size() << std::endl;
+    exit(EXIT_FAILURE);
   }
+  this->quantizer = quantizer;
+  this->rerank = rerank;
 }
 
-Lsh::~Lsh() {}
+// The probes of a table are the buckets of its perturbation vectors. The values of the functions of the table are
+// moved in place to get the ID(p) of every probe and put back after
+template <typename T, typename Distance>
+void Lsh<T, Distance>::ProbeKeys(int table, std::vector<uint64_t> &hashes, const std::vector<double> &fractions, std::vector<uint32_t> &keys) const
+{
+  keys.clear();
+  keys.push_back(hashtables[table].key(hashes.data()));
+  if (probes == 0)
+    return;
+
+  int first = table * numHashFuncs;
+  for (const Perturbation &perturbation : Perturbations(fractions.data() + first, numHashFuncs, probes))
+  {
+    for (std::size_t j = 0; j < perturbation.functions.size(); j++)
+      hashes[first + perturbation.functions[j]] += perturbation.deltas[j];
+    keys.push_back(hashtables[table].key(hashes.data()));
+    for (std::size_t j = 0; j < perturbation.functions.size(); j++)
+      hashes[first + perturbation.functions[j]] -= perturbation.deltas[j];
+  }
+}
 
 // Returns the k approximate nearest neighbors
-std::vector<Neighbor> Lsh::Approximate_kNN(ImagePtr query)
+template <typename T, typename Distance>
+std::vector<Neighbor> Lsh<T, Distance>::Approximate_kNN(const ImageView<T> &query)
 {
-  // We are using a set to store the objects efficiently with a custom compare class
-  std::set<Neighbor, CompareNeighbor> nearestNeighbors;
+  // We are using a set to store the objects efficiently with a custom compare class, images at the same distance are
+  // told apart by their id, so only the same image found in another table is a duplicate
+  std::set<Neighbor, CompareNeighborId> nearestNeighbors;
+
+  // With a quantizer the candidates are ranked by the distances of their codes, and we keep the rerank nearest of them
+  std::vector<float> table;
+  if (quantizer)
+    quantizer->Table<Distance>(query.pixels, table);
+  int keep = quantizer ? std::max(numNn, rerank) : numNn;
+
+  // The query is projected once on the functions of all the tables
+  std::vector<uint64_t> hashes(projections.blockSize());
+  std::vector<double> fractions(projections.blockSize());
+  projections.hash(query.pixels, hashes.data(), fractions.data());
+  std::vector<uint32_t> keys;
 
   // We are searching in every hash table
   for (int i = 0; i < numHtables; i++)
   {
-    // We are getting the current bucket for the query
-    const std::vector<ImagePtr> bucket = hashtables[i].get_bucket(query);
-
-    // Iterate over all images of the bucket
-    for (ImagePtr input : bucket)
+    // We are getting the current bucket for the query and its probes
+    ProbeKeys(i, hashes, fractions, keys);
+    for (uint32_t key : keys)
     {
-      // We calculate the distance from this image to the query
-      double dist = distance->calculate(input, query);
-      // Push it to the set which will automatically check for duplicates
-      nearestNeighbors.insert(Neighbor(input, dist));
-
-      // In order to save space we only store numNn of approximate nearest neighbors
-      if ((int)nearestNeighbors.size() > numNn)
-        nearestNeighbors.erase(std::prev(nearestNeighbors.end()));
+      BucketView bucket = hashtables[i].get_bucket(key);
+
+      // Iterate over all images of the bucket
+      for (std::size_t j = 0; j < bucket.size(); j++)
+      {
+        // The images with another ID(p) only share the bucket because of the modulo, so we skip them without a distance
+        if (bucket.keys[j] != key)
+          continue;
+        int input = bucket.ids[j];
+        // We calculate the distance from this image to the query, it is dropped as soon as it is farther than all the numNn we have
+        double bound = nearestNeighbors.empty() || (int)nearestNeighbors.size() < keep ? std::numeric_limits<double>::infinity() : std::prev(nearestNeighbors.end())->distance;
+        double dist = quantizer ? quantizer->Adc(table.data(), input) : distance.distance_if_less(images[input], query, bound);
+        if (dist > bound)
+          continue;
+        // Push it to the set which will automatically check for duplicates
+        nearestNeighbors.insert(Neighbor(input, dist));
+
+        // In order to save space we only store numNn of approximate nearest neighbors
+        if ((int)nearestNeighbors.size() > keep)
+          nearestNeighbors.erase(std::prev(nearestNeighbors.end()));
+      }
     }
   }
   // Lastly we want to make a vector from those neighbors
   std::vector<Neighbor> KnearestNeighbors(nearestNeighbors.begin(), nearestNeighbors.end());
+  if (quantizer)
+    return Rerank(images, query, KnearestNeighbors, numNn, distance);
   return KnearestNeighbors;
 }
 
+// The queries only read the hash tables, so they need no state of their own
+template <typename T, typename Distance>
+void Lsh<T, Distance>::SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool)
+{
+  results.resize(queries.size());
+  pool.ParallelFor(queries.size(), [&](std::size_t q, int)
+                   { results[q] = Approximate_kNN(queries[q]); });
+}
+
 // Returns a vector with images inside the given radius
-std::vector<ImagePtr> Lsh::Approximate_Range_Search(ImagePtr query, const double radius)
+template <typename T, typename Distance>
+std::vector<int> Lsh<T, Distance>::Approximate_Range_Search(const ImageView<T> &query, const double radius)
 {
+  // The distances are rank distances, so we compare them with the radius converted once (radius² for euclidean)
+  const double rankRadius = Distance::toRank(radius);
   // We are using a set to store the objects efficiently without duplicates
-  std::set<ImagePtr> rangesearch;
+  std::set<int> rangesearch;
+  // The query is projected once on the functions of all the tables
+  std::vector<uint64_t> hashes(projections.blockSize());
+  std::vector<double> fractions(projections.blockSize());
+  projections.hash(query.pixels, hashes.data(), fractions.data());
+  std::vector<uint32_t> keys;
   // We are searching in every hash table
   for (int i = 0; i < numHtables; i++)
   {
-    // We are getting the current bucket for the query
-    const std::vector<ImagePtr> bucket = hashtables[i].get_bucket(query);
-
-    // Iterate over all images of the bucket
-    for (ImagePtr input : bucket)
+    // We are getting the current bucket for the query and its probes
+    ProbeKeys(i, hashes, fractions, keys);
+    for (uint32_t key : keys)
     {
-      // We calculate the distance from this image to the query
-      double dist = distance->calculate(input, query);
-      // If its distance is less or equal to the given radius
-      if (dist <= radius)
-        // We push it to the vector
-        rangesearch.insert(input);
+      BucketView bucket = hashtables[i].get_bucket(key);
+
+      // Iterate over all images of the bucket with the ID(p) of the bucket
+      for (std::size_t j = 0; j < bucket.size(); j++)
+      {
+        if (bucket.keys[j] != key)
+          continue;
+        int input = bucket.ids[j];
+        // We calculate the distance from this image to the query
+        double dist = distance(images[input], query);
+        // If its distance is less or equal to the given radius
+        if (dist <= rankRadius)
+          // We push it to the vector
+          rangesearch.insert(input);
+      }
     }
   }
-  std::vector<ImagePtr> RangeSearch(rangesearch.begin(), rangesearch.end());
+  std::vector<int> RangeSearch(rangesearch.begin(), rangesearch.end());
   return RangeSearch;
-}
\ No newline at end of file
+}
+
+template <typename T, typename Distance>
+std::size_t Lsh<T, Distance>::memoryUsage() const
+{
+  std::size_t bytes = projections.memoryUsage();
+  for (const HashTable &table : hashtables)
+    bytes += table.memoryUsage();
+  return bytes;
+}
+
+// Explicit instantiations for the supported pixel types and metrics
+template class Lsh<uint8_t, EuclideanDistance>;
+template class Lsh<float, EuclideanDistance>;
+template class Lsh<double, EuclideanDistance>;
+template class Lsh<uint8_t, ManhattanDistance>;
+template class Lsh<float, ManhattanDistance>;
+template class Lsh<double, ManhattanDistance>;
\ No newline at end of file
@@ -4,23 +4,37 @@
 #include <vector>
 
 #include "Image.hpp"
+#include "Dataset.hpp"
 #include "HashTable.hpp"
 #include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "ProductQuantizer.hpp"
 /**
  * @brief The class of a lsh consists of the following
  *
  * @param numHashFuncs the dimension k = d' of hypercube
  * @param numHtables the maximum number of points the algorithm will check
- * @param probes the number of probes the algorithm will check (we check the initial bucket + probes which in reality is probes + 1)
+ * @param probes the number of probes the algorithm will check in every table (we check the initial bucket + probes which in reality is probes + 1),
+ * the buckets next to the bucket of the query in the order of the perturbation vectors of the multi-probe lsh
  * @param numNn the number of nearest neighbors needed
  * @param w the window
  * @param numBuckets the number of buckets which will be used
  * @param hashtables this algorithm requires many hashtables, so we have a vector with objects HashTable which are essentially our own implementation to match our needs
- * @param distance the generic distance
+ * @param projections the h_i functions of all the hash tables, the functions of table i are k * i to k * i + k - 1
+ * @param images the dataset the ids stored in the hashtables refer to
+ * @param distance the metric functor, the Distance template parameter (EuclideanDistance or ManhattanDistance)
+ * @param quantizer the codes of the images the candidates are ranked with, nullptr ranks them with their exact distances
+ * @param rerank the number of candidates nearest by their codes that are ranked again with their exact distances
  *
+ * @method ProbeKeys the ID(p) of the bucket of the query in a table followed by the ID(p) of its probes
+ * @method UseQuantizer ranks the candidates of the next queries with the codes of quantizer, which encodes the same images, and
+ * the rerank nearest of them with their exact distances. nullptr goes back to the exact distances
  * @method Approximate_kNN returns a vector with numNn aproxximate nearest neighbors
+ * @method SearchBatch answers many queries in parallel on the threads of the pool, results[q] are the neighbors of queries[q]
  * @method Approximate_Range_Search returns a vector with points inside the given radius
+ * @method memoryUsage bytes of the hash tables, without the images
  */
+template <typename T, typename Distance>
 class Lsh
 {
 private:
@@ -29,14 +43,24 @@ private:
     int numNn;                         // -Ν number of Nearest Neighbors
     int w;                             // w
     int numBuckets;                    // number of buckets
+    int probes;                        // -probes number of extra buckets per table
     std::vector<HashTable> hashtables; // hash tables
-    ImageDistance *distance;
+    ProjectionMatrix projections;      // h_i functions of every table
+    const Dataset<T> &images;          // input images
+    Distance distance;
+    const ProductQuantizer *quantizer; // codes of the images, or nullptr
+    int rerank;                        // candidates ranked again with their exact distances
+
+    void ProbeKeys(int table, std::vector<uint64_t> &hashes, const std::vector<double> &fractions, std::vector<uint32_t> &keys) const;
 
 public:
-    Lsh(const std::vector<ImagePtr> &images, int numHashFuncs, int numHtables, int numNn, int w, int numBuckets);
+    Lsh(const Dataset<T> &images, int numHashFuncs, int numHtables, int numNn, int w, int numBuckets, int probes = 0);
     ~Lsh();
-    std::vector<Neighbor> Approximate_kNN(ImagePtr query);
-    std::vector<ImagePtr> Approximate_Range_Search(ImagePtr query, const double radius);
+    void UseQuantizer(const ProductQuantizer *quantizer, int rerank);
+    std::vector<Neighbor> Approximate_kNN(const ImageView<T> &query);
+    void SearchBatch(const std::vector<ImageView<T>> &queries, std::vector<std::vector<Neighbor>> &results, ThreadPool &pool);
+    std::vector<int> Approximate_Range_Search(const ImageView<T> &query, const double radius);
+    std::size_t memoryUsage() const;
 };
 
 #endif
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cstdint>
 
 // A simple class which stores the command line argument for lsh algorithms
 // The arguments are initialized to their default values except from input,
@@ -16,7 +18,9 @@ public:
     int numHashFuncs;       // –k number of hash functions
     int numHtables;         // -L number of hash tables
     int numNn;              // -Ν number of Nearest Neighbors
+    int probes;             // -probes number of extra buckets per table
     double radius;          // -R radius
+    uint64_t seed;          // -seed <int> seed of the random projections
 
     LshCmdArgs(const int argc, const char *argv[]) : inputFile(""),
                                                      queryFile(""),
@@ -24,7 +28,9 @@ public:
                                                      numHashFuncs(4),
                                                      numHtables(5),
                                                      numNn(1),
-                                                     radius(10000)
+                                                     probes(0),
+                                                     radius(10000),
+                                                     seed(1)
     {
         for (int i = 0; i < argc; i++)
         {
@@ -40,8 +46,12 @@ public:
                 outputFile = std::string(argv[i + 1]);
             else if (!strcmp(argv[i], "-N"))
                 numNn = atoi(argv[i + 1]);
+            else if (!strcmp(argv[i], "-probes"))
+                probes = atoi(argv[i + 1]);
             else if (!strcmp(argv[i], "-R"))
                 radius = atof(argv[i + 1]);
+            else if (!strcmp(argv[i], "-seed"))
+                seed = strtoull(argv[i + 1], nullptr, 10);
         }
     }
 };
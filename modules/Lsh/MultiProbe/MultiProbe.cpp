@@ -0,0 +1,82 @@
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+#include "MultiProbe.hpp"
+
+// One coordinate of a perturbation: the function, the direction and the squared distance to the boundary it crosses
+class Shift
+{
+public:
+    int function;
+    int delta;
+    double score;
+};
+
+// A set of shifts, indices into the shifts sorted by score. The last index is the largest
+class ShiftSet
+{
+public:
+    std::vector<int> shifts;
+    double score;
+
+    bool operator>(const ShiftSet &other) const { return score > other.score; }
+};
+
+// The shift/expand generation of Lv et al.: every set of the sorted shifts is reached exactly once, from the set
+// without its largest index, and the sets come out of the heap in the order of their score. A set that moves the same
+// function both ways is not a bucket, it is only kept in the heap to reach the sets after it
+std::vector<Perturbation> Perturbations(const double *fractions, int numFunctions, int count)
+{
+    std::vector<Shift> shifts;
+    for (int i = 0; i < numFunctions; i++)
+    {
+        shifts.push_back({i, -1, fractions[i] * fractions[i]});
+        shifts.push_back({i, +1, (1 - fractions[i]) * (1 - fractions[i])});
+    }
+    std::sort(shifts.begin(), shifts.end(), [](const Shift &a, const Shift &b)
+              { return a.score < b.score; });
+
+    std::vector<Perturbation> perturbations;
+    std::priority_queue<ShiftSet, std::vector<ShiftSet>, std::greater<ShiftSet>> heap;
+    if (!shifts.empty())
+        heap.push({{0}, shifts[0].score});
+    std::vector<bool> moved(numFunctions);
+    while ((int)perturbations.size() < count && !heap.empty())
+    {
+        ShiftSet set = heap.top();
+        heap.pop();
+
+        int last = set.shifts.back();
+        if (last + 1 < (int)shifts.size())
+        {
+            // Shift: the largest index is replaced with the next one
+            ShiftSet shifted = set;
+            shifted.shifts.back() = last + 1;
+            shifted.score += shifts[last + 1].score - shifts[last].score;
+            heap.push(shifted);
+
+            // Expand: the next index is added
+            ShiftSet expanded = set;
+            expanded.shifts.push_back(last + 1);
+            expanded.score += shifts[last + 1].score;
+            heap.push(expanded);
+        }
+
+        Perturbation perturbation;
+        perturbation.score = set.score;
+        bool valid = true;
+        for (int j : set.shifts)
+        {
+            valid = valid && !moved[shifts[j].function];
+            moved[shifts[j].function] = true;
+            perturbation.functions.push_back(shifts[j].function);
+            perturbation.deltas.push_back(shifts[j].delta);
+        }
+        for (int j : set.shifts)
+            moved[shifts[j].function] = false;
+        if (valid)
+            perturbations.push_back(perturbation);
+    }
+    return perturbations;
+}
@@ -0,0 +1,27 @@
+#ifndef MULTIPROBE_HPP_
+#define MULTIPROBE_HPP_
+
+#include <vector>
+
+/**
+ * @brief A perturbation vector of the multi-probe lsh (Lv et al.), it moves some of the h_i values of a query to the
+ * next or to the previous window, the bucket of the moved values is one of the buckets next to the bucket of the query
+ *
+ * @param functions the h_i functions that are moved, indices among the k functions of the table
+ * @param deltas +1 or -1 for every function, the value of function functions[j] becomes h + deltas[j]
+ * @param score the sum of the squared distances of the moved values to the boundary they cross, in windows. A lower
+ * score is a bucket more likely to hold neighbors of the query
+ */
+class Perturbation
+{
+public:
+    std::vector<int> functions;
+    std::vector<int> deltas;
+    double score;
+};
+
+// The count perturbation vectors of lowest score for a query, from the positions fractions[0..numFunctions) of its
+// values in their windows (see ProjectionMatrix::hash), in the order of their score
+std::vector<Perturbation> Perturbations(const double *fractions, int numFunctions, int count);
+
+#endif
@@ -2,6 +2,7 @@
 #include <vector>
 #include <fstream>
 #include <chrono>
+#include <memory>
 
 #include "Image.hpp"
 #include "Utils.hpp"
@@ -17,33 +18,28 @@
 #include "Utils.hpp"
 #include "Lsh.hpp"
 #include "GraphsCmdArgs.hpp"
-#include "FileParser.hpp"
+#include "IdxFile.hpp"
+#include "DatasetLoader.hpp"
+#include "DatasetStream.hpp"
 #include "BruteForce.hpp"
 #include "ImageDistance.hpp"
 #include "GraphAlgorithm.hpp"
 #include "Mrng.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
+#include "GroundTruth.hpp"
 
-int main(int argc, char const *argv[])
+// Builds the graph for the metric and answers the queries, the pixel type and the metric are chosen once in main
+template <typename T, typename Distance>
+static int GraphSearch(GraphsCmdArgs &args, const Dataset<T> &input_images)
 {
-    // Analyze arguments from command line and store them in a simple object
-    GraphsCmdArgs args(argc, argv);
-
-    readFilenameIfEmpty(args.inputFile, "input");
-
-    // Parse file and get the images
-    FileParser inputParser(args.inputFile, 5000);
-    const std::vector<ImagePtr> input_images = inputParser.GetImages();
-
-    readFilenameIfEmpty(args.queryFile, "query");
-
-    readFilenameIfEmpty(args.outputFile, "output");
     std::ofstream output_file;
 
-    // Configure the metric used for the lsh program
-    ImageDistance::setMetric(DistanceMetric::EUCLIDEAN);
+    // The metric of the graph and of the brute force
+    Distance distance;
 
     // Initialize Graphs
-    GraphAlgorithm *algorithm = nullptr;
+    GraphAlgorithm<T> *algorithm = nullptr;
     std::string graph_algorithm_name = "";
 
     if (args.numNn < 1)
@@ -51,11 +47,33 @@ int main(int argc, char const *argv[])
         std::cerr << "Error, the number of nearest neighbors has to be positive" << std::endl;
         return EXIT_FAILURE;
     }
+    if (args.chunk < 1)
+    {
+        std::cerr << "Error, the number of queries of a chunk has to be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+    // The kNN graph of GNNS and of the MRNG candidates
+    KnnGraphMethod init = KnnGraphMethod::NN_DESCENT;
+    if (args.init == "lsh")
+        init = KnnGraphMethod::LSH;
+    else if (args.init != "nndescent")
+    {
+        std::cerr << "Error, unknown kNN graph initializer " << args.init << std::endl;
+        return EXIT_FAILURE;
+    }
+
     if (args.m == 1)
     {
         // GNNS initialization
         graph_algorithm_name = "GNNS";
-        algorithm = new GNNS(input_images, args.graphNN, args.expansions, args.restarts, args.numNn);
+        GNNS<T, Distance> *gnns;
+        if (!args.loadFile.empty())
+            gnns = GNNS<T, Distance>::load(input_images, args.loadFile, args.expansions, args.restarts, args.numNn, args.verify);
+        else
+            gnns = new GNNS<T, Distance>(input_images, args.graphNN, args.expansions, args.restarts, args.numNn, init);
+        if (!args.saveFile.empty())
+            gnns->save(args.saveFile);
+        algorithm = gnns;
     }
     else if (args.m == 2)
     {
@@ -65,8 +83,21 @@ int main(int argc, char const *argv[])
             std::cerr << "Error, the number of candidates must be greater or equal to the number of nearest neighbors" << std::endl;
             return EXIT_FAILURE;
         }
+        if (args.maxDegree < 1)
+        {
+            std::cerr << "Error, the maximum degree of the graph has to be positive" << std::endl;
+            return EXIT_FAILURE;
+        }
         graph_algorithm_name = "MRNG";
-        algorithm = new Mrng(input_images, args.numNn, args.l);
+        Mrng<T, Distance> *mrng;
+        if (!args.loadFile.empty())
+            mrng = Mrng<T, Distance>::load(input_images, args.loadFile, args.numNn, args.l, args.verify);
+        else
+            // The edges are chosen among the -k approximate nearest neighbors of every image
+            mrng = new Mrng<T, Distance>(input_images, args.numNn, args.l, args.graphNN, args.maxDegree, init);
+        if (!args.saveFile.empty())
+            mrng->save(args.saveFile);
+        algorithm = mrng;
     }
     else
     {
@@ -74,67 +105,100 @@ int main(int argc, char const *argv[])
         return EXIT_FAILURE;
     }
 
+    // The queries of a file are answered as one batch on the threads of the default pool
+    ThreadPool &pool = ThreadPool::Default();
+
     auto tTotalApproximate = std::chrono::nanoseconds(0);
     auto tTotalTrue = std::chrono::nanoseconds(0);
     double AAF = 0;
     int found = 0;
     double MAF = -1;
+    std::size_t totalQueries = 0;
 
     // Keep reading new query and output files until the user types "exit"
     while (true)
     {
-        // Get query images
-        FileParser queryParser(args.queryFile);
-        std::vector<ImagePtr> query_images = queryParser.GetImages();
+        // The query file is read in chunks, the next chunk is read while the queries of the current one are answered
+        DatasetStream<T> queryStream(args.queryFile, args.chunk, -1, args.format, args.dimension);
+
+        // The ground truth cache has one entry for the whole query file, the one the groundtruth tool writes, so the
+        // file is hashed in a first pass and every chunk takes its rows from the entry
+        uint64_t queriesHash = 0;
+        if (!args.groundTruth.empty())
+        {
+            DatasetStream<T> hashStream(args.queryFile, args.chunk, -1, args.format, args.dimension);
+            queriesHash = HashImages(hashStream);
+        }
+        ChunkedGroundTruth<T, Distance> groundTruth(args.groundTruth, input_images, queriesHash, queryStream.size(), args.numNn);
 
         output_file.open(args.outputFile);
 
         output_file << graph_algorithm_name << " Results" << std::endl;
 
-        // For each query data point calculate its approximate k nearesest neighbors with the preferable graph algorithm and compare it to brute force
-        for (int q = 0; q < (int)query_images.size(); q++)
+        while (queryStream.Next())
         {
-            ImagePtr query = query_images[q];
+            const Dataset<T> &query_images = queryStream.Chunk();
 
-            startClock();
-            std::vector<Neighbor> approx_vector = algorithm->Approximate_kNN(query);
-            auto elapsed_graph = stopClock();
-            tTotalApproximate += elapsed_graph;
+            // The id of a query is its position in the file
+            std::vector<ImageView<T>> queries;
+            for (std::size_t q = 0; q < query_images.size(); q++)
+                queries.push_back(ImageView<T>((int)(queryStream.Offset() + q), (int)query_images.dimension(), query_images.row(q)));
 
+            // Calculate the approximate k nearesest neighbors of all the queries with the preferable graph algorithm and compare them to brute force.
+            // The time of a query is its share of the time of the batch
+            std::vector<std::vector<Neighbor>> approx_results;
             startClock();
-            std::vector<Neighbor> brute_vector = BruteForce(input_images, query, args.numNn);
-            auto elapsed_brute = stopClock();
-            tTotalTrue += elapsed_brute;
+            algorithm->SearchBatch(queries, approx_results, pool);
+            auto elapsed_batch = stopClock();
+            tTotalApproximate += elapsed_batch;
 
-            output_file << "Query: " << query->id << std::endl;
+            // The exact neighbors come from the ground truth cache when an earlier run or the groundtruth tool wrote them
+            std::vector<std::vector<Neighbor>> brute_results;
+            startClock();
+            groundTruth.Chunk(queries, queryStream.Offset(), distance, brute_results);
+            auto elapsed_brute_batch = stopClock();
+            tTotalTrue += elapsed_brute_batch;
+            totalQueries += queries.size();
 
-            int limit = approx_vector.size();
-            for (int i = 0; i < limit; i++)
+            for (int q = 0; q < (int)queries.size(); q++)
             {
-                ImagePtr image = approx_vector[i].image;
-                double aproxDist = approx_vector[i].distance;
+                const ImageView<T> &query = queries[q];
+                const std::vector<Neighbor> &approx_vector = approx_results[q];
+                const std::vector<Neighbor> &brute_vector = brute_results[q];
+                auto elapsed_graph = elapsed_batch / queries.size();
+                auto elapsed_brute = elapsed_brute_batch / queries.size();
 
-                output_file << "Nearest neighbor-" << i + 1 << ": " << image->id << std::endl
-                            << "distance" << graph_algorithm_name << "Approximate: " << aproxDist << "\n";
+                output_file << "Query: " << query.id << std::endl;
 
-                double trueDist = brute_vector[i].distance;
-                output_file << "distanceTrue: " << trueDist << "\n";
+                int limit = approx_vector.size();
+                for (int i = 0; i < limit; i++)
+                {
+                    int image = approx_vector[i].id;
+                    // The algorithms rank with squared distances, the true distance is only computed for the reported neighbors
+                    double aproxDist = Distance::toDistance(approx_vector[i].distance);
 
-                if (aproxDist / trueDist > MAF || MAF == -1)
-                    MAF = aproxDist / trueDist;
-                AAF += aproxDist / trueDist;
-            }
-            found += limit;
-            output_file << "t" << graph_algorithm_name << ": " << elapsed_graph.count() * 1e-9 << std::endl;
-            output_file << "tTrue: " << elapsed_brute.count() * 1e-9 << std::endl;
+                    output_file << "Nearest neighbor-" << i + 1 << ": " << image << std::endl
+                                << "distance" << graph_algorithm_name << "Approximate: " << aproxDist << "\n";
+
+                    double trueDist = Distance::toDistance(brute_vector[i].distance);
+                    output_file << "distanceTrue: " << trueDist << "\n";
+
+                    if (aproxDist / trueDist > MAF || MAF == -1)
+                        MAF = aproxDist / trueDist;
+                    AAF += aproxDist / trueDist;
+                }
+                found += limit;
+                output_file << "t" << graph_algorithm_name << ": " << elapsed_graph.count() * 1e-9 << std::endl;
+                output_file << "tTrue: " << elapsed_brute.count() * 1e-9 << std::endl;
 
-            output_file << std::endl;
+                output_file << std::endl;
+            }
         }
 
-        output_file << "tAverageApproximate: " << tTotalApproximate.count() * 1e-9 / 100 << std::endl; // Average Approximate time
-        output_file << "tAverageTrue: " << tTotalTrue.count() * 1e-9 / 100 << std::endl;               // Average True time
-        output_file << "AAF: " << AAF / found << std::endl;                                            // Average Approximation Factor
-        output_file << "MAF: " << MAF;                                                                 // Maximum Approximation Factor
+        output_file << "tAverageApproximate: " << tTotalApproximate.count() * 1e-9 / totalQueries << std::endl; // Average Approximate time
+        output_file << "tAverageTrue: " << tTotalTrue.count() * 1e-9 / totalQueries << std::endl;               // Average True time
+        output_file << "AAF: " << AAF / found << std::endl;                                                     // Average Approximation Factor
+        output_file << "MAF: " << MAF;                                                                          // Maximum Approximation Factor
 
         // Read new query and output files.
         args.queryFile.clear();
@@ -154,3 +218,46 @@ int main(int argc, char const *argv[])
 
     return EXIT_SUCCESS;
 }
+
+// The only runtime dispatch on the metric, everything below is compiled for it
+template <typename T>
+static int GraphSearch(GraphsCmdArgs &args, const Dataset<T> &input_images)
+{
+    if (args.metric == EuclideanDistance::name())
+        return GraphSearch<T, EuclideanDistance>(args, input_images);
+    else if (args.metric == ManhattanDistance::name())
+        return GraphSearch<T, ManhattanDistance>(args, input_images);
+
+    std::cerr << "Error, unknown metric " << args.metric << std::endl;
+    return EXIT_FAILURE;
+}
+
+int main(int argc, char const *argv[])
+{
+    // Analyze arguments from command line and store them in a simple object
+    GraphsCmdArgs args(argc, argv);
+
+    // Every parallel part of the program runs on the default pool, it is created with the first of them
+    ThreadPool::SetDefaultThreads(args.threads);
+    SetSeed(args.seed);
+
+    readFilenameIfEmpty(args.inputFile, "input");
+
+    readFilenameIfEmpty(args.queryFile, "query");
+
+    readFilenameIfEmpty(args.outputFile, "output");
+
+    // Byte pixels (MNIST, bvecs) are kept as uint8_t, everything else as float
+    DatasetLayout layout = ReadLayout(args.inputFile, args.format, args.dimension);
+    if (layout.element == ElementType::UINT8)
+    {
+        // An IDX file is mapped and its images are used where they are
+        if (layout.format == "idx")
+        {
+            std::shared_ptr<IdxFile> inputFile = std::make_shared<IdxFile>(args.inputFile);
+            return GraphSearch(args, inputFile->images());
+        }
+        return GraphSearch(args, LoadDataset<uint8_t>(args.inputFile, -1, args.format, args.dimension));
+    }
+    return GraphSearch(args, LoadDataset<float>(args.inputFile, -1, args.format, args.dimension));
+}
\ No newline at end of file
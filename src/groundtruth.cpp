@@ -0,0 +1,111 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <memory>
+
+#include "Image.hpp"
+#include "Utils.hpp"
+#include "IdxFile.hpp"
+#include "DatasetLoader.hpp"
+#include "BruteForce.hpp"
+#include "GroundTruth.hpp"
+#include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+
+// Writes the ground truth of a search to the cache, or reports that it is already there
+template <typename T, typename Distance>
+static int WriteCache(const std::string &directory, const Dataset<T> &input_images, const std::vector<ImageView<T>> &queries, int numNn)
+{
+    Distance distance;
+    std::vector<std::vector<Neighbor>> results;
+
+    startClock();
+    bool cached = CachedBruteForce(directory, input_images, queries, numNn, distance, results);
+    double seconds = stopClock().count() * 1e-9;
+
+    std::cout << GroundTruthPrefix(directory, Distance::name(), numNn, HashImages(input_images), HashImages(queries))
+              << (cached ? " already exists" : " written") << " (" << seconds << " s)" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+template <typename T>
+static int WriteCache(const std::string &directory, const std::string &metric, const Dataset<T> &input_images, const Dataset<T> &query_images, int numNn)
+{
+    std::vector<ImageView<T>> queries;
+    for (std::size_t q = 0; q < query_images.size(); q++)
+        queries.push_back(query_images[q]);
+
+    if (metric == EuclideanDistance::name())
+        return WriteCache<T, EuclideanDistance>(directory, input_images, queries, numNn);
+    else if (metric == ManhattanDistance::name())
+        return WriteCache<T, ManhattanDistance>(directory, input_images, queries, numNn);
+
+    std::cerr << "Error, unknown metric " << metric << std::endl;
+    return EXIT_FAILURE;
+}
+
+// Computes the exact nearest neighbors of a query file once and stores them in a ground truth directory, from where
+// graph_search and the test programs read them with -gt instead of running the brute force every time
+int main(int argc, char const *argv[])
+{
+    std::string inputFile;
+    std::string queryFile;
+    std::string directory;
+    std::string metric = EuclideanDistance::name();
+    std::string format;
+    int dimension = -1;
+    int size = -1;
+    int numQueries = -1;
+    int numNn = 1;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-d"))
+            inputFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-q"))
+            queryFile = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-gt"))
+            directory = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-metric"))
+            metric = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-f"))
+            size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-nq"))
+            numQueries = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-N"))
+            numNn = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-format"))
+            format = std::string(argv[i + 1]);
+        else if (!strcmp(argv[i], "-dim"))
+            dimension = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+    }
+
+    if (inputFile.empty() || queryFile.empty() || directory.empty())
+    {
+        std::cerr << "Usage: groundtruth -d <input file> -q <query file> -gt <directory> [-N <k>] [-metric <euclidean or manhattan>]"
+                  << " [-f <number of input images>] [-nq <number of queries>] [-format <idx, fvecs, bvecs, ivecs or f32>] [-dim <int>]"
+                  << " [-threads <int>]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (numNn < 1)
+    {
+        std::cerr << "Error, the number of nearest neighbors has to be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The same images and the same pixel type as the programs that read the files, -f and -nq select the first images
+    // like their -f does. Byte pixels are kept as uint8_t and IDX files are mapped, everything else is read as float
+    DatasetLayout layout = ReadLayout(inputFile, format, dimension);
+    if (layout.element == ElementType::UINT8)
+    {
+        if (layout.format == "idx")
+            return WriteCache(directory, metric, std::make_shared<IdxFile>(inputFile)->images(size),
+                              std::make_shared<IdxFile>(queryFile)->images(numQueries), numNn);
+        return WriteCache(directory, metric, LoadDataset<uint8_t>(inputFile, size, format, dimension),
+                          LoadDataset<uint8_t>(queryFile, numQueries, format, dimension), numNn);
+    }
+    return WriteCache(directory, metric, LoadDataset<float>(inputFile, size, format, dimension),
+                      LoadDataset<float>(queryFile, numQueries, format, dimension), numNn);
+}
\ No newline at end of file
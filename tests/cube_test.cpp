@@ -1,14 +1,18 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <algorithm>
 #include <math.h>
 
 #include "BruteForce.hpp"
+#include "GroundTruth.hpp"
 #include "CubeCmdArgs.hpp"
 #include "Cube.hpp"
 #include "FileParser.hpp"
 #include "Utils.hpp"
 #include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
 
 int main(int argc, char const *argv[])
 {
@@ -18,6 +22,7 @@ int main(int argc, char const *argv[])
     int numNn = -1;
     std::string inputFile;
     std::string queryFile;
+    std::string groundTruth;
     int w = -1;
     bool show = false;
     int size = -1;
@@ -42,49 +47,61 @@ int main(int argc, char const *argv[])
             show = true;
         else if (!strcmp(argv[i], "-f"))
             size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-gt"))
+            groundTruth = std::string(argv[i + 1]);
     }
 
-    FileParser inputParser(inputFile, size);
-    const std::vector<ImagePtr> input_images = inputParser.GetImages();
+    FileParser<uint8_t> inputParser(inputFile, size);
+    const Dataset<uint8_t> &input_images = inputParser.GetImages();
 
-    FileParser queryParser(queryFile);
-    std::vector<ImagePtr> query_images = queryParser.GetImages();
+    FileParser<uint8_t> queryParser(queryFile);
+    const Dataset<uint8_t> &query_images = queryParser.GetImages();
 
     int numBuckets = std::pow(2, dimension); // {0,1}^d'=> 2^k
 
-    ImageDistance::setMetric(DistanceMetric::EUCLIDEAN);
+    EuclideanDistance distance;
 
-    Cube cube(input_images, w, dimension, maxCanditates, probes, numNn, numBuckets);
+    Cube<uint8_t, EuclideanDistance> cube(input_images, w, dimension, maxCanditates, probes, numNn, numBuckets);
+
+    // The exact neighbors of all the queries are computed as one batch or read from the ground truth cache, the average
+    // is the time of the batch per query
+    std::vector<ImageView<uint8_t>> queries;
+    for (std::size_t q = 0; q < std::min((std::size_t)1000, query_images.size()); q++)
+        queries.push_back(query_images[q]);
+    std::vector<std::vector<Neighbor>> brute_results;
+    startClock();
+    CachedBruteForce(groundTruth, input_images, queries, numNn, distance, brute_results);
+    auto tTotalTrue = stopClock();
 
     auto tTotalApproximate = std::chrono::nanoseconds(0);
-    auto tTotalTrue = std::chrono::nanoseconds(0);
     double AAF = 0;
     double MAF = -1;
     int found = 0;
-    for (int q = 0; q < 1000; q++)
+    for (int q = 0; q < (int)queries.size(); q++)
     {
-        ImagePtr query = query_images[q];
+        ImageView<uint8_t> query = query_images[q];
 
         startClock();
         std::vector<Neighbor> approx_vector = cube.Approximate_kNN(query);
         auto elapsed_graph = stopClock();
         tTotalApproximate += elapsed_graph;
 
-        startClock();
-        std::vector<Neighbor> brute_vector = BruteForce(input_images, query, numNn);
-        auto elapsed_brute = stopClock();
-        tTotalTrue += elapsed_brute;
-        // std::cout << "Query: " << query->id << std::endl;
+        const std::vector<Neighbor> &brute_vector = brute_results[q];
+        // std::cout << "Query: " << query.id << std::endl;
         int limit = approx_vector.size();
         for (int i = 0; i < limit; i++)
         {
-            // ImagePtr image = approx_vector[i].image;
-            double aproxDist = approx_vector[i].distance;
+            // int image = approx_vector[i].id;
+            double aproxDist = EuclideanDistance::toDistance(approx_vector[i].distance);
 
-            // std::cout << "Nearest neighbor-" << i + 1 << ": " << image->id << std::endl
+            // std::cout << "Nearest neighbor-" << i + 1 << ": " << image << std::endl
             //           << "distanceApproximate: " << aproxDist << "\n";
 
-            double trueDist = brute_vector[i].distance;
+            double trueDist = EuclideanDistance::toDistance(brute_vector[i].distance);
             // std::cout << "distanceTrue: " << trueDist << "\n";
 
             if (aproxDist / trueDist > MAF || MAF == -1)
@@ -94,13 +111,12 @@ int main(int argc, char const *argv[])
         }
         found += limit;
         // std::cout << "tApprox: " << elapsed_graph.count() * 1e-9 << std::endl;
-        // std::cout << "tTrue: " << elapsed_brute.count() * 1e-9 << std::endl;
         // std::cout << std::endl;
     }
     if (show)
         std::cout << "w:" << w << std::endl;
-    std::cout << "tAverageApproximate:" << tTotalApproximate.count() * 1e-9 / 1000 << std::endl;
-    std::cout << "tAverageTrue:" << tTotalTrue.count() * 1e-9 / 1000 << std::endl;
+    std::cout << "tAverageApproximate:" << tTotalApproximate.count() * 1e-9 / queries.size() << std::endl;
+    std::cout << "tAverageTrue:" << tTotalTrue.count() * 1e-9 / queries.size() << std::endl;
     std::cout << "AAF:" << AAF / found << std::endl;
     std::cout << "MAF:" << MAF; // << std::endl << std::endl;
 
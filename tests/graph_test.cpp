@@ -1,6 +1,7 @@
 #include <iostream>
 #include <cstring>
 #include <vector>
+#include <algorithm>
 #include <fstream>
 #include <chrono>
 #include "Image.hpp"
@@ -9,18 +10,24 @@
 #include "Mrng.hpp"
 #include "FileParser.hpp"
 #include "BruteForce.hpp"
+#include "GroundTruth.hpp"
 #include "ImageDistance.hpp"
+#include "ThreadPool.hpp"
+#include "Random.hpp"
 
 int main(int argc, char const *argv[])
 {
     std::string inputFile;
     std::string queryFile;
+    std::string groundTruth;
     int graphNN = -1;
     int expansions = -1;
     int restarts = -1;
     int numNn = -1;
     int l = -1;
     int m = -1;
+    int degree = 30;
+    KnnGraphMethod init = KnnGraphMethod::NN_DESCENT;
     bool show = false;
     int size = -1;
 
@@ -42,61 +49,77 @@ int main(int argc, char const *argv[])
             l = atoi(argv[i + 1]);
         else if (!strcmp(argv[i], "-m"))
             m = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-degree"))
+            degree = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-init"))
+            init = strcmp(argv[i + 1], "lsh") ? KnnGraphMethod::NN_DESCENT : KnnGraphMethod::LSH;
         else if (!strcmp(argv[i], "-s"))
             show = true;
         else if (!strcmp(argv[i], "-f"))
             size = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads"))
+            ThreadPool::SetDefaultThreads(atoi(argv[i + 1]));
+        else if (!strcmp(argv[i], "-seed"))
+            SetSeed(strtoull(argv[i + 1], nullptr, 10));
+        else if (!strcmp(argv[i], "-gt"))
+            groundTruth = std::string(argv[i + 1]);
     }
 
-    // Parse file and get the images
-    FileParser inputParser(inputFile, size);
-    const std::vector<ImagePtr> input_images = inputParser.GetImages();
+    // Parse file and get the images, MNIST pixels are kept as uint8_t (one byte per pixel)
+    FileParser<uint8_t> inputParser(inputFile, size);
+    const Dataset<uint8_t> &input_images = inputParser.GetImages();
 
     // Get query images
-    FileParser queryParser(queryFile);
-    std::vector<ImagePtr> query_images = queryParser.GetImages();
+    FileParser<uint8_t> queryParser(queryFile);
+    const Dataset<uint8_t> &query_images = queryParser.GetImages();
 
-    // Configure the metric used for the lsh program
-    ImageDistance::setMetric(DistanceMetric::EUCLIDEAN);
+    // The metric of the graphs and of the brute force
+    EuclideanDistance distance;
 
     // Initialize Graphs
-    GraphAlgorithm *algorithm = nullptr;
+    GraphAlgorithm<uint8_t> *algorithm = nullptr;
 
     if (m == 1)
         // GNNS initialization
-        algorithm = new GNNS(input_images, graphNN, expansions, restarts, numNn);
+        algorithm = new GNNS<uint8_t, EuclideanDistance>(input_images, graphNN, expansions, restarts, numNn, init);
     else if (m == 2)
         // MRNG initialization
-        algorithm = new Mrng(input_images, numNn, l);
-    auto tTotalApproximate = std::chrono::nanoseconds(0);
-    auto tTotalTrue = std::chrono::nanoseconds(0);
+        algorithm = new Mrng<uint8_t, EuclideanDistance>(input_images, numNn, l, graphNN > 0 ? graphNN : 50, degree, init);
     double AAF = 0;
     double MAF = -1;
     int found = 0;
-    for (int q = 0; q < 1000; q++)
+
+    // The queries are answered as one batch on the threads of the default pool, the averages are the time of the batch per query
+    ThreadPool &pool = ThreadPool::Default();
+    std::vector<ImageView<uint8_t>> queries;
+    for (std::size_t q = 0; q < std::min((std::size_t)1000, query_images.size()); q++)
+        queries.push_back(query_images[q]);
+
+    std::vector<std::vector<Neighbor>> approx_results;
+    startClock();
+    algorithm->SearchBatch(queries, approx_results, pool);
+    auto tTotalApproximate = stopClock();
+
+    std::vector<std::vector<Neighbor>> brute_results;
+    startClock();
+    CachedBruteForce(groundTruth, input_images, queries, numNn, distance, brute_results);
+    auto tTotalTrue = stopClock();
+
+    for (int q = 0; q < (int)queries.size(); q++)
     {
-        ImagePtr query = query_images[q];
-
-        startClock();
-        std::vector<Neighbor> approx_vector = algorithm->Approximate_kNN(query);
-        auto elapsed_graph = stopClock();
-        tTotalApproximate += elapsed_graph;
-
-        startClock();
-        std::vector<Neighbor> brute_vector = BruteForce(input_images, query, numNn);
-        auto elapsed_brute = stopClock();
-        tTotalTrue += elapsed_brute;
-        // std::cout << "Query: " << query->id << std::endl;
+        const std::vector<Neighbor> &approx_vector = approx_results[q];
+        const std::vector<Neighbor> &brute_vector = brute_results[q];
+        // std::cout << "Query: " << query.id << std::endl;
         int limit = approx_vector.size();
         for (int i = 0; i < limit; i++)
         {
-            // ImagePtr image = approx_vector[i].image;
-            double aproxDist = approx_vector[i].distance;
+            // int image = approx_vector[i].id;
+            double aproxDist = EuclideanDistance::toDistance(approx_vector[i].distance);
 
-            // std::cout << "Nearest neighbor-" << i + 1 << ": " << image->id << std::endl
+            // std::cout << "Nearest neighbor-" << i + 1 << ": " << image << std::endl
             //           << "distanceApproximate: " << aproxDist << "\n";
 
-            double trueDist = brute_vector[i].distance;
+            double trueDist = EuclideanDistance::toDistance(brute_vector[i].distance);
             // std::cout << "distanceTrue: " << trueDist << "\n";
 
             if (aproxDist / trueDist > MAF || MAF == -1)
@@ -113,8 +136,8 @@ int main(int argc, char const *argv[])
         std::cout << "R:" << restarts << std::endl;
     else if (m == 2 && show)
         std::cout << "l:" << l << std::endl;
-    std::cout << "tAverageApproximate:" << tTotalApproximate.count() * 1e-9 / 1000 << std::endl;
-    std::cout << "tAverageTrue:" << tTotalTrue.count() * 1e-9 / 1000 << std::endl;
+    std::cout << "tAverageApproximate:" << tTotalApproximate.count() * 1e-9 / queries.size() << std::endl;
+    std::cout << "tAverageTrue:" << tTotalTrue.count() * 1e-9 / queries.size() << std::endl;
     std::cout << "AAF:" << AAF / found << std::endl;
     std::cout << "MAF:" << MAF; // << std::endl << std::endl;
 
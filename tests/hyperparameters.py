@@ -1,11 +1,13 @@
 import os
 import sys
 import subprocess
-import re
 import pandas as pd
 import matplotlib.pyplot as plt
 from tabulate import tabulate
 
+# Ground truth cache shared by all the sweeps, relative to the bin directory the tests run in
+GROUND_TRUTH = "../groundtruth"
+
 
 def execute_make(command):
     # Save the current working directory
@@ -29,23 +31,38 @@ def get_test_name():
     # return command-line argument
     return sys.argv[1]
 
-def execute_test(test_name, args):
+def execute_bench(args, csv):
     # Get the current working directory
     current_directory = os.getcwd()
 
     # Construct the absolute path to the "bin" directory and change to the "bin" directory
     os.chdir(os.path.join(current_directory, os.pardir, "bin"))
 
-    # Specify the command to run, including the C program and any command-line arguments
-    command = f"./{test_name}_test {args}"
-
-    # Use subprocess to run the command and capture the output
-    result = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, shell=True)
+    # The benchmark writes one CSV row per setting of the sweep, so nothing has to be scraped from its output
+    subprocess.run(f"./ann_bench {args} -csv {csv}", shell=True)
 
     # Change back to the original directory
     os.chdir(current_directory)
 
-    return result.stdout.decode('utf-8')
+def read_results(csv, sweep):
+    # The parameters column holds the settings of each row as "name=value" pairs separated by spaces
+    df = pd.read_csv(os.path.join(os.pardir, "bin", csv))
+    parameters = [dict(pair.split("=") for pair in row.split()) for row in df["parameters"]]
+
+    return {
+        sweep: [int(p[sweep]) for p in parameters],
+        "recall": df["recall"].tolist(),
+        "qps": df["qps"].tolist(),
+        "p99_us": df["p99_us"].tolist(),
+        "AAF": df["aaf"].tolist(),
+    }
+
+def create_ground_truth(args):
+    # The exact neighbors of the queries are computed once and every run of the sweep reads them from the cache
+    current_directory = os.getcwd()
+    os.chdir(os.path.join(current_directory, os.pardir, "bin"))
+    subprocess.run(f"./groundtruth {args} -nq 1000 -gt {GROUND_TRUTH}", shell=True)
+    os.chdir(current_directory)
 
 def save_table(transposed_data, results, test_name, graph_type):
     # Create the table
@@ -131,6 +148,17 @@ def save_plots(results, test_name, graph_type):
     else:
         plt.savefig(f'{graph_type.upper()}/{fourth}.png')
 
+    # Recall against queries per second, the curve the settings of the sweep trade along
+    plt.figure()
+    plt.plot(results["recall"], results["qps"], marker='o', color='purple')
+    plt.xlabel("recall")
+    plt.ylabel("queries per second")
+    plt.title("recall - qps")
+    if graph_type is None:
+        plt.savefig(f'{test_name.upper()}/pareto.png')
+    else:
+        plt.savefig(f'{graph_type.upper()}/pareto.png')
+
     print("Line charts were saved")
 
 def save_csv(results, test_name, graph_type):
@@ -152,74 +180,29 @@ if __name__ == "__main__":
     else:
         test_name, graph_type = get_test_name(), None
 
-    execute_make(f"{test_name}-test")
-    
-    results = {}
+    execute_make("bin/ann_bench")
+    execute_make("groundtruth")
+
+    csv = f"{get_test_name()}.csv"
+    dataset = "-d ../datasets/train-images.idx3-ubyte -q ../datasets/t10k-images.idx3-ubyte"
 
     if test_name == "lsh":
-        for w in [10, 100, 200, 300, 500, 1000, 1500, 2000, 2240, 2500, 3000]: #range(1, 21):
-            output = execute_test(test_name, f"-d ../datasets/train-images.idx3-ubyte -q ../datasets/t10k-images.idx3-ubyte -k 4 -L 5 -N 3 -w {w} -s")
-            output = output.split("\n")
-            for curr_output in output:
-                key, value = curr_output.split(":")
-                if key in results:
-                    if key == "w":
-                        results[key].append(int(value))
-                    else:
-                        results[key].append(float(value))
-                else:    
-                    if key == "w":
-                        results[key] = [int(value)]
-                    else:
-                        results[key] = [float(value)]
+        create_ground_truth(f"{dataset} -N 3")
+        execute_bench(f"{dataset} -index lsh -lsh-k 4 -lsh-L 5 -lsh-w 10,100,200,300,500,1000,1500,2000,2240,2500,3000 -N 3 -nq 1000 -gt {GROUND_TRUTH}", csv)
+        results = read_results(csv, "w")
     elif test_name == "cube":
-        for w in [10, 100, 200, 300, 500, 1000, 1500, 2000, 2240, 2500, 3000]: #range(1, 21):
-            output = execute_test(test_name, f"-d ../datasets/train-images.idx3-ubyte -q ../datasets/t10k-images.idx3-ubyte -k 14 -M 6000 -probes 15 -N 3 -w {w} -s")
-            output = output.split("\n")
-            for curr_output in output:
-                key, value = curr_output.split(":")
-                if key in results:
-                    if key == "w":
-                        results[key].append(int(value))
-                    else:
-                        results[key].append(float(value))
-                else:    
-                    if key == "w":
-                        results[key] = [int(value)]
-                    else:
-                        results[key] = [float(value)]
+        create_ground_truth(f"{dataset} -N 3")
+        execute_bench(f"{dataset} -index cube -cube-k 14 -cube-M 6000 -cube-probes 15 -cube-w 10,100,200,300,500,1000,1500,2000,2240,2500,3000 -N 3 -nq 1000 -gt {GROUND_TRUTH}", csv)
+        results = read_results(csv, "w")
     elif test_name == "graph" and graph_type == "gnns":
-        for r in [1, 2, 5, 10, 15, 20, 30, 40, 50, 100, 200, 500, 1000, 2000]:
-            output = execute_test(test_name, f"-d ../datasets/train-images.idx3-ubyte -q ../datasets/t10k-images.idx3-ubyte -k 40 -E 30 -R {r} -N 3 -l 10 -m 1 -s")
-            output = output.split("\n")
-            for curr_output in output:
-                key, value = curr_output.split(":")
-                if key in results:
-                    if key == "R":
-                        results[key].append(int(value))
-                    else:
-                        results[key].append(float(value))
-                else:    
-                    if key == "R":
-                        results[key] = [int(value)]
-                    else:
-                        results[key] = [float(value)]
+        create_ground_truth(f"{dataset} -N 3")
+        execute_bench(f"{dataset} -index gnns -gnns-k 40 -gnns-E 30 -gnns-R 1,2,5,10,15,20,30,40,50,100,200,500,1000,2000 -N 3 -nq 1000 -gt {GROUND_TRUTH}", csv)
+        results = read_results(csv, "R")
     elif test_name == "graph" and graph_type == "mrng":
-        for l in [20, 100, 300, 500, 600, 700, 800, 900, 1000, 2000, 2500]:
-            output = execute_test(test_name, f"-d ../datasets/train-images.idx3-ubyte -q ../datasets/t10k-images.idx3-ubyte -k 40 -E 30 -R 1 -N 3 -l {l} -m 2 -s -f 20000")
-            output = output.split("\n")
-            for curr_output in output:
-                key, value = curr_output.split(":")
-                if key in results:
-                    if key == "l":
-                        results[key].append(int(value))
-                    else:
-                        results[key].append(float(value))
-                else:    
-                    if key == "l":
-                        results[key] = [int(value)]
-                    else:
-                        results[key] = [float(value)]
+        create_ground_truth(f"{dataset} -N 3 -f 20000")
+        execute_bench(f"{dataset} -index mrng -mrng-k 40 -mrng-degree 30 -mrng-l 20,100,300,500,600,700,800,900,1000,2000,2500 -N 3 -nq 1000 -f 20000 -gt {GROUND_TRUTH}", csv)
+        results = read_results(csv, "l")
+
     # Transpose the data
     transposed_data = list(map(list, zip(*results.values())))
 